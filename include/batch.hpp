@@ -0,0 +1,181 @@
+#ifndef MESSENGER_BATCH_H
+#define MESSENGER_BATCH_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "messenger.hpp"
+#include "name_table.hpp"
+
+namespace messenger {
+
+/**
+ * Messages, encoded back to back into single buffer
+*/
+struct msg_batch_t
+{
+    std::vector<uint8_t> buff;      /**< packets of all messages */
+    std::vector<size_t> offsets;    /**< message i is [offsets[i], offsets[i + 1]) of buff; size is msgs + 1 */
+
+    // Number of messages
+    size_t size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+
+    const uint8_t *msg_begin(size_t i) const { return buff.data() + offsets[i]; }
+    const uint8_t *msg_end(size_t i) const { return buff.data() + offsets[i + 1]; }
+};
+
+/**
+ * Messages, decoded into storage, which is shared by all of them
+*/
+struct parsed_batch_t
+{
+    struct entry_t
+    {
+        size_t name_off;    /**< offset of name in names */
+        size_t text_off;    /**< offset of text in texts */
+        size_t text_len;
+        uint8_t name_len;
+    };
+
+    std::string names;              /**< names of all messages back to back */
+    std::string texts;              /**< texts of all messages back to back */
+    std::vector<entry_t> entries;   /**< entry of every message */
+
+    size_t size() const { return entries.size(); }
+
+    std::string_view name(size_t i) const {
+        return std::string_view(names.data() + entries[i].name_off, entries[i].name_len);
+    }
+
+    std::string_view text(size_t i) const {
+        return std::string_view(texts.data() + entries[i].text_off, entries[i].text_len);
+    }
+
+    // Copy of message i
+    msg_t msg(size_t i) const {
+        return msg_t(std::string(name(i)), std::string(text(i)));
+    }
+};
+
+/**
+ * Messages, decoded into columns for scans: dictionary-encoded senders & concatenated texts
+ *
+ * @details Every distinct sender gets dense id in order of first appearance, ids stay stable,
+ *          while messages of further batches are appended. Message is its sender id & range
+ *          of texts, so scans, filters & aggregations walk flat arrays.
+*/
+struct columnar_batch_t
+{
+    std::vector<detail::name_key_t> senders;    /**< dictionary: name of sender id */
+    std::vector<uint32_t> sender_ids;           /**< sender id of every message */
+    std::string texts;                          /**< texts of all messages back to back */
+    std::vector<uint32_t> text_offsets;         /**< text i is [text_offsets[i], text_offsets[i + 1]) of texts; size is msgs + 1 */
+    detail::name_index_t sender_index;          /**< sender id of name */
+
+    // Number of messages
+    size_t size() const { return sender_ids.size(); }
+
+    std::string_view sender(uint32_t id) const {
+        return std::string_view(senders[id].data(), senders[id].size());
+    }
+
+    // Sender id of name, detail::name_index_t::npos if it has no messages
+    uint32_t sender_id(std::string_view name) const {
+        return name.size() <= MSGR_NAME_LEN_MAX ? sender_index.find(detail::name_key_t(name.data(), name.size())) : detail::name_index_t::npos;
+    }
+
+    std::string_view name(size_t i) const { return sender(sender_ids[i]); }
+
+    std::string_view text(size_t i) const {
+        return std::string_view(texts.data() + text_offsets[i], text_offsets[i + 1] - text_offsets[i]);
+    }
+
+    // Copy of message i
+    msg_t msg(size_t i) const {
+        return msg_t(std::string(name(i)), std::string(text(i)));
+    }
+
+    // Forget messages & dictionary (capacity is kept)
+    void clear() {
+        senders.clear();
+        sender_ids.clear();
+        texts.clear();
+        text_offsets.clear();
+        sender_index.clear();
+    }
+};
+
+/**
+ * Encode messages into one contiguous buffer with table of message offsets
+ *
+ * @param beg first message
+ * @param end end of messages
+ * @param out output batch, previous content is replaced (its capacity is reused)
+ * @param opts encoding options
+ *
+ * @note every message is encoded, as append_buff would do.
+ *       Without compression buffer is sized exactly, before any message is written.
+ *       throws std::length_error on same conditions as make_buff, out is left empty then
+ *
+ * @sample
+ *
+ * messenger::msg_batch_t batch = messenger::make_buff_batch(msgs.data(), msgs.data() + msgs.size());
+ * send(fd, batch.buff.data(), batch.buff.size(), 0);
+*/
+void make_buff_batch(const msg_t *beg, const msg_t *end, msg_batch_t &out, const buff_opts_t &opts = buff_opts_t());
+
+msg_batch_t make_buff_batch(const msg_t *beg, const msg_t *end, const buff_opts_t &opts = buff_opts_t());
+
+msg_batch_t make_buff_batch(const std::vector<msg_t> &msgs, const buff_opts_t &opts = buff_opts_t());
+
+/**
+ * Decode batch of messages in one pass into shared storage
+ *
+ * @param beg beginning of buffer
+ * @param offsets offsets table: message i is [beg + offsets[i], beg + offsets[i + 1])
+ * @param offsets_num size of offsets table (number of messages + 1, or 0)
+ * @param out output, previous content is replaced (its capacity is reused)
+ *
+ * @note throws on same conditions as parse_buff, or std::runtime_error if offsets are not ascending,
+ *       out is left empty then
+*/
+void parse_batch(const uint8_t *beg, const size_t *offsets, size_t offsets_num, parsed_batch_t &out);
+
+// Same, throws std::out_of_range if offsets exceed batch.buff, out is left empty then
+void parse_batch(const msg_batch_t &batch, parsed_batch_t &out);
+
+parsed_batch_t parse_batch(const msg_batch_t &batch);
+
+/**
+ * Decode batch of messages in one pass, appending them to columns
+ *
+ * @param beg beginning of buffer
+ * @param offsets offsets table: message i is [beg + offsets[i], beg + offsets[i + 1])
+ * @param offsets_num size of offsets table (number of messages + 1, or 0)
+ * @param out output, messages are appended, senders keep their ids
+ *
+ * @note texts are copied from packet payloads straight into out.texts (compressed ones are inflated).
+ *       throws on same conditions as parse_batch, or std::length_error if texts exceed 4 GiB,
+ *       out is left as it was then
+ *
+ * @sample
+ *
+ * messenger::columnar_batch_t cols;
+ * messenger::append_columnar(batch, cols);
+ *
+ * std::vector<size_t> bytes_by_sender(cols.senders.size());
+ * for(size_t i = 0; i < cols.size(); ++i)
+ *     bytes_by_sender[cols.sender_ids[i]] += cols.text_offsets[i + 1] - cols.text_offsets[i];
+*/
+void append_columnar(const uint8_t *beg, const size_t *offsets, size_t offsets_num, columnar_batch_t &out);
+
+// Same, throws std::out_of_range if offsets exceed batch.buff, out is left as it was then
+void append_columnar(const msg_batch_t &batch, columnar_batch_t &out);
+
+columnar_batch_t parse_columnar(const msg_batch_t &batch);
+
+} // namespace messenger
+
+#endif
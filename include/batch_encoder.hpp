@@ -0,0 +1,117 @@
+#ifndef MESSENGER_BATCH_ENCODER_H
+#define MESSENGER_BATCH_ENCODER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "messenger.hpp"
+#include "queue.hpp"
+
+namespace messenger {
+
+/**
+ * Configuration of batch_encoder_t
+*/
+struct batch_config_t
+{
+    size_t max_batch_msgs = 1024;                   /**< messages encoded into single batch at most */
+    size_t max_batch_bytes = 64 * 1024;             /**< batch is handed to sink once it exceeds this size */
+    std::chrono::microseconds max_latency{200};     /**< time, for which first message of batch may wait */
+};
+
+/**
+ * Statistics of batch_encoder_t
+*/
+struct batch_stats_t
+{
+    size_t batches = 0;     /**< number of sink calls */
+    size_t msgs = 0;        /**< number of encoded messages */
+    size_t bytes = 0;       /**< number of encoded bytes */
+};
+
+/**
+ * Coalesce messages of many producer threads into large contiguous buffers
+ *
+ * @details Messages are submitted into lock-free MPSC queue. Single writer thread drains it
+ *          and encodes messages back to back (as make_buff would do) into one buffer,
+ *          which is handed to sink. Writer waits at most max_latency for batch to fill up.
+ *
+ * @sample
+ *
+ * messenger::batch_encoder_t enc([&](const uint8_t *beg, const uint8_t *end, size_t msg_num) {
+ *     write(fd, beg, end - beg);
+ * });
+ *
+ * // from any thread
+ * enc.submit( messenger::msg_t("Timur", "Hi") );
+*/
+class batch_encoder_t {
+
+public:
+    /**
+     * Receiver of encoded batch
+     *
+     * @param beg beginning of batch buffer
+     * @param end end of batch buffer
+     * @param msg_num number of messages in batch
+     *
+     * @note buffer is reused by writer after sink returns
+    */
+    using sink_t = std::function<void(const uint8_t *beg, const uint8_t *end, size_t msg_num)>;
+
+    batch_encoder_t(sink_t sink, batch_config_t config = batch_config_t());
+
+    batch_encoder_t(const batch_encoder_t &) = delete;
+    batch_encoder_t &operator=(const batch_encoder_t &) = delete;
+
+    // Delivers all submitted messages and stops writer
+    ~batch_encoder_t();
+
+    /**
+     * Submit message for encoding. Thread-safe.
+     *
+     * @note throws std::length_error on same conditions as make_buff (in caller's thread)
+    */
+    void submit(msg_t msg);
+
+    /**
+     * Block until queue is drained and every submitted message is handed to sink
+     *
+     * @note with producers constantly submitting, waits till they pause
+    */
+    void flush();
+
+    batch_stats_t stats();
+
+private:
+    void writer_loop();
+    // Encode and hand to sink everything currently in queue
+    void drain();
+
+    sink_t m_sink;
+    batch_config_t m_config;
+
+    util::mpsc_queue_t<msg_t> m_queue;
+    std::atomic<size_t> m_pending;  // submitted, but not yet handed to sink
+
+    std::vector<uint8_t> m_buff;    // batch buffer, touched by writer only
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake_cv;      // wakes writer
+    std::condition_variable m_flush_cv;     // wakes flush waiters
+    bool m_flush_req;       // guarded by m_mutex
+    bool m_stop;            // guarded by m_mutex
+    batch_stats_t m_stats;  // guarded by m_mutex
+
+    std::thread m_writer;
+};
+
+} // namespace messenger
+
+#endif
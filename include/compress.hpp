@@ -0,0 +1,59 @@
+#ifndef MESSENGER_COMPRESS_H
+#define MESSENGER_COMPRESS_H
+
+#include <cstdint>
+#include <string>
+
+namespace messenger::detail {
+
+/**
+ * Compress bytes with LZ77 codec
+ *
+ * @details Layout follows LZ4 block: sequence is token (4 bits of literal length, 4 bits of
+ *          match length - 4), extra length bytes, literals, 2-byte little endian offset, extra
+ *          match length bytes. Last sequence has literals only.
+ *
+ * @param beg beginning of input
+ * @param end end of input
+ * @param out output, compressed bytes are appended
+*/
+void lz_compress(const uint8_t *beg, const uint8_t *end, std::string &out);
+
+/**
+ * Decompress bytes, produced by lz_compress
+ *
+ * @param beg beginning of compressed bytes
+ * @param end end of input (may exceed compressed bytes)
+ * @param raw_len length of original input
+ * @param out output, decompressed bytes are appended
+ * @return end of consumed compressed bytes
+ *
+ * @note throws std::runtime_error on corrupted input, output is left untouched then
+*/
+const uint8_t *lz_decompress(const uint8_t *beg, const uint8_t *end, size_t raw_len, std::string &out);
+
+/**
+ * Seal text into compressed envelope: raw length (LEB128) followed by compressed text
+ *
+ * @details Envelope, which would fill its last packet, gets pad byte: compressed message
+ *          always ends with packet, which is not full, so it is never ambiguous.
+ *
+ * @param text text to compress
+ * @param env output envelope, overwritten
+*/
+void seal_envelope(const std::string &text, std::string &env);
+
+/**
+ * Open compressed envelope
+ *
+ * @param beg beginning of envelope
+ * @param end end of envelope
+ * @param text output text, overwritten
+ *
+ * @note throws std::runtime_error on corrupted or truncated envelope
+*/
+void open_envelope(const char *beg, const char *end, std::string &text);
+
+} // namespace messenger::detail
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef MESSENGER_ENCODE_CACHE_H
+#define MESSENGER_ENCODE_CACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "messenger.hpp"
+
+namespace messenger {
+
+namespace detail {
+
+struct encode_cache_shard_t;
+
+} // namespace detail
+
+/**
+ * Configuration of encode_cache_t
+*/
+struct encode_cache_config_t
+{
+    size_t max_bytes = 16 * 1024 * 1024;    /**< budget of cached messages (encoded buffers & keys) */
+    size_t shards = 16;                     /**< number of independently locked shards */
+    buff_opts_t encoding;                   /**< encoding of cached buffers */
+};
+
+/**
+ * Statistics of encode_cache_t
+*/
+struct encode_cache_stats_t
+{
+    size_t hits = 0;            /**< encodes served from cache */
+    size_t misses = 0;          /**< encodes, which had to encode message */
+    size_t evicted = 0;         /**< entries evicted to keep byte budget */
+    size_t entries = 0;         /**< number of cached messages */
+    size_t bytes = 0;           /**< size of cached messages */
+
+    double hit_rate() const { return hits + misses != 0 ? static_cast<double>(hits) / (hits + misses) : 0; }
+};
+
+/**
+ * Cache of encoded buffers of repeated messages (heartbeats, statuses)
+ *
+ * @details Messages are keyed by 64-bit hash of name & text (hardware CRC32C), hit is confirmed
+ *          by comparing name & text. Cache is split into shards by hash, every shard has own
+ *          lock, LRU list & share of byte budget, so concurrent encodes rarely contend.
+ *
+ *          Buffer is immutable and shared: hit costs hash, compare & reference count increment,
+ *          no encoding, CRC or allocation. Evicted buffer lives until its last user releases it.
+ *
+ * @sample
+ *
+ * messenger::encode_cache_t cache;
+ *
+ * // from any thread
+ * messenger::encode_cache_t::buff_ptr_t buff = cache.encode(messenger::msg_t("Node7", "status: OK"));
+ * send(fd, buff->data(), buff->size(), 0);
+*/
+class encode_cache_t {
+
+public:
+    using buff_ptr_t = std::shared_ptr<const std::vector<uint8_t>>;
+
+    /**
+     * @note throws std::invalid_argument, if shards is 0
+    */
+    encode_cache_t(encode_cache_config_t config = encode_cache_config_t());
+
+    encode_cache_t(const encode_cache_t &) = delete;
+    encode_cache_t &operator=(const encode_cache_t &) = delete;
+
+    ~encode_cache_t();
+
+    /**
+     * Encoded buffer of message, same as make_buff(msg, encoding) would return. Thread-safe.
+     *
+     * @note message, which alone exceeds shard's budget, is encoded, but not cached.
+     *       throws std::length_error on same conditions as make_buff
+    */
+    buff_ptr_t encode(const msg_t &msg);
+
+    // Forget every message, counters are kept
+    void clear();
+
+    encode_cache_stats_t stats() const;
+
+private:
+    detail::encode_cache_shard_t &shard(uint64_t hash) const;
+
+    encode_cache_config_t m_config;
+    std::vector<std::unique_ptr<detail::encode_cache_shard_t>> m_shards;
+};
+
+} // namespace messenger
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef MESSENGER_LAZY_MSG_H
+#define MESSENGER_LAZY_MSG_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "messenger.hpp"
+#include "msg_hdr.hpp"
+
+namespace messenger {
+
+/**
+ * Lazily decoded message: packets stay encoded in shared buffer, until text is accessed
+ *
+ * @details Construction validates message as parse_buff does (framing, CRC4, CRC32C, names of
+ *          packets), but copies nothing except sender's name. Text is assembled on first
+ *          text() call, or streamed to sink piece by piece, straight from msg fields.
+ *          Handle keeps reference to buffer, so it can be stored or passed on to other
+ *          threads, and its packets forwarded as they are.
+ *
+ * @sample
+ *
+ * messenger::lazy_msg_t::buff_ptr_t buff = std::make_shared<const std::vector<uint8_t>>(recv_msg(fd));
+ * messenger::lazy_msg_t msg(buff);
+ *
+ * if(msg.name() == "Audit")
+ *     msg.stream_text([&](std::string_view piece) { log.write(piece.data(), piece.size()); });
+ * else
+ *     forward(msg.begin(), msg.end());
+*/
+class lazy_msg_t {
+
+public:
+    using buff_ptr_t = std::shared_ptr<const std::vector<uint8_t>>;
+    using sink_t = std::function<void(std::string_view piece)>;
+
+    // Empty handle
+    lazy_msg_t() = default;
+
+    /**
+     * Validate single message, which is whole buffer
+     *
+     * @note throws on same conditions as parse_buff, except corrupted compressed envelope,
+     *       which is reported by text access
+    */
+    explicit lazy_msg_t(buff_ptr_t buff);
+
+    /**
+     * Validate single message, which is [beg, end) of buffer (e.g. message of msg_batch_t)
+     *
+     * @note throws std::out_of_range, if range is outside of buffer, otherwise as lazy_msg_t(buff)
+    */
+    lazy_msg_t(buff_ptr_t buff, size_t beg, size_t end);
+
+    bool empty() const { return m_buff == nullptr; }
+
+    std::string_view name() const { return std::string_view(m_name, m_name_len); }
+
+    // Whether text is carried compressed: its length is known after assembly only
+    bool compressed() const { return m_compressed; }
+
+    // Length of msg fields of text packets (length of text, unless compressed)
+    size_t payload_size() const { return m_payload_len; }
+
+    /**
+     * Text, assembled on first call and kept by handle
+     *
+     * @note throws std::runtime_error, if compressed envelope is corrupted.
+     *       First call modifies handle: handle is not thread-safe, copies of it are independent
+    */
+    const std::string &text() const;
+
+    // Whether text is already assembled
+    bool assembled() const { return m_assembled; }
+
+    /**
+     * Pass text to sink, without assembling it: one piece per packet, or whole inflated text
+     *
+     * @note throws on same conditions as text()
+    */
+    void stream_text(const sink_t &sink) const;
+
+    // Copy of message
+    msg_t msg() const { return msg_t(std::string(name()), text()); }
+
+    // Encoded packets of message, valid while buffer is alive
+    const uint8_t *begin() const { return m_buff->data() + m_beg; }
+    const uint8_t *end() const { return m_buff->data() + m_end; }
+
+    const buff_ptr_t &buff() const { return m_buff; }
+
+private:
+    buff_ptr_t m_buff;
+    size_t m_beg = 0;
+    size_t m_end = 0;
+    size_t m_text_beg = 0;          // offset of first text packet (past CRC32C packet)
+    size_t m_payload_len = 0;
+    char m_name[MSGR_NAME_LEN_MAX] = {};
+    uint8_t m_name_len = 0;
+    bool m_compressed = false;
+
+    mutable bool m_assembled = false;
+    mutable std::string m_text;
+};
+
+} // namespace messenger
+
+#endif
@@ -62,6 +62,25 @@ struct msg_t
 };
 
 
+/**
+ * Options of encoding
+ *
+ * @note compression & CRC32C are opt-in: decoders handle them transparently,
+ *       but peers built before them would reject their packets (flag bits 110 & 111)
+ *
+ * CRC32C of message is carried by extra packet, which leads message: protocol ends message
+ * with its first non-full packet, so trailing packet could not be told from next message.
+ * CRC32C covers msg fields of all other packets (i.e. compressed envelope, not inflated text),
+ * and catches corruption, which CRC4 of single packet misses.
+ */
+struct buff_opts_t
+{
+	bool compress = false;				/**< compress text into LZ envelope, if it saves bytes */
+	size_t compress_threshold = 128;	/**< texts shorter than it are sent plain */
+	bool crc32c = false;				/**< lead message with CRC32C packet */
+};
+
+
 /**
  * Prepare raw message buffer from specified message
  *
@@ -83,6 +102,64 @@ struct msg_t
 std::vector<uint8_t> make_buff(const msg_t & msg);
 
 
+/**
+ * Prepare raw message buffer from specified message, using encoding options
+ *
+ * @param msg message sender's name & message text
+ * @param opts encoding options
+ * @return buffer with prepared message packets
+ *
+ * @note throws std::length_error on same conditions as make_buff(msg)
+*/
+std::vector<uint8_t> make_buff(const msg_t & msg, const buff_opts_t & opts);
+
+
+/**
+ * Calculate exact size of raw message buffer, which make_buff produces for specified message
+ *
+ * @param msg message sender's name & message text
+ * @return size of raw message buffer in bytes
+ *
+ * @note throws std::length_error on same conditions as make_buff
+*/
+size_t buff_size(const msg_t & msg);
+
+
+/**
+ * Write raw message buffer of specified message into preallocated memory
+ *
+ * @param msg message sender's name & message text
+ * @param out beginning of output, has to fit at least buff_size(msg) bytes
+ * @return end of written raw message buffer
+ *
+ * @note throws std::length_error on same conditions as make_buff
+*/
+uint8_t *write_buff(const msg_t & msg, uint8_t *out);
+
+
+/**
+ * Append raw message buffer of specified message to the end of output buffer
+ *
+ * @param msg message sender's name & message text
+ * @param out output buffer, grown exactly by buff_size(msg) bytes
+ *
+ * @note throws std::length_error on same conditions as make_buff, output is left untouched then
+*/
+void append_buff(const msg_t & msg, std::vector<uint8_t> & out);
+
+
+/**
+ * Append raw message buffer of specified message, using encoding options
+ *
+ * @param msg message sender's name & message text
+ * @param out output buffer
+ * @param opts encoding options
+ *
+ * @note throws std::length_error on same conditions as make_buff, output is left untouched then
+*/
+void append_buff(const msg_t & msg, std::vector<uint8_t> & out, const buff_opts_t & opts);
+
+
 /**
 * Parse specified raw message buffer to get original message
 *
@@ -93,10 +170,38 @@ std::vector<uint8_t> make_buff(const msg_t & msg);
 *	- FLAG;
 *	- CRC4.
 * If their value will be incorrect throw std::runtime_error
+*
+* Compressed message is inflated, corrupted envelope throws std::runtime_error.
+* Message led by CRC32C packet is checked, mismatch throws std::runtime_error
 */
 msg_t parse_buff(std::vector<uint8_t> & buff);
 
 
+/**
+* Parse raw message buffer, lying in contiguous memory [beg, end)
+*
+* @param beg beginning of raw message buffer
+* @param end end of raw message buffer
+* @return parsed message
+*
+* @note throws on same conditions as parse_buff(buff)
+*/
+msg_t parse_buff(const uint8_t *beg, const uint8_t *end);
+
+
+/**
+* Parse raw message buffer into existing message, reusing capacity of its name & text
+*
+* @param beg beginning of raw message buffer
+* @param end end of raw message buffer
+* @param out parsed message, previous content is replaced
+*
+* @note decoding of plain message into target of sufficient capacity does no allocations.
+*       Throws on same conditions as parse_buff(buff), content of out is unspecified then
+*/
+void parse_buff(const uint8_t *beg, const uint8_t *end, msg_t & out);
+
+
 }	// namespace messenger
 
 #endif // !TASK1_MESSENGER_HPP
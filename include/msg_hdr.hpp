@@ -1,12 +1,17 @@
 #ifndef MSG_HDR_H
 #define MSG_HDR_H
 
+#include <array>
 #include <vector>
 #include <cstdint>
 
 #include "util.hpp"
 
 #define FLAG_BITS 0x5
+// Flag of packets, which carry compressed envelope instead of plain text
+#define COMPRESSED_FLAG_BITS 0x6
+// Flag of packet, which leads message and carries CRC32C of msg fields of its other packets
+#define CRC32C_FLAG_BITS 0x7
 
 #define MSGR_FLAG_BITS 3
 #define MSGR_FLAG_MAX BITS_TO_RANGE(MSGR_FLAG_BITS)
@@ -86,9 +91,10 @@ public:
 
     msg_hdr_mod_t(
         uint8_t *pos, uint8_t name_len, 
-        uint8_t msg_len, uint8_t crc4_val
+        uint8_t msg_len, uint8_t crc4_val,
+        uint8_t flag = FLAG_BITS
     ): msg_hdr_view_t(pos) { 
-        set_flag(FLAG_BITS);
+        set_flag(flag);
         set_name_len(name_len);
         set_msg_len(msg_len);
         set_crc4(crc4_val);
@@ -121,6 +127,78 @@ public:
 // Definition of HEADER_SIZE is here, because msg_hdr_view_t::hdr_raw_t is not in scope yet
 const size_t HEADER_SIZE = sizeof(msg_hdr_view_t::hdr_raw_t);
 
+/**
+ * Everything, that can be decoded from 16 bits of header, packed into 32 bits
+ *
+ * @details Entry of header table, indexed by header as little endian uint16_t.
+ *          One load replaces shifts & masks of msg_hdr_view_t and crc4 of header.
+*/
+class hdr_info_t {
+
+private:
+    uint32_t m_bits;
+
+    // Bit positions within m_bits
+    static const unsigned CRC4_STATE_SHIFT = 0;     // 4 bits
+    static const unsigned CRC4_SHIFT = 4;           // 4 bits
+    static const unsigned MSG_LEN_SHIFT = 8;        // 5 bits
+    static const unsigned NAME_LEN_SHIFT = 13;      // 4 bits
+    static const unsigned SIZE_SHIFT = 17;          // 6 bits
+    static const unsigned FLAG_OK_SHIFT = 23;       // 1 bit
+    static const unsigned VALID_SHIFT = 24;         // 1 bit
+    static const unsigned COMPRESSED_SHIFT = 25;    // 1 bit
+    static const unsigned CHECKSUM_SHIFT = 26;      // 1 bit
+
+    static constexpr bool is_flag_ok(uint8_t flag) {
+        return flag == FLAG_BITS || flag == COMPRESSED_FLAG_BITS || flag == CRC32C_FLAG_BITS;
+    }
+
+public:
+    constexpr hdr_info_t(): m_bits(0) {}
+
+    constexpr hdr_info_t(uint8_t flag, uint8_t name_len, uint8_t msg_len, uint8_t crc4, uint8_t crc4_state)
+        : m_bits(
+            static_cast<uint32_t>(crc4_state) << CRC4_STATE_SHIFT
+            | static_cast<uint32_t>(crc4) << CRC4_SHIFT
+            | static_cast<uint32_t>(msg_len) << MSG_LEN_SHIFT
+            | static_cast<uint32_t>(name_len) << NAME_LEN_SHIFT
+            | static_cast<uint32_t>(HEADER_SIZE + name_len + msg_len) << SIZE_SHIFT
+            | static_cast<uint32_t>(is_flag_ok(flag)) << FLAG_OK_SHIFT
+            | static_cast<uint32_t>(is_flag_ok(flag) && name_len != 0 && msg_len != 0) << VALID_SHIFT
+            | static_cast<uint32_t>(flag == COMPRESSED_FLAG_BITS) << COMPRESSED_SHIFT
+            | static_cast<uint32_t>(flag == CRC32C_FLAG_BITS) << CHECKSUM_SHIFT
+        ) {}
+
+    // Flag bits are valid (plain, compressed or CRC32C)
+    inline bool flag_ok() const { return (m_bits >> FLAG_OK_SHIFT) & 1; }
+    // Packet carries part of compressed envelope
+    inline bool compressed() const { return (m_bits >> COMPRESSED_SHIFT) & 1; }
+    // Packet carries CRC32C of message instead of text
+    inline bool checksum() const { return (m_bits >> CHECKSUM_SHIFT) & 1; }
+    // Flag bits are valid, name & msg are not empty
+    inline bool valid() const { return (m_bits >> VALID_SHIFT) & 1; }
+
+    inline uint8_t name_len() const { return (m_bits >> NAME_LEN_SHIFT) & MASK_FIRST_N(MSGR_NAME_LEN_BITS); }
+    inline uint8_t msg_len() const { return (m_bits >> MSG_LEN_SHIFT) & MASK_FIRST_N(MSGR_MSG_LEN_BITS); }
+    // Size of whole packet
+    inline uint8_t size() const { return (m_bits >> SIZE_SHIFT) & MASK_FIRST_N(6); }
+    // CRC4 stored in header
+    inline uint8_t crc4() const { return (m_bits >> CRC4_SHIFT) & MASK_FIRST_N(MSGR_CRC4_BITS); }
+    // CRC4 state after header with nullified CRC4 bits (msg_hdr_view_t::calculate_crc4)
+    inline uint8_t crc4_state() const { return (m_bits >> CRC4_STATE_SHIFT) & MASK_FIRST_N(MSGR_CRC4_BITS); }
+
+};
+
+const size_t HDR_TABLE_SIZE = 1 << (HEADER_SIZE * BITS_PER_BYTE);
+
+// Header table: info of every possible header, built at compile time
+extern const std::array<hdr_info_t, HDR_TABLE_SIZE> hdr_table;
+
+// Info of header at pos
+inline const hdr_info_t &hdr_info(const uint8_t *pos) {
+    return hdr_table[pos[0] | (pos[1] << BITS_PER_BYTE)];
+}
+
 } // namespace messenger::detail
 
 
@@ -0,0 +1,102 @@
+#ifndef MESSENGER_NAME_TABLE_H
+#define MESSENGER_NAME_TABLE_H
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "msg_hdr.hpp"
+
+namespace messenger::detail {
+
+/**
+ * Sender's name, stored inline as fixed 16 bytes: length followed by zero padded name
+*/
+struct name_key_t
+{
+    uint8_t bytes[1 + MSGR_NAME_LEN_MAX];
+
+    name_key_t() {
+        std::memset(bytes, 0, sizeof(bytes));
+    }
+
+    name_key_t(const char *name, size_t name_len) {
+        assertm(name_len <= MSGR_NAME_LEN_MAX, "name_key_t: name is too long");
+
+        std::memset(bytes, 0, sizeof(bytes));
+        bytes[0] = static_cast<uint8_t>(name_len);
+        std::memcpy(bytes + 1, name, name_len);
+    }
+
+    inline size_t size() const { return bytes[0]; }
+    inline const char *data() const { return reinterpret_cast<const char *>(bytes + 1); }
+
+    inline bool operator==(const name_key_t &other) const {
+        return std::memcmp(bytes, other.bytes, sizeof(bytes)) == 0;
+    }
+
+    inline bool operator!=(const name_key_t &other) const {
+        return !(*this == other);
+    }
+
+    // Hash of all 16 bytes
+    uint64_t hash() const;
+};
+
+static_assert(sizeof(name_key_t) == 16, "name_key_t: key has to be 16 bytes");
+
+/**
+ * Flat open-addressing map from sender's name to 32-bit value
+ *
+ * @details Keys are stored inline in slots, collisions are resolved by linear probing,
+ *          erased slots become tombstones. Table grows (rehashes) to keep load under 3/4.
+ *          Rehash, which just purges tombstones, reuses memory of previous table,
+ *          so steady insert & erase churn does not allocate.
+ *          Typical use is index into separate array of per-sender entries.
+*/
+class name_index_t {
+
+public:
+    static const uint32_t npos = UINT32_MAX;
+
+    name_index_t();
+
+    // Value of key, npos if not present
+    uint32_t find(const name_key_t &key) const;
+
+    /**
+     * Insert key, which is not present yet
+     *
+     * @note value can not be npos or npos - 1
+    */
+    void insert(const name_key_t &key, uint32_t value);
+
+    // Erase key, if present
+    void erase(const name_key_t &key);
+
+    void clear();
+
+    inline size_t size() const { return m_size; }
+
+private:
+    static const uint32_t EMPTY = npos;
+    static const uint32_t TOMBSTONE = npos - 1;
+
+    struct slot_t {
+        name_key_t key;
+        uint32_t value;
+    };
+
+    // Slot of key, or npos
+    size_t find_slot(const name_key_t &key) const;
+    void rehash(size_t slot_num);
+
+    std::vector<slot_t> m_slots;    // size is power of 2
+    std::vector<slot_t> m_spare;    // previous table, reused by rehash
+    size_t m_size;                  // keys
+    size_t m_used;                  // keys & tombstones
+};
+
+} // namespace messenger::detail
+
+#endif
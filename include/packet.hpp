@@ -0,0 +1,194 @@
+#ifndef MESSENGER_PACKET_H
+#define MESSENGER_PACKET_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#include "messenger.hpp"
+#include "msg_hdr.hpp"
+
+namespace messenger::detail {
+
+const size_t MAX_PACKET_SIZE = HEADER_SIZE + MSGR_NAME_LEN_MAX + MSGR_MSG_LEN_MAX;
+
+// Size of msg field of CRC32C packet
+const size_t CRC32C_LEN = sizeof(uint32_t);
+
+/**
+ * Read-only view of packet, lying in contiguous memory
+ *
+ * @note view does not own packet bytes, and does not validate them.
+ *       Use view_packet to get view of validated packet
+*/
+class packet_view_t {
+
+private:
+    const uint8_t *m_beg;
+
+public:
+    explicit packet_view_t(const uint8_t *beg): m_beg(beg) {
+        assertm(beg != NULL, "packet_view_t: empty pointer is passed");
+    }
+
+    inline uint8_t name_len() const {
+        return hdr_info(m_beg).name_len();
+    }
+
+    inline uint8_t msg_len() const {
+        return hdr_info(m_beg).msg_len();
+    }
+
+    // Whether msg field is part of compressed envelope
+    inline bool compressed() const {
+        return hdr_info(m_beg).compressed();
+    }
+
+    // Whether packet is CRC32C packet, leading message
+    inline bool checksum() const {
+        return hdr_info(m_beg).checksum();
+    }
+
+    // CRC32C carried by CRC32C packet (little endian msg field)
+    inline uint32_t crc32c() const {
+        uint32_t res;
+        std::memcpy(&res, msg(), sizeof(res));
+        return res;
+    }
+
+    // Beginning of name field (not null-terminated)
+    inline const char *name() const {
+        return reinterpret_cast<const char *>(m_beg + HEADER_SIZE);
+    }
+
+    // Beginning of msg field (not null-terminated)
+    inline const char *msg() const {
+        return name() + name_len();
+    }
+
+    // Beginning of packet
+    inline const uint8_t *begin() const {
+        return m_beg;
+    }
+
+    // End of packet
+    inline const uint8_t *end() const {
+        return m_beg + size();
+    }
+
+    inline size_t size() const {
+        return hdr_info(m_beg).size();
+    }
+
+};
+
+/**
+ * Size of packet, as indicated by its header
+ *
+ * @param hdr beginning of packet, has to contain at least HEADER_SIZE bytes
+ *
+ * @note header is not validated
+*/
+size_t packet_size(const uint8_t *hdr);
+
+/**
+ * Write text as packets of name
+ *
+ * @param crc32c if not NULL, CRC32C of text is accumulated into it, while text is written
+ * @param padded copy fields by fixed-width accesses: util::PADDING bytes after packets are clobbered
+ * @return end of written packets
+*/
+uint8_t *write_packets(const std::string &name, const std::string &text, uint8_t flag, uint8_t *out,
+                       uint32_t *crc32c = NULL, bool padded = false);
+
+// Write CRC32C packet of name, returns end of written packet
+uint8_t *write_crc32c_packet(const std::string &name, uint32_t crc32c, uint8_t *out);
+
+/**
+ * Encoding of message with options
+*/
+struct encoding_t
+{
+    const std::string *payload;     /**< text or its compressed envelope */
+    uint8_t flag;                   /**< flag bits of text packets */
+    size_t lead_size;               /**< size of leading CRC32C packet, 0 if there is none */
+    size_t size;                    /**< size of whole encoded message */
+};
+
+/**
+ * Choose encoding of message: compress text into env, if it pays off
+ *
+ * @note throws std::length_error on same conditions as make_buff
+*/
+encoding_t plan_encoding(const msg_t &msg, const buff_opts_t &opts, std::string &env);
+
+// Write message as planned, out has to fit enc.size bytes (& util::PADDING more, if padded)
+uint8_t *write_encoding(const msg_t &msg, const encoding_t &enc, uint8_t *out, bool padded = false);
+
+/**
+ * Validate packet lying at the beginning of buffer
+ *
+ * @param beg beginning of buffer
+ * @param end end of buffer (can exceed single packet)
+ * @return view of validated packet
+ *
+ * @note throws std::runtime_error, if buffer does not contain enough bytes for packet,
+ *       flag bits, CRC4 or size of CRC32C packet are invalid. Throws std::length_error, if name or msg is empty
+*/
+packet_view_t view_packet(const uint8_t *beg, const uint8_t *end);
+
+/**
+ * State of message, which is assembled from several packets
+*/
+struct msg_state_t
+{
+    size_t packets = 0;                 /**< number of accepted packets */
+    char name[MSGR_NAME_LEN_MAX] = {};  /**< sender's name, set by first packet */
+    uint8_t name_len = 0;
+    size_t text_len = 0;                /**< length of msg fields of accepted text packets */
+    bool compressed = false;            /**< text packets carry compressed envelope */
+    bool checked = false;               /**< message is led by CRC32C packet */
+    uint32_t crc32c_expected = 0;       /**< CRC32C carried by leading packet */
+    uint32_t crc32c = 0;                /**< CRC32C of msg fields accepted so far */
+};
+
+/**
+ * Check packet against message, which is assembled from several packets, and update its state
+ *
+ * @param packet validated packet
+ * @param state state of message, default constructed before first packet
+ * @return whether msg field of packet is part of text (false for CRC32C packet)
+ *
+ * @note throws std::runtime_error, if sender's name or compression does not match previous packets,
+ *       or CRC32C packet does not lead message
+*/
+bool accept_packet(const packet_view_t &packet, msg_state_t &state);
+
+/**
+ * Check, that message, which packets are accepted, is complete & intact
+ *
+ * @note throws std::runtime_error, if message has no text or CRC32C does not match
+*/
+void check_msg_state(const msg_state_t &state);
+
+/**
+ * Append packet's text to message, which is assembled from several packets
+ *
+ * @param packet validated packet
+ * @param msg message assembled so far (name is set by first packet)
+ * @param state state of message, default constructed before first packet
+ *
+ * @note throws on same conditions as accept_packet
+*/
+void append_packet(const packet_view_t &packet, msg_t &msg, msg_state_t &state);
+
+/**
+ * Finish message, assembled by append_packet: check it, inflate text of compressed message
+ *
+ * @note throws on same conditions as check_msg_state, or if compressed envelope is corrupted
+*/
+void finish_msg(msg_t &msg, const msg_state_t &state);
+
+} // namespace messenger::detail
+
+#endif
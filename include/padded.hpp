@@ -0,0 +1,133 @@
+#ifndef MESSENGER_PADDED_H
+#define MESSENGER_PADDED_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include "messenger.hpp"
+
+namespace messenger::util {
+
+/**
+ * Slack, which padded buffers keep readable & writable past their end: fits whole msg field
+ * (MSGR_MSG_LEN_MAX) or name field (MSGR_NAME_LEN_MAX), copied by single fixed-width access
+*/
+constexpr size_t PADDING = 32;
+
+// Copy 16 bytes: one vector load & store, both ranges have to be accessible for 16 bytes
+inline void copy16(void *dst, const void *src) {
+    std::memcpy(dst, src, 16);
+}
+
+// Copy 32 bytes: one or two vector loads & stores, both ranges have to be accessible for 32 bytes
+inline void copy32(void *dst, const void *src) {
+    std::memcpy(dst, src, 32);
+}
+
+/**
+ * Byte buffer, which storage is 64-byte aligned and always has PADDING bytes of slack after size
+ *
+ * @details Slack is zeroed, when storage is allocated, but encoders & decoders scribble over it:
+ *          its content is unspecified. Growth is geometric, content is preserved.
+ *
+ * @sample
+ *
+ * messenger::util::padded_buffer_t buff;
+ * messenger::append_buff(msg, buff);
+ * messenger::parse_buff(buff, msg);
+*/
+class padded_buffer_t {
+
+public:
+    static const size_t ALIGNMENT = 64;
+
+    padded_buffer_t() = default;
+
+    // Copy of range
+    padded_buffer_t(const uint8_t *beg, const uint8_t *end);
+
+    padded_buffer_t(const padded_buffer_t &other);
+    padded_buffer_t &operator=(const padded_buffer_t &other);
+
+    // Moved-from buffer is empty, without storage
+    padded_buffer_t(padded_buffer_t &&other) noexcept;
+    padded_buffer_t &operator=(padded_buffer_t &&other) noexcept;
+
+    uint8_t *data() { return m_data.get(); }
+    const uint8_t *data() const { return m_data.get(); }
+
+    uint8_t *begin() { return data(); }
+    uint8_t *end() { return data() + m_size; }
+    const uint8_t *begin() const { return data(); }
+    const uint8_t *end() const { return data() + m_size; }
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    // Bytes, which fit without reallocation (slack is not counted)
+    size_t capacity() const { return m_capacity; }
+
+    void reserve(size_t capacity);
+
+    // New bytes are unspecified
+    void resize(size_t size);
+
+    void clear() { m_size = 0; }
+
+    void append(const uint8_t *beg, const uint8_t *end);
+
+private:
+    struct free_t {
+        void operator()(uint8_t *ptr) const;
+    };
+
+    std::unique_ptr<uint8_t[], free_t> m_data;
+    size_t m_size = 0;
+    size_t m_capacity = 0;
+};
+
+} // namespace messenger::util
+
+namespace messenger {
+
+/**
+ * Write raw message buffer with fixed-width copies of fields
+ *
+ * @param msg message sender's name & message text
+ * @param out beginning of output: buff_size(msg) + util::PADDING bytes have to be writable
+ * @return end of written buffer; bytes up to util::PADDING after it are clobbered
+ *
+ * @note output is same as write_buff produces. Text is read by 32-byte loads, while 32 bytes
+ *       remain in it, last piece is copied exactly (string has no padding).
+ *       throws std::length_error on same conditions as make_buff
+*/
+uint8_t *write_buff_padded(const msg_t &msg, uint8_t *out);
+
+/**
+ * Append raw message buffer to padded buffer, with fixed-width copies of fields
+ *
+ * @note output is same as append_buff produces. CRC32C packet is written exactly, compression
+ *       is applied as append_buff does. throws std::length_error on same conditions as make_buff,
+ *       output is left untouched then
+*/
+void append_buff(const msg_t &msg, util::padded_buffer_t &out, const buff_opts_t &opts = buff_opts_t());
+
+/**
+ * Parse raw message buffer with fixed-width copies of fields
+ *
+ * @param beg beginning of raw message buffer
+ * @param end end of raw message buffer: util::PADDING bytes after it have to be readable
+ * @param out decoded message (its capacity is reused)
+ *
+ * @note throws on same conditions as parse_buff. Caller, which can not guarantee padding of input,
+ *       has to use parse_buff
+*/
+void parse_buff_padded(const uint8_t *beg, const uint8_t *end, msg_t &out);
+
+void parse_buff(const util::padded_buffer_t &buff, msg_t &out);
+
+} // namespace messenger
+
+#endif
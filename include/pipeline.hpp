@@ -0,0 +1,136 @@
+#ifndef MESSENGER_PIPELINE_H
+#define MESSENGER_PIPELINE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "packet.hpp"
+#include "reassembler.hpp"
+
+namespace messenger {
+
+namespace detail {
+
+struct pipeline_shard_t;
+
+} // namespace detail
+
+/**
+ * Configuration of pipeline_t
+*/
+struct pipeline_config_t
+{
+    size_t workers = 4;                 /**< number of worker threads */
+    size_t shards_per_worker = 4;       /**< senders are hashed to workers * shards_per_worker shards */
+    size_t queue_batches = 64;          /**< capacity of shard's queue, in batches */
+    size_t batch_bytes = 16 * 1024;     /**< batch is queued to its shard, once it exceeds this size */
+    bool steal = true;                  /**< idle workers process shards of busy ones */
+    reassembler_config_t reassembler;   /**< configuration of every shard's reassembler_t */
+};
+
+/**
+ * Statistics of pipeline_t
+*/
+struct pipeline_stats_t
+{
+    reassembler_stats_t reassembly;     /**< sum over shards */
+    size_t batches = 0;                 /**< number of processed batches */
+    size_t stolen = 0;                  /**< number of batches, processed by other worker than shard's own one */
+};
+
+/**
+ * Decode packet stream on several cores, keeping order of every sender's messages
+ *
+ * @details Framing stage (caller of feed) splits stream into packets and hashes sender's
+ *          name to one of shards, appending packet into shard's batch. Full batches are handed
+ *          to shards through bounded lock-free SPSC queues; empty ones come back the same way,
+ *          so steady state does not allocate.
+ *
+ *          Every shard owns reassembler_t, which checks CRC4 / CRC32C, reassembles & delivers
+ *          messages of its senders. Shard is processed by at most one worker at a time, in
+ *          queue order, so messages of one sender are delivered in order. Each worker owns
+ *          shards_per_worker shards; idle worker steals whole shards with queued batches from
+ *          busy workers, so several hot senders spread over cores (single sender is never split).
+ *
+ *          Idle workers expire partial messages of idle senders of their own shards.
+ *
+ * @note feed, flush & drain have to be called from single thread.
+ *       deliver is called from worker threads (and from flush caller): concurrently for
+ *       senders of different shards, never concurrently for one sender. deliver must not throw.
+ *
+ * @sample
+ *
+ * messenger::pipeline_t pipeline([&](std::string_view name, std::string_view text, messenger::reassembly_reason_t) {
+ *     store.add(name, text);  // thread-safe
+ * });
+ *
+ * while((len = read(fd, chunk, sizeof(chunk))) > 0)
+ *     pipeline.feed(chunk, chunk + len);
+ * pipeline.flush();
+*/
+class pipeline_t {
+
+public:
+    pipeline_t(reassembler_t::deliver_t deliver, pipeline_config_t config = pipeline_config_t());
+
+    pipeline_t(const pipeline_t &) = delete;
+    pipeline_t &operator=(const pipeline_t &) = delete;
+
+    // Processes all fed packets and stops workers; partial messages are not delivered
+    ~pipeline_t();
+
+    /**
+     * Feed next chunk of packet stream
+     *
+     * @note packet may be split across chunks. Waits for workers, while shard's queue is full.
+     *       Invalid flag bits break framing of stream: std::runtime_error is thrown
+    */
+    void feed(const uint8_t *beg, const uint8_t *end);
+
+    // Block until every fed packet is processed by workers
+    void drain();
+
+    // Drain, then deliver every partial message
+    void flush();
+
+    // Drains first, so counters include every fed packet
+    pipeline_stats_t stats();
+
+    size_t shards() const { return m_shards.size(); }
+
+private:
+    // Queue shard's pending batch, waiting for space
+    void submit(detail::pipeline_shard_t &shard);
+    void worker_loop(size_t worker);
+    // Process queued batches of shard, if no other worker does; returns whether anything was processed
+    bool process_shard(detail::pipeline_shard_t &shard, bool stolen);
+    // Expire idle senders of worker's own shards, which no other worker processes
+    void expire_shards(size_t worker);
+
+    pipeline_config_t m_config;
+    std::vector<std::unique_ptr<detail::pipeline_shard_t>> m_shards;
+
+    // Beginning of packet, which is split across chunks
+    uint8_t m_carry[detail::MAX_PACKET_SIZE];
+    size_t m_carry_len;
+
+    std::atomic<size_t> m_inflight;     // queued, but not yet processed batches
+    std::atomic<size_t> m_submits;      // number of queued batches ever, workers sleep till it changes
+    std::atomic<size_t> m_sleepers;     // workers waiting for batches
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake_cv;      // wakes workers
+    std::condition_variable m_drain_cv;     // wakes drain waiters
+    bool m_stop;                            // guarded by m_mutex
+
+    std::vector<std::thread> m_workers;
+};
+
+} // namespace messenger
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef MESSENGER_QUEUE_H
+#define MESSENGER_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace messenger::util {
+
+/**
+ * mpsc_queue_t - unbounded lock-free multi-producer single-consumer queue.
+ *
+ * @details Implementation of Dmitry Vyukov's intrusive MPSC node-based queue.
+ *          Any number of threads may push concurrently, only one thread may pop.
+ *          push is wait-free (single atomic exchange), pop is lock-free.
+ *          ref: https://www.1024cores.net/home/lock-free-algorithms/queues/non-intrusive-mpsc-node-based-queue
+ *
+ * @note T has to be default constructible (stub node holds value of T)
+*/
+template<typename T>
+class mpsc_queue_t {
+
+private:
+    struct node_t {
+        std::atomic<node_t *> next;
+        T value;
+
+        node_t(): next(nullptr) {}
+        node_t(T &&val): next(nullptr), value(std::move(val)) {}
+    };
+
+    std::atomic<node_t *> m_head;   // last pushed node, touched by producers
+    node_t *m_tail;                 // stub node, touched by consumer only
+
+public:
+    mpsc_queue_t(): m_head(new node_t()) {
+        m_tail = m_head.load(std::memory_order_relaxed);
+    }
+
+    mpsc_queue_t(const mpsc_queue_t &) = delete;
+    mpsc_queue_t &operator=(const mpsc_queue_t &) = delete;
+
+    ~mpsc_queue_t() {
+        T tmp;
+        while(pop(tmp)) {}
+        delete m_tail;
+    }
+
+    // Thread-safe for any number of producers
+    void push(T val) {
+        node_t *node = new node_t(std::move(val));
+        node_t *prev = m_head.exchange(node, std::memory_order_acq_rel);
+        // Between exchange and store consumer sees queue as shorter, never as broken
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    /**
+     * Pop oldest value. Has to be called by single consumer.
+     *
+     * @return false, if queue is empty (or producer is in the middle of push)
+    */
+    bool pop(T &out) {
+        node_t *tail = m_tail;
+        node_t *next = tail->next.load(std::memory_order_acquire);
+        if(next == nullptr)
+            return false;
+
+        out = std::move(next->value);
+        // next becomes new stub
+        m_tail = next;
+        delete tail;
+
+        return true;
+    }
+
+};
+
+/**
+ * spsc_queue_t - bounded lock-free single-producer single-consumer ring queue.
+ *
+ * @details Values live in preallocated ring of power of 2 slots, so push & pop never allocate.
+ *          Head & tail are on separate cache lines; each side caches index of the other one
+ *          and rereads it only when ring looks full (empty), so uncontended push & pop touch
+ *          no shared cache line but their own slot.
+ *
+ * @note producer & consumer may change between threads, as long as handover between them
+ *       is synchronized (e.g. by lock), so at most one thread pushes and one pops at a time.
+ *       T has to be default constructible & movable
+*/
+template<typename T>
+class spsc_queue_t {
+
+private:
+    std::vector<T> m_slots;
+    size_t m_mask;
+
+    alignas(64) std::atomic<size_t> m_head;     // next slot to push, written by producer
+    size_t m_tail_cache;                        // producer's view of m_tail
+
+    alignas(64) std::atomic<size_t> m_tail;     // next slot to pop, written by consumer
+    size_t m_head_cache;                        // consumer's view of m_head
+
+public:
+    // capacity is rounded up to power of 2
+    explicit spsc_queue_t(size_t capacity)
+        : m_head(0)
+        , m_tail_cache(0)
+        , m_tail(0)
+        , m_head_cache(0)
+    {
+        if(capacity == 0)
+            throw std::invalid_argument("messenger: spsc_queue_t: capacity can not be 0");
+
+        size_t slot_num = 1;
+        while(slot_num < capacity)
+            slot_num <<= 1;
+
+        m_slots.resize(slot_num);
+        m_mask = slot_num - 1;
+    }
+
+    spsc_queue_t(const spsc_queue_t &) = delete;
+    spsc_queue_t &operator=(const spsc_queue_t &) = delete;
+
+    size_t capacity() const { return m_slots.size(); }
+
+    /**
+     * Push value. Has to be called by single producer.
+     *
+     * @return false, if queue is full (val is left untouched then)
+    */
+    bool push(T &val) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if(head - m_tail_cache == m_slots.size()) {
+            m_tail_cache = m_tail.load(std::memory_order_acquire);
+            if(head - m_tail_cache == m_slots.size())
+                return false;
+        }
+
+        m_slots[head & m_mask] = std::move(val);
+        m_head.store(head + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    /**
+     * Pop oldest value. Has to be called by single consumer.
+     *
+     * @return false, if queue is empty
+    */
+    bool pop(T &out) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if(tail == m_head_cache) {
+            m_head_cache = m_head.load(std::memory_order_acquire);
+            if(tail == m_head_cache)
+                return false;
+        }
+
+        out = std::move(m_slots[tail & m_mask]);
+        m_tail.store(tail + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // Whether queue looks empty; exact only for consumer
+    bool empty() const {
+        return m_tail.load(std::memory_order_acquire) == m_head.load(std::memory_order_acquire);
+    }
+
+};
+
+} // namespace messenger::util
+
+#endif
@@ -0,0 +1,168 @@
+#ifndef MESSENGER_REASSEMBLER_H
+#define MESSENGER_REASSEMBLER_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "name_table.hpp"
+#include "packet.hpp"
+
+namespace messenger {
+
+/**
+ * Reason of message delivery by reassembler_t
+*/
+enum class reassembly_reason_t
+{
+    complete,   /**< last packet was not full (msg_len < MSGR_MSG_LEN_MAX) */
+    flush,      /**< flush was requested */
+    idle,       /**< no packets of sender for idle_timeout */
+    evict,      /**< partial message was evicted due to memory cap */
+    cut         /**< partial message was cut short by next message of sender (CRC32C packet, or switch of compression) */
+};
+
+/**
+ * Configuration of reassembler_t
+*/
+struct reassembler_config_t
+{
+    size_t max_bytes = 64 * 1024 * 1024;                /**< cap of buffered partial texts */
+    std::chrono::steady_clock::duration idle_timeout = std::chrono::seconds(1);
+    size_t max_kept_capacity = 4096;                    /**< text buffers above it are released on reuse */
+};
+
+/**
+ * Statistics of reassembler_t
+*/
+struct reassembler_stats_t
+{
+    size_t packets = 0;         /**< number of accepted packets */
+    size_t msgs = 0;            /**< number of delivered messages (any reason) */
+    size_t dropped = 0;         /**< number of packets dropped due to invalid CRC4 or empty fields */
+    size_t evicted = 0;         /**< number of partial messages evicted due to memory cap */
+    size_t cut = 0;             /**< number of partial messages cut short by next message of sender */
+    size_t undecodable = 0;     /**< number of compressed messages, which could not be inflated */
+    size_t crc32c_failed = 0;   /**< number of messages dropped, as their text does not match CRC32C */
+    size_t senders = 0;         /**< number of senders with partial message */
+    size_t bytes = 0;           /**< size of buffered partial texts */
+};
+
+/**
+ * Reassemble messages of many senders from interleaved packet stream
+ *
+ * @details Partial messages are kept per sender in flat open-addressing table, keyed by
+ *          inline 16-byte name. Text buffers of finished messages are reused by other senders,
+ *          so steady state does no allocations per packet.
+ *
+ *          Protocol has no end-of-message mark: message is complete, once its packet is not full.
+ *          Message, which length is multiple of MSGR_MSG_LEN_MAX, is delivered on flush or on idle timeout.
+ *
+ *          Compressed messages are inflated before delivery; partial compressed message (evicted,
+ *          flushed, or interrupted by plain packet of same sender) can not be inflated and is dropped.
+ *
+ *          Message led by CRC32C packet is checked before delivery, CRC32C is updated as packets
+ *          arrive. Message with mismatching CRC32C (corrupted or partial) is dropped.
+ *
+ *          Packet with invalid CRC4 is dropped together with partial message of its sender.
+ *          Invalid flag bits break framing of stream: std::runtime_error is thrown.
+ *
+ * @sample
+ *
+ * messenger::reassembler_t reasm([](std::string_view name, std::string_view text, messenger::reassembly_reason_t) {
+ *     std::cout << name << ": " << text << std::endl;
+ * });
+ *
+ * reasm.feed(chunk.data(), chunk.data() + chunk.size());
+ * reasm.expire(std::chrono::steady_clock::now());
+*/
+class reassembler_t {
+
+public:
+    using clock_t = std::chrono::steady_clock;
+
+    /**
+     * Receiver of reassembled message
+     *
+     * @note name & text are valid only during call
+    */
+    using deliver_t = std::function<void(std::string_view name, std::string_view text, reassembly_reason_t reason)>;
+
+    reassembler_t(deliver_t deliver, reassembler_config_t config = reassembler_config_t());
+
+    /**
+     * Feed next chunk of packet stream
+     *
+     * @param beg beginning of chunk
+     * @param end end of chunk
+     * @param now time of arrival (used for idle timeout)
+     *
+     * @note packet may be split across chunks
+    */
+    void feed(const uint8_t *beg, const uint8_t *end, clock_t::time_point now = clock_t::now());
+
+    /**
+     * Deliver partial messages, which have no packets since now - idle_timeout
+     *
+     * @return number of delivered messages
+    */
+    size_t expire(clock_t::time_point now);
+
+    // Deliver every partial message
+    void flush();
+
+    // Deliver partial message of sender, if any
+    void flush(const std::string &name);
+
+    reassembler_stats_t stats() const;
+
+private:
+    static const uint32_t NIL = detail::name_index_t::npos;
+
+    struct entry_t {
+        detail::name_key_t key;
+        std::string text;
+        bool compressed;
+        bool checked;               // message is led by CRC32C packet
+        uint32_t crc32c_expected;
+        uint32_t crc32c;            // CRC32C of text so far
+        clock_t::time_point last_seen;
+        // Entries of senders with partial message, sorted by last_seen
+        uint32_t prev;
+        uint32_t next;
+    };
+
+    void process_packet(const detail::packet_view_t &packet, clock_t::time_point now);
+    // Partial message of sender, new one is started if there is none
+    uint32_t acquire_entry(const detail::packet_view_t &packet);
+    void release_entry(uint32_t idx);
+    void deliver_entry(uint32_t idx, reassembly_reason_t reason);
+
+    void lru_unlink(uint32_t idx);
+    void lru_push_back(uint32_t idx);
+
+    deliver_t m_deliver;
+    reassembler_config_t m_config;
+
+    detail::name_index_t m_index;
+    std::vector<entry_t> m_entries;
+    std::vector<uint32_t> m_free;
+    uint32_t m_lru_head;    // least recently updated
+    uint32_t m_lru_tail;    // most recently updated
+
+    // Text of inflated compressed message, reused across messages
+    std::string m_inflated;
+
+    // Beginning of packet, which is split across chunks
+    uint8_t m_carry[detail::MAX_PACKET_SIZE];
+    size_t m_carry_len;
+
+    reassembler_stats_t m_stats;
+};
+
+} // namespace messenger
+
+#endif
@@ -0,0 +1,150 @@
+#ifndef MESSENGER_RECENT_CACHE_H
+#define MESSENGER_RECENT_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include "messenger.hpp"
+#include "name_table.hpp"
+
+namespace messenger {
+
+/**
+ * Configuration of recent_cache_t
+*/
+struct recent_cache_config_t
+{
+    size_t max_bytes = 16 * 1024 * 1024;    /**< budget of stored encoded messages */
+    size_t per_sender = 16;                 /**< messages kept per sender */
+    buff_opts_t encoding;                   /**< encoding of stored messages (e.g. compressed) */
+};
+
+/**
+ * Statistics of recent_cache_t
+*/
+struct recent_cache_stats_t
+{
+    size_t hits = 0;            /**< lookups of cached sender */
+    size_t misses = 0;          /**< lookups of unknown sender */
+    size_t inserts = 0;         /**< number of inserted messages */
+    size_t evicted_msgs = 0;    /**< messages evicted to keep byte budget (ring overwrites excluded) */
+    size_t evicted_senders = 0; /**< senders evicted to keep byte budget */
+    size_t senders = 0;         /**< number of cached senders */
+    size_t msgs = 0;            /**< number of cached messages */
+    size_t bytes = 0;           /**< size of cached encoded messages */
+};
+
+/**
+ * Bounded cache of recent messages of every sender
+ *
+ * @details Messages are kept as their encoded packets (make_buff output) in ring of
+ *          per_sender slots per sender: newest message overwrites oldest, reusing its slot's
+ *          memory unless it is over twice as long. Memory of messages & senders evicted by
+ *          budget is returned. Senders are kept in flat table keyed by inline 16-byte name.
+ *
+ *          Once stored bytes exceed max_bytes, least recently updated senders are evicted
+ *          as whole. Lookups do not refresh recency, so they take only shared lock
+ *          and never block each other.
+ *
+ * @sample
+ *
+ * messenger::recent_cache_t cache;
+ * cache.insert( messenger::msg_t("Timur", "Hi") );
+ *
+ * // from any thread
+ * std::vector<messenger::msg_t> last = cache.recent("Timur", 10);
+*/
+class recent_cache_t {
+
+public:
+    /**
+     * @note throws std::invalid_argument, if per_sender is 0
+    */
+    recent_cache_t(recent_cache_config_t config = recent_cache_config_t());
+
+    recent_cache_t(const recent_cache_t &) = delete;
+    recent_cache_t &operator=(const recent_cache_t &) = delete;
+
+    /**
+     * Store message. Thread-safe.
+     *
+     * @note throws std::length_error on same conditions as make_buff
+    */
+    void insert(const msg_t &msg);
+
+    /**
+     * Store already encoded message. Thread-safe.
+     *
+     * @param beg beginning of raw message buffer of single message
+     * @param end end of raw message buffer
+     *
+     * @note packets are validated: throws on same conditions as parse_buff
+    */
+    void insert_buff(const uint8_t *beg, const uint8_t *end);
+
+    /**
+     * Decode last messages of sender. Thread-safe.
+     *
+     * @param name sender's name
+     * @param n number of messages at most
+     * @param out output, messages are appended from oldest to newest
+     * @return number of appended messages
+    */
+    size_t recent(const std::string &name, size_t n, std::vector<msg_t> &out) const;
+
+    std::vector<msg_t> recent(const std::string &name, size_t n) const;
+
+    // Forget every sender
+    void clear();
+
+    recent_cache_stats_t stats() const;
+
+private:
+    static const uint32_t NIL = detail::name_index_t::npos;
+
+    struct sender_t {
+        detail::name_key_t key;
+        // Ring of encoded messages: slots[head] is oldest, count are in use
+        std::vector<std::vector<uint8_t>> slots;
+        size_t head;
+        size_t count;
+        size_t bytes;
+        // Senders sorted by last update
+        uint32_t prev;
+        uint32_t next;
+    };
+
+    // Store encoded message of sender, exclusive lock has to be held
+    void store(const detail::name_key_t &key, const uint8_t *beg, const uint8_t *end);
+    uint32_t acquire_sender(const detail::name_key_t &key);
+    void release_sender(uint32_t idx);
+    // Storage of slot is kept for overwrite, otherwise released
+    void drop_oldest(sender_t &sender, bool release);
+    void enforce_budget(uint32_t keep);
+
+    void lru_unlink(uint32_t idx);
+    void lru_push_back(uint32_t idx);
+
+    recent_cache_config_t m_config;
+
+    mutable std::shared_mutex m_mutex;
+
+    detail::name_index_t m_index;
+    std::vector<sender_t> m_senders;
+    std::vector<uint32_t> m_free;
+    uint32_t m_lru_head;    // least recently updated
+    uint32_t m_lru_tail;    // most recently updated
+
+    // Guarded by m_mutex (exclusive)
+    recent_cache_stats_t m_stats;
+    // Updated by readers under shared lock
+    mutable std::atomic<size_t> m_hits;
+    mutable std::atomic<size_t> m_misses;
+};
+
+} // namespace messenger
+
+#endif
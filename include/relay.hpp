@@ -0,0 +1,83 @@
+#ifndef MESSENGER_RELAY_H
+#define MESSENGER_RELAY_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace messenger {
+
+/**
+ * Statistics of relay_t pass
+*/
+struct relay_stats_t
+{
+    size_t packets = 0;             /**< number of forwarded packets */
+    size_t renamed = 0;             /**< number of packets with rewritten name */
+    size_t bytes_in = 0;            /**< size of input stream */
+    size_t bytes_out = 0;           /**< size of output stream */
+    size_t crc_bytes_saved = 0;     /**< payload bytes, which CRC4 was updated over without rescanning */
+    size_t copy_bytes_saved = 0;    /**< payload bytes, which were left in place (in-place rewriting) */
+};
+
+/**
+ * Rewrite sender names of packet stream, without decoding messages
+ *
+ * @details Relay walks packets one by one. Packet of renamed sender gets new name and
+ *          header, its CRC4 is updated incrementally (crc4 is linear, see util::crc4_zeros):
+ *          only header and names are scanned, payload is not.
+ *
+ *          CRC4 of packets is not verified: packet, which was corrupted before relay,
+ *          stays corrupted after it (incremental update preserves CRC4 mismatch).
+ *          Flag bits and packet bounds are verified, as they are required for framing.
+ *
+ * @sample
+ *
+ * messenger::relay_t relay;
+ * relay.add_rename("Timur", "Tim");
+ *
+ * std::vector<uint8_t> out;
+ * messenger::relay_stats_t stats = relay.forward(in.data(), in.data() + in.size(), out);
+*/
+class relay_t {
+
+public:
+    /**
+     * Rename every packet of sender from into to
+     *
+     * @note throws std::length_error, if any name is empty or exceeds max length.
+     *       Later rename of same sender overrides previous one
+    */
+    void add_rename(const std::string &from, const std::string &to);
+
+    /**
+     * Rewrite packet stream [beg, end), appending result to output
+     *
+     * @note throws std::runtime_error on invalid flag bits or trimmed packet
+    */
+    relay_stats_t forward(const uint8_t *beg, const uint8_t *end, std::vector<uint8_t> &out) const;
+
+    /**
+     * Rewrite packet stream [beg, end) in place. Payload is neither copied nor rescanned
+     *
+     * @note throws std::invalid_argument, if renaming would change name length,
+     *       std::runtime_error on invalid flag bits or trimmed packet.
+     *       Stream is left partially rewritten then
+    */
+    relay_stats_t rewrite_in_place(uint8_t *beg, uint8_t *end) const;
+
+private:
+    struct rename_t {
+        std::string from;
+        std::string to;
+    };
+
+    // NULL, if sender is not renamed
+    const rename_t *find_rename(const char *name, size_t name_len) const;
+
+    std::vector<rename_t> m_renames;
+};
+
+} // namespace messenger
+
+#endif
@@ -0,0 +1,219 @@
+#ifndef MESSENGER_SEGMENTED_H
+#define MESSENGER_SEGMENTED_H
+
+#include <array>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+
+#if __has_include(<sys/uio.h>)
+#include <sys/uio.h>
+#define MESSENGER_HAS_IOVEC 1
+#endif
+
+#include "messenger.hpp"
+#include "packet.hpp"
+
+namespace messenger {
+
+/**
+ * Contiguous chunk of segmented raw message buffer
+*/
+struct segment_t
+{
+    const uint8_t *data;    /**< beginning of chunk */
+    size_t size;            /**< size of chunk in bytes */
+};
+
+/**
+ * segment_traits - access bytes of segment-like type.
+ *
+ * @details Primary template handles contiguous containers (std::vector, std::string, std::array ...).
+ *          Specialize it to parse from custom segment types.
+*/
+template<typename S>
+struct segment_traits {
+    static const uint8_t *data(const S &seg) {
+        return reinterpret_cast<const uint8_t *>(seg.data());
+    }
+
+    static size_t size(const S &seg) {
+        return seg.size() * sizeof(*seg.data());
+    }
+};
+
+template<>
+struct segment_traits<segment_t> {
+    static const uint8_t *data(const segment_t &seg) { return seg.data; }
+    static size_t size(const segment_t &seg) { return seg.size; }
+};
+
+#ifdef MESSENGER_HAS_IOVEC
+template<>
+struct segment_traits<struct iovec> {
+    static const uint8_t *data(const struct iovec &seg) { return static_cast<const uint8_t *>(seg.iov_base); }
+    static size_t size(const struct iovec &seg) { return seg.iov_len; }
+};
+#endif
+
+/**
+ * Segments of ring buffer's region, which may wrap around end of ring
+ *
+ * @param ring beginning of ring buffer memory
+ * @param capacity size of ring buffer memory
+ * @param head offset of region's beginning (< capacity)
+ * @param len size of region (<= capacity)
+ * @return region's part before wrap & region's part after wrap (empty, if region does not wrap)
+*/
+inline std::array<segment_t, 2> ring_segments(const uint8_t *ring, size_t capacity, size_t head, size_t len) {
+    assertm(head < capacity && len <= capacity, "ring_segments: region exceeds ring");
+
+    size_t first_len = std::min(len, capacity - head);
+    return {{ {ring + head, first_len}, {ring, len - first_len} }};
+}
+
+namespace detail {
+
+/**
+ * Position within sequence of segments
+*/
+template<typename SegIter>
+class segment_cursor_t {
+
+private:
+    using traits = segment_traits<typename std::iterator_traits<SegIter>::value_type>;
+
+    SegIter m_seg;
+    SegIter m_seg_end;
+    size_t m_off;   // offset within *m_seg
+
+    // Keep cursor off exhausted & empty segments
+    void skip_exhausted() {
+        while(m_seg != m_seg_end && m_off == traits::size(*m_seg)) {
+            ++m_seg;
+            m_off = 0;
+        }
+    }
+
+public:
+    segment_cursor_t(SegIter seg_beg, SegIter seg_end)
+        : m_seg(seg_beg), m_seg_end(seg_end), m_off(0)
+    { skip_exhausted(); }
+
+    bool at_end() const {
+        return m_seg == m_seg_end;
+    }
+
+    // Current position (NULL at end)
+    const uint8_t *data() const {
+        return at_end() ? NULL : traits::data(*m_seg) + m_off;
+    }
+
+    // Bytes available at current position without crossing segment
+    size_t contiguous() const {
+        return at_end() ? 0 : traits::size(*m_seg) - m_off;
+    }
+
+    /**
+     * Copy bytes from current position, crossing segments, without advancing
+     *
+     * @return number of copied bytes (less than max_len, if segments end earlier)
+    */
+    size_t peek(uint8_t *out, size_t max_len) const {
+        size_t copied = 0;
+        SegIter seg = m_seg;
+        size_t off = m_off;
+
+        for(; seg != m_seg_end && copied < max_len; ++seg, off = 0) {
+            size_t len = std::min(traits::size(*seg) - off, max_len - copied);
+            std::memcpy(out + copied, traits::data(*seg) + off, len);
+            copied += len;
+        }
+
+        return copied;
+    }
+
+    void advance(size_t len) {
+        while(len != 0) {
+            assertm(!at_end(), "segment_cursor_t: advancing past the end");
+
+            size_t step = std::min(len, contiguous());
+            m_off += step;
+            len -= step;
+            skip_exhausted();
+        }
+    }
+
+};
+
+} // namespace detail
+
+/**
+ * Parse raw message buffer, scattered across sequence of segments
+ *
+ * @param seg_beg first segment (std::vector<uint8_t>, iovec, segment_t, ...)
+ * @param seg_end end of segments
+ * @return parsed message
+ *
+ * @note Packets lying within single segment are parsed in place.
+ *       Packet, crossing segments, is gathered into stack copy of at most MAX_PACKET_SIZE (48) bytes.
+ *       Throws on same conditions as parse_buff
+ *
+ * @sample
+ *
+ * struct iovec iov[2] = { {part1, len1}, {part2, len2} };
+ * messenger::msg_t msg = messenger::parse_segments(iov, iov + 2);
+*/
+template<typename SegIter>
+msg_t parse_segments(SegIter seg_beg, SegIter seg_end) {
+    using traits = segment_traits<typename std::iterator_traits<SegIter>::value_type>;
+
+    detail::segment_cursor_t<SegIter> cursor(seg_beg, seg_end);
+    msg_t res;
+    detail::msg_state_t state;
+
+    // Text is shorter than segments: grow it at most once instead of packet by packet
+    size_t total = 0;
+    for(SegIter seg = seg_beg; seg != seg_end; ++seg)
+        total += traits::size(*seg);
+    res.text.reserve(total);
+
+    do {
+        uint8_t gathered[detail::MAX_PACKET_SIZE];
+        const uint8_t *packet_beg = cursor.data();
+        size_t avail = cursor.contiguous();
+
+        // Packet crosses segment boundary
+        if(avail < detail::HEADER_SIZE || detail::packet_size(packet_beg) > avail) {
+            avail = cursor.peek(gathered, sizeof(gathered));
+            packet_beg = gathered;
+        }
+
+        detail::packet_view_t packet = detail::view_packet(packet_beg, packet_beg + avail);
+        detail::append_packet(packet, res, state);
+
+        cursor.advance(packet.size());
+    } while(!cursor.at_end());
+
+    detail::finish_msg(res, state);
+
+    return res;
+}
+
+/**
+ * Parse raw message buffer, scattered across range of segments
+ *
+ * @sample
+ *
+ * std::list<std::vector<uint8_t>> chunks = ...;
+ * messenger::msg_t msg = messenger::parse_segments(chunks);
+*/
+template<typename SegRange>
+msg_t parse_segments(const SegRange &segments) {
+    return parse_segments(std::begin(segments), std::end(segments));
+}
+
+} // namespace messenger
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef MESSENGER_SENDER_ENCODER_H
+#define MESSENGER_SENDER_ENCODER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "msg_hdr.hpp"
+
+namespace messenger {
+
+/**
+ * Encoder of messages of single sender
+ *
+ * @details Built once per name: name is validated and kept as bytes, CRC4 transition over name
+ *          is tabulated for all 16 CRC4 states, which header may leave. As header depends only on
+ *          msg_len, CRC4 state after header & name is known for full-size and every tail packet,
+ *          so per packet only header and payload are written, and only payload is CRC'd.
+ *
+ *          Output is byte-exact to make_buff.
+ *
+ * @sample
+ *
+ * messenger::sender_encoder_t enc("Timur");
+ * std::vector<uint8_t> buff = enc.make_buff("Hi");
+*/
+class sender_encoder_t {
+
+public:
+    /**
+     * @note throws std::length_error, if name is empty or exceeds max length
+    */
+    explicit sender_encoder_t(const std::string &name);
+
+    std::string name() const;
+
+    // Exact size of encoded text
+    size_t buff_size(size_t text_len) const;
+
+    /**
+     * Write packets of text into preallocated memory
+     *
+     * @param text beginning of text
+     * @param text_len length of text
+     * @param out beginning of output, has to fit at least buff_size(text_len) bytes
+     * @return end of written packets
+     *
+     * @note throws std::length_error, if text is empty
+    */
+    uint8_t *write(const char *text, size_t text_len, uint8_t *out) const;
+
+    // Append packets of text to output (grown exactly once)
+    void append(const std::string &text, std::vector<uint8_t> &out) const;
+
+    std::vector<uint8_t> make_buff(const std::string &text) const;
+
+private:
+    uint8_t m_name[MSGR_NAME_LEN_MAX];
+    uint8_t m_name_len;
+
+    // CRC4 state after name, for every CRC4 state before name
+    uint8_t m_name_crc4[MSGR_CRC4_MAX + 1];
+
+    // Header (with nullified CRC4) & CRC4 state after header & name, for every msg_len
+    uint8_t m_hdr[MSGR_MSG_LEN_MAX + 1][2];
+    uint8_t m_prefix_crc4[MSGR_MSG_LEN_MAX + 1];
+};
+
+} // namespace messenger
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef MESSENGER_SHM_RING_H
+#define MESSENGER_SHM_RING_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+#include "messenger.hpp"
+
+namespace messenger {
+
+namespace detail {
+
+struct shm_ring_header_t;
+
+} // namespace detail
+
+/**
+ * Single-producer single-consumer byte ring in shared memory, for packet exchange between processes
+ *
+ * @details Ring lives in memfd: page of control block followed by data pages. Data pages are
+ *          mapped twice back to back, so any readable or writable span is contiguous in memory:
+ *          producer encodes packets directly into ring (write_buff), consumer views them in place
+ *          (e.g. reassembler_t::feed) even across wrap-around.
+ *
+ *          Waiting sides sleep on process-shared futexes, which are woken only if side is
+ *          actually asleep. Sleep is sliced by poll interval: on every slice liveness of peer
+ *          process is checked, so crashed peer turns into std::runtime_error instead of hang.
+ *
+ *          One process (or thread) produces, one consumes. fd can be passed to other process
+ *          by fork or by SCM_RIGHTS.
+ *
+ * @note Linux only (memfd_create, futex)
+ *
+ * @sample
+ *
+ * messenger::shm_ring_t ring = messenger::shm_ring_t::create(1 << 20);
+ * if(fork() == 0) {
+ *     ring.set_role(messenger::shm_ring_t::role_t::producer);
+ *     ring.write(messenger::msg_t("Timur", "Hi"));
+ *     ring.close();
+ *     _exit(0);
+ * }
+ *
+ * ring.set_role(messenger::shm_ring_t::role_t::consumer);
+ * messenger::reassembler_t reasm(deliver);
+ * while(const uint8_t *data = ring.read(len)) {
+ *     reasm.feed(data, data + len);
+ *     ring.release(len);
+ * }
+*/
+class shm_ring_t {
+
+public:
+    enum class role_t
+    {
+        producer,
+        consumer
+    };
+
+    using clock_t = std::chrono::steady_clock;
+
+    /**
+     * Create ring in new memfd
+     *
+     * @param capacity size of data, rounded up to power of 2 pages
+     *
+     * @note throws std::system_error, if memory can not be created or mapped
+    */
+    static shm_ring_t create(size_t capacity);
+
+    /**
+     * Map existing ring
+     *
+     * @param fd descriptor of ring's memfd (duplicated, caller keeps ownership)
+     *
+     * @note throws std::system_error, if fd can not be mapped, std::runtime_error if it is not ring
+    */
+    static shm_ring_t attach(int fd);
+
+    shm_ring_t(shm_ring_t &&other) noexcept;
+    shm_ring_t &operator=(shm_ring_t &&other) noexcept;
+
+    shm_ring_t(const shm_ring_t &) = delete;
+    shm_ring_t &operator=(const shm_ring_t &) = delete;
+
+    ~shm_ring_t();
+
+    int fd() const { return m_fd; }
+    size_t capacity() const { return m_capacity; }
+
+    /**
+     * Register calling process as producer or consumer, so peer can check its liveness
+     *
+     * @note has to be called in process, which is going to use the side
+    */
+    void set_role(role_t role);
+
+    /**
+     * Reserve contiguous writable span, waiting for consumer to free space
+     *
+     * @param len size of span, at most capacity
+     * @param timeout time to wait at most
+     * @return beginning of span, NULL on timeout
+     *
+     * @note throws std::runtime_error, if consumer is gone
+    */
+    uint8_t *reserve(size_t len, clock_t::duration timeout = clock_t::duration::max());
+
+    // Publish first len bytes of reserved span
+    void commit(size_t len);
+
+    /**
+     * Encode message directly into ring
+     *
+     * @return false on timeout, message is not written then
+     *
+     * @note throws std::length_error on same conditions as make_buff, std::runtime_error if consumer is gone
+    */
+    bool write(const msg_t &msg, clock_t::duration timeout = clock_t::duration::max());
+
+    // Mark end of stream: consumer drains ring and then gets NULL from read
+    void close();
+
+    /**
+     * Wait for published bytes
+     *
+     * @param len output, number of readable contiguous bytes
+     * @param timeout time to wait at most
+     * @return beginning of readable bytes; NULL on timeout (len is 0) or at end of stream
+     *
+     * @note throws std::runtime_error, if producer is gone without close
+    */
+    const uint8_t *read(size_t &len, clock_t::duration timeout = clock_t::duration::max());
+
+    // Free first len bytes of readable span
+    void release(size_t len);
+
+    // Whether producer has closed stream
+    bool closed() const;
+
+    // Interval of liveness checks of peer while waiting
+    static const std::chrono::milliseconds POLL_INTERVAL;
+
+private:
+    shm_ring_t(int fd, bool init, size_t capacity);
+
+    void unmap();
+    // Throws, if peer of role is registered and its process is gone
+    void check_peer(role_t peer) const;
+
+    int m_fd;
+    size_t m_capacity;
+    detail::shm_ring_header_t *m_hdr;
+    uint8_t *m_data;        // data mapped twice: [m_data, m_data + 2 * m_capacity)
+};
+
+} // namespace messenger
+
+#endif
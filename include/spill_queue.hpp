@@ -0,0 +1,168 @@
+#ifndef MESSENGER_SPILL_QUEUE_H
+#define MESSENGER_SPILL_QUEUE_H
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "messenger.hpp"
+
+namespace messenger {
+
+/**
+ * Configuration of spill_queue_t
+*/
+struct spill_queue_config_t
+{
+    size_t memory_limit = 64 * 1024 * 1024;         /**< high-water mark of queued bytes in memory, then bytes spill to file */
+    size_t disk_limit = 1024ull * 1024 * 1024;      /**< queued bytes in file at most, then push is rejected */
+    size_t segment_size = 4 * 1024 * 1024;          /**< size of mapped file windows, rounded up to pages */
+    std::string dir;                                /**< directory of temporary file, empty - $TMPDIR or /tmp */
+    buff_opts_t encoding;                           /**< encoding of pushed messages */
+};
+
+/**
+ * Statistics of spill_queue_t
+*/
+struct spill_queue_stats_t
+{
+    size_t memory_bytes = 0;    /**< queued bytes in memory */
+    size_t disk_bytes = 0;      /**< queued bytes in file */
+    size_t pushed_bytes = 0;    /**< accepted bytes */
+    size_t spilled_bytes = 0;   /**< accepted bytes, which were written into file */
+    size_t replayed_bytes = 0;  /**< released bytes, which were read from file */
+    size_t rejected = 0;        /**< pushes rejected by disk_limit */
+};
+
+/**
+ * Bounded queue of encoded packet bytes, which spills to temporary file under backpressure
+ *
+ * @details Bytes are queued in memory chunks, until memory_limit is reached. Then they are
+ *          appended to unlinked temporary file through mapped window, and so are all next bytes,
+ *          until file part is drained: memory part always precedes file part, so bytes are read
+ *          in order they were pushed. Read file bytes are replayed in place from mapped window,
+ *          whole consumed segments are punched out of file. Once file is drained, its blocks are
+ *          given back, queue returns to memory and next spill writes file from its beginning.
+ *
+ *          One thread pushes, one thread reads. Lock guards only bookkeeping: encoding, copies,
+ *          allocation of file blocks, mapping of windows & punching are done outside of it, so
+ *          spilling producer does not stall consumer. Chunks are recycled, so steady state
+ *          memory queueing does not allocate.
+ *
+ * @note Linux only (O_TMPFILE, fallocate)
+ *
+ * @sample
+ *
+ * messenger::spill_queue_t queue;
+ * if(!queue.push(msg))
+ *     shed(msg);                           // disk_limit reached
+ *
+ * // consumer
+ * size_t len;
+ * while(const uint8_t *data = queue.read(len)) {
+ *     size_t sent = ::send(fd, data, len, MSG_DONTWAIT);
+ *     queue.release(sent);
+ * }
+*/
+class spill_queue_t {
+
+public:
+    /**
+     * @note throws std::system_error, if temporary file can not be created,
+     *       std::invalid_argument if memory_limit or segment_size is 0
+    */
+    explicit spill_queue_t(spill_queue_config_t config = spill_queue_config_t());
+
+    spill_queue_t(const spill_queue_t &) = delete;
+    spill_queue_t &operator=(const spill_queue_t &) = delete;
+
+    ~spill_queue_t();
+
+    /**
+     * Queue bytes, e.g. make_buff output
+     *
+     * @return false, if bytes would exceed disk_limit, nothing is queued then
+     *
+     * @note throws std::system_error, if file can not be grown or mapped
+    */
+    bool push(const uint8_t *beg, const uint8_t *end);
+
+    /**
+     * Encode message directly into queue
+     *
+     * @note throws std::length_error on same conditions as make_buff
+    */
+    bool push(const msg_t &msg);
+
+    /**
+     * Oldest queued bytes
+     *
+     * @param len output, number of readable contiguous bytes
+     * @return beginning of readable bytes, NULL if queue is empty (len is 0)
+     *
+     * @note bytes are valid until release
+    */
+    const uint8_t *read(size_t &len);
+
+    // Free first len bytes of readable span
+    void release(size_t len);
+
+    // Number of queued bytes
+    size_t size() const;
+    bool empty() const { return size() == 0; }
+
+    spill_queue_stats_t stats() const;
+
+private:
+    struct chunk_t
+    {
+        std::vector<uint8_t> data;
+        size_t beg = 0;             // first unread byte
+        size_t end = 0;             // first unwritten byte
+    };
+
+    // Writable span of len bytes in memory or file (disk), NULL if disk_limit is reached
+    uint8_t *reserve(size_t len, bool &disk);
+    // Publish reserved span
+    void commit(size_t len, bool disk);
+
+    // Under lock
+    uint8_t *reserve_memory(size_t len);
+    // Outside of lock, tail is file offset of span
+    uint8_t *reserve_disk(uint64_t tail, size_t len);
+
+    // Map window of file at offset, at least len bytes long
+    uint8_t *map_window(uint64_t offset, size_t len, uint8_t *&map, uint64_t &map_off, size_t &map_len);
+    void unmap_window(uint8_t *&map, size_t &map_len);
+
+    spill_queue_config_t m_config;
+    int m_fd;
+
+    mutable std::mutex m_mutex;
+
+    // Guarded by m_mutex
+    std::deque<chunk_t> m_chunks;       // memory part, producer writes past end of last chunk
+    std::vector<chunk_t> m_spare;       // drained chunks for reuse
+    uint64_t m_disk_head = 0;           // file offset of first unread byte
+    uint64_t m_disk_tail = 0;           // file offset of first unwritten byte
+    uint64_t m_punched = 0;             // file is punched out up to offset
+    bool m_punching = false;            // consumer punches file, producer does not rewind it
+    spill_queue_stats_t m_stats;
+
+    // Producer's
+    uint8_t *m_wmap = NULL;
+    uint64_t m_wmap_off = 0;
+    size_t m_wmap_len = 0;
+    std::string m_env;                  // compressed text, reused
+
+    // Consumer's
+    uint8_t *m_rmap = NULL;
+    uint64_t m_rmap_off = 0;
+    size_t m_rmap_len = 0;
+};
+
+} // namespace messenger
+
+#endif
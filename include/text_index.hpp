@@ -0,0 +1,131 @@
+#ifndef MESSENGER_TEXT_INDEX_H
+#define MESSENGER_TEXT_INDEX_H
+
+#include <cstdint>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "batch.hpp"
+#include "messenger.hpp"
+
+namespace messenger {
+
+/**
+ * Configuration of text_index_t
+*/
+struct text_index_config_t
+{
+    buff_opts_t encoding;       /**< encoding of stored messages (e.g. compressed) */
+};
+
+/**
+ * Statistics of text_index_t
+*/
+struct text_index_stats_t
+{
+    size_t msgs = 0;            /**< number of indexed messages */
+    size_t text_bytes = 0;      /**< size of indexed texts */
+    size_t stored_bytes = 0;    /**< size of stored encoded messages */
+    size_t trigrams = 0;        /**< number of distinct trigrams */
+    size_t posting_bytes = 0;   /**< size of compressed posting lists */
+};
+
+/**
+ * Incremental trigram index over texts of stored messages, for substring search
+ *
+ * @details Messages are stored as their encoded packets back to back (msg_batch_t) and get
+ *          ids in order of insertion. Every distinct trigram (3 bytes) of text keeps posting
+ *          list of ids, which contain it: ascending ids are delta & varint coded, so posting
+ *          costs about a byte.
+ *
+ *          Query intersects postings of pattern's trigrams, rarest first, then verifies every
+ *          candidate by decoding its packets & searching text. Pattern shorter than trigram
+ *          is verified against every message.
+ *
+ *          Insertion takes exclusive lock, queries take shared one, so index is searched,
+ *          while streaming decode keeps inserting into it.
+ *
+ * @sample
+ *
+ * messenger::text_index_t index;
+ * messenger::reassembler_t reasm([&](std::string_view name, std::string_view text, messenger::reassembly_reason_t) {
+ *     index.insert(messenger::msg_t(std::string(name), std::string(text)));
+ * });
+ *
+ * // from any thread
+ * for(uint32_t id : index.find("deadline"))
+ *     std::cout << index.msg(id).text << std::endl;
+*/
+class text_index_t {
+
+public:
+    text_index_t(text_index_config_t config = text_index_config_t());
+
+    text_index_t(const text_index_t &) = delete;
+    text_index_t &operator=(const text_index_t &) = delete;
+
+    /**
+     * Index & store message. Thread-safe.
+     *
+     * @return id of message
+     *
+     * @note throws std::length_error on same conditions as make_buff
+    */
+    uint32_t insert(const msg_t &msg);
+
+    /**
+     * Index & store already encoded message. Thread-safe.
+     *
+     * @param beg beginning of raw message buffer of single message
+     * @param end end of raw message buffer
+     * @return id of message
+     *
+     * @note buffer is stored as is; throws on same conditions as parse_buff
+    */
+    uint32_t insert_buff(const uint8_t *beg, const uint8_t *end);
+
+    /**
+     * Find messages, which text contains pattern. Thread-safe.
+     *
+     * @param pattern substring to search (bytes, case sensitive)
+     * @param limit number of results at most
+     * @return ids of matching messages, ascending
+    */
+    std::vector<uint32_t> find(std::string_view pattern, size_t limit = SIZE_MAX) const;
+
+    // Decode message of id. Thread-safe. Throws std::out_of_range on unknown id
+    msg_t msg(uint32_t id) const;
+
+    size_t size() const;
+
+    text_index_stats_t stats() const;
+
+private:
+    struct posting_t {
+        std::vector<uint8_t> ids;   // varint deltas of ascending ids, first is id itself
+        uint32_t last = 0;          // last appended id
+        uint32_t count = 0;         // number of ids
+    };
+
+    // Index text of message, which is stored under id; exclusive lock has to be held
+    void index_text(uint32_t id, std::string_view text);
+    // Store encoded message, exclusive lock has to be held
+    uint32_t store(const uint8_t *beg, const uint8_t *end);
+
+    text_index_config_t m_config;
+
+    mutable std::shared_mutex m_mutex;
+
+    msg_batch_t m_store;                                    // encoded messages, message i has id i
+    std::unordered_map<uint32_t, posting_t> m_postings;     // by trigram
+    std::vector<uint32_t> m_grams;                          // trigrams of indexed text, reused
+
+    // Guarded by m_mutex (exclusive)
+    text_index_stats_t m_stats;
+};
+
+} // namespace messenger
+
+#endif
@@ -0,0 +1,162 @@
+#ifndef MESSENGER_TRACE_H
+#define MESSENGER_TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+#include "msg_hdr.hpp"
+
+/**
+ * Static probe points of encoding & decoding
+ *
+ * Built with MESSENGER_TRACE defined (cmake -DMESSENGER_TRACE=ON, make TRACE=1), every
+ * MESSENGER_TRACE_EVENT is:
+ *  - USDT probe messenger:EVENT(name, name_len, size), if <sys/sdt.h> is available:
+ *    single nop, until tracer (bpftrace, perf, systemtap) attaches to it;
+ *  - record of attached trace::recorder_t, if any: otherwise one load & branch.
+ *
+ * Without MESSENGER_TRACE probes compile to nothing.
+*/
+#ifdef MESSENGER_TRACE
+
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define MESSENGER_HAS_SDT 1
+#endif
+#endif
+
+#ifdef MESSENGER_HAS_SDT
+#define MESSENGER_SDT_PROBE(event, name, name_len, size) DTRACE_PROBE3(messenger, event, name, name_len, size)
+#else
+#define MESSENGER_SDT_PROBE(event, name, name_len, size) ((void)0)
+#endif
+
+#define MESSENGER_TRACE_EVENT(event, name, name_len, size)                                          \
+    do {                                                                                            \
+        MESSENGER_SDT_PROBE(event, name, name_len, size);                                           \
+        if(::messenger::trace::recorder_t *trace_recorder_ = ::messenger::trace::attached())        \
+            trace_recorder_->record(::messenger::trace::event_t::event, name, name_len, size);      \
+    } while(0)
+
+#else
+
+#define MESSENGER_TRACE_EVENT(event, name, name_len, size) ((void)0)
+
+#endif
+
+namespace messenger::trace {
+
+// Whether library is built with probe points
+#ifdef MESSENGER_TRACE
+constexpr bool ENABLED = true;
+#else
+constexpr bool ENABLED = false;
+#endif
+
+/**
+ * Probe point
+*/
+enum class event_t : uint8_t
+{
+    encode_packet,      /**< packet is written: size is msg_len */
+    decode_packet,      /**< packet is validated: size is msg_len */
+    crc4_failure,       /**< packet with invalid CRC4 (any packet dropped by reassembler_t): size is packet size */
+    crc32c_failure,     /**< message with mismatching CRC32C: size is length of checked text */
+    flag_failure,       /**< header with invalid flag bits: no name, size is flag bits */
+    msg_complete        /**< message is parsed or delivered: size is text length */
+};
+
+const char *event_name(event_t event);
+
+/**
+ * Recorded event
+*/
+struct record_t
+{
+    uint64_t seq;                       /**< number of event in recorder */
+    uint64_t ns;                        /**< steady clock time, in nanoseconds */
+    event_t event;
+    uint8_t name_len;
+    char name_buf[MSGR_NAME_LEN_MAX];
+    uint32_t size;
+
+    std::string_view name() const { return std::string_view(name_buf, name_len); }
+};
+
+/**
+ * In-process ring buffer of trace events, for offline analysis
+ *
+ * @details Any number of threads record concurrently: slot is claimed by single atomic
+ *          increment, and published by its sequence number (seqlock), so snapshot skips
+ *          slots, which are being overwritten. Oldest events are overwritten, once ring is full.
+ *
+ * @sample
+ *
+ * messenger::trace::recorder_t recorder(1 << 16);
+ * messenger::trace::attach(&recorder);
+ * ...
+ * messenger::trace::attach(NULL);
+ * std::ofstream out("trace.txt");
+ * recorder.dump(out);
+*/
+class recorder_t {
+
+public:
+    // capacity is rounded up to power of 2
+    explicit recorder_t(size_t capacity);
+
+    recorder_t(const recorder_t &) = delete;
+    recorder_t &operator=(const recorder_t &) = delete;
+
+    /**
+     * Record event. Thread-safe, lock-free.
+     *
+     * @note name longer than MSGR_NAME_LEN_MAX is truncated, size above 32 bits is saturated
+    */
+    void record(event_t event, const char *name, size_t name_len, size_t size) noexcept;
+
+    // Events, which are kept in ring, oldest first
+    std::vector<record_t> snapshot() const;
+
+    // Write snapshot as text: "seq ns event name size" per line
+    void dump(std::ostream &out) const;
+
+    // Number of events ever recorded
+    uint64_t recorded() const { return m_next.load(std::memory_order_relaxed); }
+
+    size_t capacity() const { return m_mask + 1; }
+
+private:
+    struct slot_t {
+        std::atomic<uint64_t> seq;          // 2 * idx + 1 while written, 2 * idx + 2 once published
+        std::atomic<uint64_t> words[4];     // ns, event & sizes, name
+    };
+
+    std::unique_ptr<slot_t[]> m_slots;
+    size_t m_mask;
+    alignas(64) std::atomic<uint64_t> m_next;
+};
+
+extern std::atomic<recorder_t *> g_recorder;
+
+/**
+ * Attach recorder to probe points of process, NULL detaches
+ *
+ * @note recorder has to outlive its attachment, including events in flight in other threads
+*/
+void attach(recorder_t *recorder);
+
+// Attached recorder or NULL
+inline recorder_t *attached() {
+    return g_recorder.load(std::memory_order_acquire);
+}
+
+} // namespace messenger::trace
+
+#endif
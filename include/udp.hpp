@@ -0,0 +1,204 @@
+#ifndef MESSENGER_UDP_H
+#define MESSENGER_UDP_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "messenger.hpp"
+
+namespace messenger {
+
+/**
+ * Configuration of udp_sender_t & udp_receiver_t
+*/
+struct udp_config_t
+{
+    size_t datagram_size = 1472;    /**< payload of datagram at most: Ethernet MTU 1500 - IPv4 & UDP headers */
+    size_t batch = 64;              /**< datagrams per sendmmsg / recvmmsg */
+    buff_opts_t encoding;           /**< encoding of sent messages */
+};
+
+/**
+ * Statistics of udp_sender_t & udp_receiver_t
+*/
+struct udp_stats_t
+{
+    size_t msgs = 0;            /**< messages sent or delivered */
+    size_t datagrams = 0;       /**< datagrams sent or received */
+    size_t bytes = 0;           /**< payload bytes of datagrams */
+    size_t syscalls = 0;        /**< sendmmsg, recvmmsg & poll calls */
+    size_t dropped = 0;         /**< received datagrams with invalid packets (rest of datagram is dropped) or truncated */
+};
+
+/**
+ * Owned UDP (IPv4) socket
+ *
+ * @note Linux only (sendmmsg, recvmmsg)
+*/
+class udp_socket_t {
+
+public:
+    /**
+     * Socket, bound to local address
+     *
+     * @param ip dotted IPv4 address, e.g. "127.0.0.1"
+     * @param port port, 0 picks free one
+     *
+     * @note throws std::system_error on failure of socket calls, std::invalid_argument on malformed ip
+    */
+    static udp_socket_t bind(const std::string &ip, uint16_t port = 0);
+
+    // Unbound socket, which is connected to remote address: datagrams are sent there
+    static udp_socket_t connect(const std::string &ip, uint16_t port);
+
+    udp_socket_t(udp_socket_t &&other) noexcept;
+    udp_socket_t &operator=(udp_socket_t &&other) noexcept;
+
+    udp_socket_t(const udp_socket_t &) = delete;
+    udp_socket_t &operator=(const udp_socket_t &) = delete;
+
+    ~udp_socket_t();
+
+    int fd() const { return m_fd; }
+
+    // Local port
+    uint16_t port() const;
+
+    // Request kernel buffer of received datagrams (capped by system limit)
+    void set_recv_buffer(size_t bytes);
+
+private:
+    explicit udp_socket_t(int fd): m_fd(fd) {}
+
+    int m_fd;
+};
+
+/**
+ * Sender of messages, packed into datagrams, in batches
+ *
+ * @details Whole messages are encoded back to back into datagram, until next one does not fit,
+ *          so every datagram is decoded on its own and lost datagram loses only its messages.
+ *          Message, which text (or envelope) length is multiple of MSGR_MSG_LEN_MAX, has no
+ *          end mark (its last packet is full): it closes datagram, so it never merges with next one.
+ *
+ *          Filled datagrams are queued and sent by single sendmmsg, once batch is full or on flush.
+ *
+ * @sample
+ *
+ * messenger::udp_socket_t sock = messenger::udp_socket_t::connect("127.0.0.1", 9000);
+ * messenger::udp_sender_t sender(sock.fd());
+ *
+ * for(const messenger::msg_t &msg : telemetry)
+ *     sender.send(msg);
+ * sender.flush();
+*/
+class udp_sender_t {
+
+public:
+    /**
+     * @param fd connected datagram socket (caller keeps ownership)
+     *
+     * @note throws std::invalid_argument, if datagram can not hold packet of longest name, or batch is 0
+    */
+    udp_sender_t(int fd, udp_config_t config = udp_config_t());
+
+    udp_sender_t(const udp_sender_t &) = delete;
+    udp_sender_t &operator=(const udp_sender_t &) = delete;
+
+    // Sends queued messages; if sendmmsg fails, they are lost
+    ~udp_sender_t();
+
+    /**
+     * Queue message, sends batch of datagrams, if it is full
+     *
+     * @note throws std::length_error on same conditions as make_buff, or if encoded message
+     *       exceeds datagram_size. Throws std::system_error, if sendmmsg fails
+    */
+    void send(const msg_t &msg);
+
+    // Send queued datagrams, including partially filled one
+    void flush();
+
+    udp_stats_t stats() const { return m_stats; }
+
+private:
+    // Finish datagram, which is being filled
+    void close_datagram();
+
+    int m_fd;
+    udp_config_t m_config;
+
+    std::vector<uint8_t> m_buff;        // batch slots of datagram_size
+    std::vector<size_t> m_lens;         // sizes of closed datagrams
+    size_t m_fill = 0;                  // size of datagram, which is being filled (slot m_lens.size())
+    std::vector<::mmsghdr> m_hdrs;
+    std::vector<::iovec> m_iovs;
+    std::string m_env;                  // compressed text, reused
+    udp_stats_t m_stats;
+};
+
+/**
+ * Receiver of datagrams of udp_sender_t, in batches
+ *
+ * @details Every datagram is decoded independently: messages are delivered in order, datagram
+ *          with invalid packet is dropped from that packet on, next datagram is not affected.
+ *          Decoding reuses its message, so steady state receive does not allocate.
+*/
+class udp_receiver_t {
+
+public:
+    /**
+     * Receiver of message
+     *
+     * @note name & text are valid only during call
+    */
+    using deliver_t = std::function<void(std::string_view name, std::string_view text)>;
+
+    /**
+     * @param fd bound datagram socket (caller keeps ownership)
+     *
+     * @note throws std::invalid_argument, if batch is 0
+    */
+    udp_receiver_t(int fd, deliver_t deliver, udp_config_t config = udp_config_t());
+
+    udp_receiver_t(const udp_receiver_t &) = delete;
+    udp_receiver_t &operator=(const udp_receiver_t &) = delete;
+
+    ~udp_receiver_t();
+
+    /**
+     * Receive & decode up to batch datagrams by single recvmmsg
+     *
+     * @param timeout time to wait for first datagram, 0 does not wait
+     * @return number of received datagrams, 0 on timeout
+     *
+     * @note throws std::system_error, if recvmmsg or poll fails
+    */
+    size_t receive(std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+
+    udp_stats_t stats() const { return m_stats; }
+
+private:
+    void decode(const uint8_t *beg, const uint8_t *end);
+
+    int m_fd;
+    deliver_t m_deliver;
+    udp_config_t m_config;
+
+    std::vector<uint8_t> m_buff;        // batch slots of datagram_size
+    std::vector<::mmsghdr> m_hdrs;
+    std::vector<::iovec> m_iovs;
+    msg_t m_msg;                        // reused by decode
+    udp_stats_t m_stats;
+};
+
+} // namespace messenger
+
+#endif
@@ -23,6 +23,12 @@
 #define assertm(exp, msg) assert(((void)(msg), (exp)))
 
 namespace messenger::util {
+
+// crc4 over single nibble for every starting crc4 (polynomial 0b10111), usable at compile time
+inline constexpr uint8_t CRC4_NIBBLE_TAB[16] = {
+    0x0, 0x7, 0xe, 0x9, 0xb, 0xc, 0x5, 0x2,
+    0x1, 0x6, 0xf, 0x8, 0xa, 0xd, 0x4, 0x3,
+};
     
 /**
  * crc4 - calculate the 4-bit crc of a value.
@@ -49,9 +55,42 @@ uint8_t crc4(uint8_t c, uint64_t x, size_t bits);
  */
 uint8_t crc4_range(uint8_t c, const uint8_t *beg, const uint8_t *end);
 
+/**
+ * crc4_zeros - advance crc4 over range of zero bytes.
+ * @c:   starting crc4
+ * @len: number of zero bytes
+ *
+ * Returns crc4_range(@c, zeros, zeros + @len) in O(1) for short ranges.
+ *
+ * As crc4 has no initial and final xor, it is linear: crc4 of xor of two equally long
+ * ranges is xor of their crc4s. Together with crc4_zeros it allows to update crc4
+ * of changed prefix without rescanning unchanged suffix.
+ */
+uint8_t crc4_zeros(uint8_t c, size_t len);
+
 // Calculate crc4 of packet view
 uint8_t crc4_packet(const uint8_t *beg, const uint8_t *end);
 
+/**
+ * crc32c - update CRC32C (Castagnoli) of range of bytes.
+ * @c:   CRC32C of preceding bytes (0 for empty input)
+ * @beg: beginning of range
+ * @end: end of range
+ *
+ * Returns CRC32C of preceding bytes followed by range [@beg, @end), so ranges can be
+ * checksummed one by one: crc32c(crc32c(0, a, b), b, c) == crc32c(0, a, c).
+ *
+ * Uses crc32 instruction of SSE4.2 or ARMv8, if CPU has it (checked once at runtime),
+ * and crc32c_sw otherwise.
+ */
+uint32_t crc32c(uint32_t c, const uint8_t *beg, const uint8_t *end);
+
+// Table driven (slicing-by-8) crc32c, same results as crc32c on any CPU
+uint32_t crc32c_sw(uint32_t c, const uint8_t *beg, const uint8_t *end);
+
+// Name of crc32c implementation, selected for this CPU: "sse4.2", "armv8" or "slicing-by-8"
+const char *crc32c_impl();
+
 /**
  * endian - get endianness of machine
  * 
@@ -0,0 +1,78 @@
+#ifndef MESSENGER_WORKLOAD_H
+#define MESSENGER_WORKLOAD_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "messenger.hpp"
+#include "msg_hdr.hpp"
+
+namespace messenger::workload {
+
+/**
+ * Distribution of lengths: uniform in [min, max], or exponential with mean clamped to [min, max]
+*/
+struct length_dist_t
+{
+    size_t min;
+    size_t max;
+    size_t mean;    /**< 0 for uniform distribution */
+
+    /**
+     * Parse "MIN:MAX" (uniform) or "MIN:MAX:MEAN" (exponential)
+     *
+     * @note throws std::invalid_argument on malformed string
+    */
+    static length_dist_t parse(const std::string &str);
+};
+
+/**
+ * Configuration of synthetic traffic
+*/
+struct config_t
+{
+    size_t senders = 1000;                  /**< number of distinct senders */
+    size_t msgs = 100000;                   /**< number of messages */
+    length_dist_t name_len = {1, MSGR_NAME_LEN_MAX, 0};
+    length_dist_t text_len = {1, 512, 64};
+    size_t vocabulary = 0;                  /**< 0 - random characters, else text of words from vocabulary of such size */
+    double corrupt_ratio = 0.0;             /**< fraction of packets with flipped payload bit */
+    size_t interleave = 1;                  /**< number of messages, which packets interleave (1 - none) */
+    uint64_t seed = 1;
+    buff_opts_t buff_opts;                  /**< encoding of generated traffic */
+};
+
+/**
+ * Generated traffic
+*/
+struct traffic_t
+{
+    std::vector<uint8_t> stream;    /**< packets of all messages */
+    size_t msgs = 0;                /**< number of messages */
+    size_t packets = 0;             /**< number of packets */
+    size_t corrupted = 0;           /**< number of corrupted packets */
+    size_t compressed = 0;          /**< number of messages sent in compressed envelope */
+    size_t text_bytes = 0;          /**< size of all message texts */
+};
+
+/**
+ * Generate messages of synthetic senders
+ *
+ * @note text lengths, which are multiple of MSGR_MSG_LEN_MAX, are avoided:
+ *       otherwise end of message could not be told from stream (see reassembler_t)
+*/
+std::vector<msg_t> generate_msgs(const config_t &config);
+
+/**
+ * Generate packet stream of synthetic traffic
+ *
+ * @note at most one message per sender is in flight, so stream can be decoded by reassembler_t.
+ *       Corruption flips bit of payload, so framing of stream is kept intact.
+ *       throws std::invalid_argument, if senders are fewer than interleaved messages
+*/
+traffic_t generate_traffic(const config_t &config);
+
+} // namespace messenger::workload
+
+#endif
@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "batch.hpp"
+#include "compress.hpp"
+#include "packet.hpp"
+#include "trace.hpp"
+
+namespace messenger {
+
+namespace detail {
+
+// Offsets table has to stay inside buffer (e.g. deserialized batch)
+static bool batch_in_range(const msg_batch_t &batch) {
+    return batch.offsets.empty() || batch.offsets.back() <= batch.buff.size();
+}
+
+// Reserve for appended elements, growing geometrically: batches are appended one by one
+template<typename Container>
+static void reserve_appended(Container &cont, size_t size) {
+    if(size > cont.capacity())
+        cont.reserve(std::max(size, 2 * cont.capacity()));
+}
+
+// Append text of single message to texts, returns its state
+static msg_state_t append_text(const uint8_t *cur, const uint8_t *msg_end, std::string &texts, std::string &inflated) {
+    size_t text_off = texts.size();
+    msg_state_t state;
+
+    do {
+        packet_view_t packet = view_packet(cur, msg_end);
+        if(accept_packet(packet, state))
+            texts.append(packet.msg(), packet.msg_len());
+
+        cur = packet.end();
+    } while(cur != msg_end);
+
+    check_msg_state(state);
+
+    // Envelope is replaced by inflated text in place
+    if(state.compressed) {
+        open_envelope(texts.data() + text_off, texts.data() + texts.size(), inflated);
+        texts.resize(text_off);
+        texts.append(inflated);
+    }
+
+    return state;
+}
+
+} // namespace detail
+
+void make_buff_batch(const msg_t *beg, const msg_t *end, msg_batch_t &out, const buff_opts_t &opts) {
+    out.buff.clear();
+    out.offsets.clear();
+    out.offsets.reserve(end - beg + 1);
+    out.offsets.push_back(0);
+
+    try {
+        if(opts.compress || opts.crc32c) {
+            for(const msg_t *msg = beg; msg != end; ++msg) {
+                append_buff(*msg, out.buff, opts);
+                out.offsets.push_back(out.buff.size());
+            }
+            return;
+        }
+
+        // Sizes are known up front: validate every message & grow buffer once
+        size_t total = 0;
+        for(const msg_t *msg = beg; msg != end; ++msg) {
+            total += buff_size(*msg);
+            out.offsets.push_back(total);
+        }
+
+        out.buff.resize(total);
+
+        uint8_t *pos = out.buff.data();
+        for(const msg_t *msg = beg; msg != end; ++msg)
+            pos = write_buff(*msg, pos);
+    } catch(...) {
+        out.buff.clear();
+        out.offsets.clear();
+        throw;
+    }
+}
+
+msg_batch_t make_buff_batch(const msg_t *beg, const msg_t *end, const buff_opts_t &opts) {
+    msg_batch_t res;
+    make_buff_batch(beg, end, res, opts);
+
+    return res;
+}
+
+msg_batch_t make_buff_batch(const std::vector<msg_t> &msgs, const buff_opts_t &opts) {
+    return make_buff_batch(msgs.data(), msgs.data() + msgs.size(), opts);
+}
+
+void parse_batch(const uint8_t *beg, const size_t *offsets, size_t offsets_num, parsed_batch_t &out) {
+    out.names.clear();
+    out.texts.clear();
+    out.entries.clear();
+
+    if(offsets_num < 2)
+        return;
+
+    size_t msg_num = offsets_num - 1;
+    if(offsets[msg_num] < offsets[0])
+        throw std::runtime_error("messenger: parse_batch: offsets are not ascending");
+
+    // Texts are shorter than buffer, names take at most MSGR_NAME_LEN_MAX per message
+    out.entries.reserve(msg_num);
+    out.texts.reserve(offsets[msg_num] - offsets[0]);
+    out.names.reserve(msg_num * MSGR_NAME_LEN_MAX);
+
+    std::string inflated;
+
+    try {
+        for(size_t i = 0; i < msg_num; ++i) {
+            if(offsets[i + 1] <= offsets[i])
+                throw std::runtime_error("messenger: parse_batch: offsets are not ascending");
+
+            size_t text_off = out.texts.size();
+            detail::msg_state_t state = detail::append_text(beg + offsets[i], beg + offsets[i + 1], out.texts, inflated);
+
+            out.entries.push_back(parsed_batch_t::entry_t{
+                out.names.size(), text_off, out.texts.size() - text_off, state.name_len
+            });
+            out.names.append(state.name, state.name_len);
+            MESSENGER_TRACE_EVENT(msg_complete, state.name, state.name_len, out.entries.back().text_len);
+        }
+    } catch(...) {
+        out.names.clear();
+        out.texts.clear();
+        out.entries.clear();
+        throw;
+    }
+}
+
+void parse_batch(const msg_batch_t &batch, parsed_batch_t &out) {
+    if(!detail::batch_in_range(batch)) {
+        out.names.clear();
+        out.texts.clear();
+        out.entries.clear();
+        throw std::out_of_range("messenger: parse_batch: offsets exceed buffer");
+    }
+
+    parse_batch(batch.buff.data(), batch.offsets.data(), batch.offsets.size(), out);
+}
+
+parsed_batch_t parse_batch(const msg_batch_t &batch) {
+    parsed_batch_t res;
+    parse_batch(batch, res);
+
+    return res;
+}
+
+void append_columnar(const uint8_t *beg, const size_t *offsets, size_t offsets_num, columnar_batch_t &out) {
+    if(offsets_num < 2)
+        return;
+
+    size_t msg_num = offsets_num - 1;
+    if(offsets[msg_num] < offsets[0])
+        throw std::runtime_error("messenger: append_columnar: offsets are not ascending");
+
+    size_t msgs_before = out.sender_ids.size();
+    size_t senders_before = out.senders.size();
+    size_t texts_before = out.texts.size();
+
+    if(out.text_offsets.empty())
+        out.text_offsets.push_back(0);
+
+    detail::reserve_appended(out.sender_ids, msgs_before + msg_num);
+    detail::reserve_appended(out.text_offsets, msgs_before + msg_num + 1);
+    detail::reserve_appended(out.texts, texts_before + (offsets[msg_num] - offsets[0]));
+
+    std::string inflated;
+
+    try {
+        for(size_t i = 0; i < msg_num; ++i) {
+            if(offsets[i + 1] <= offsets[i])
+                throw std::runtime_error("messenger: append_columnar: offsets are not ascending");
+
+            detail::msg_state_t state = detail::append_text(beg + offsets[i], beg + offsets[i + 1], out.texts, inflated);
+            if(out.texts.size() > UINT32_MAX)
+                throw std::length_error("messenger: append_columnar: texts exceed 32-bit offsets");
+
+            detail::name_key_t key(state.name, state.name_len);
+            uint32_t id = out.sender_index.find(key);
+            if(id == detail::name_index_t::npos) {
+                id = static_cast<uint32_t>(out.senders.size());
+                out.senders.push_back(key);
+                out.sender_index.insert(key, id);
+            }
+
+            out.sender_ids.push_back(id);
+            out.text_offsets.push_back(static_cast<uint32_t>(out.texts.size()));
+            MESSENGER_TRACE_EVENT(msg_complete, state.name, state.name_len, out.texts.size() - out.text_offsets[out.text_offsets.size() - 2]);
+        }
+    } catch(...) {
+        for(size_t id = senders_before; id < out.senders.size(); ++id)
+            out.sender_index.erase(out.senders[id]);
+
+        out.senders.resize(senders_before);
+        out.sender_ids.resize(msgs_before);
+        out.texts.resize(texts_before);
+        out.text_offsets.resize(msgs_before + 1);
+        throw;
+    }
+}
+
+void append_columnar(const msg_batch_t &batch, columnar_batch_t &out) {
+    if(!detail::batch_in_range(batch))
+        throw std::out_of_range("messenger: append_columnar: offsets exceed buffer");
+
+    append_columnar(batch.buff.data(), batch.offsets.data(), batch.offsets.size(), out);
+}
+
+columnar_batch_t parse_columnar(const msg_batch_t &batch) {
+    columnar_batch_t res;
+    append_columnar(batch, res);
+
+    return res;
+}
+
+} // namespace messenger
@@ -0,0 +1,115 @@
+#include "batch_encoder.hpp"
+
+namespace messenger {
+
+batch_encoder_t::batch_encoder_t(sink_t sink, batch_config_t config)
+    : m_sink(std::move(sink))
+    , m_config(config)
+    , m_pending(0)
+    , m_flush_req(false)
+    , m_stop(false)
+{
+    if(m_config.max_batch_msgs == 0)
+        throw std::invalid_argument("messenger: batch_encoder_t: max_batch_msgs can not be 0");
+
+    m_buff.reserve(m_config.max_batch_bytes);
+    m_writer = std::thread(&batch_encoder_t::writer_loop, this);
+}
+
+batch_encoder_t::~batch_encoder_t() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake_cv.notify_one();
+    m_writer.join();
+}
+
+void batch_encoder_t::submit(msg_t msg) {
+    // Validate in caller's thread, so writer never throws
+    buff_size(msg);
+
+    size_t prev_pending = m_pending.fetch_add(1, std::memory_order_acq_rel);
+    m_queue.push(std::move(msg));
+
+    // Writer is woken up only by first message of batch and by full batch
+    if(prev_pending == 0 || prev_pending + 1 == m_config.max_batch_msgs) {
+        // Empty critical section orders notification after writer's predicate check
+        { std::lock_guard<std::mutex> lock(m_mutex); }
+        m_wake_cv.notify_one();
+    }
+}
+
+void batch_encoder_t::flush() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_flush_req = true;
+    m_wake_cv.notify_one();
+
+    m_flush_cv.wait(lock, [this] { return m_pending.load(std::memory_order_acquire) == 0; });
+}
+
+batch_stats_t batch_encoder_t::stats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void batch_encoder_t::writer_loop() {
+    for(;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake_cv.wait(lock, [this] {
+                return m_stop || m_flush_req || m_pending.load(std::memory_order_acquire) > 0;
+            });
+            // Let batch fill up, but no longer than max_latency
+            m_wake_cv.wait_for(lock, m_config.max_latency, [this] {
+                return m_stop || m_flush_req
+                    || m_pending.load(std::memory_order_acquire) >= m_config.max_batch_msgs;
+            });
+
+            if(m_stop && m_pending.load(std::memory_order_acquire) == 0)
+                break;
+
+            m_flush_req = false;
+        }
+
+        drain();
+    }
+
+    m_flush_cv.notify_all();
+}
+
+void batch_encoder_t::drain() {
+    msg_t msg;
+    size_t msg_num = 0;
+
+    auto hand_off = [&] {
+        m_sink(m_buff.data(), m_buff.data() + m_buff.size(), msg_num);
+        size_t left = m_pending.fetch_sub(msg_num, std::memory_order_acq_rel) - msg_num;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats.batches++;
+            m_stats.msgs += msg_num;
+            m_stats.bytes += m_buff.size();
+        }
+        if(left == 0)
+            m_flush_cv.notify_all();
+
+        m_buff.clear();
+        msg_num = 0;
+    };
+
+    while(m_queue.pop(msg)) {
+        // Exact-size encoding right at the end of batch
+        append_buff(msg, m_buff);
+        msg_num++;
+
+        if(msg_num >= m_config.max_batch_msgs || m_buff.size() >= m_config.max_batch_bytes)
+            hand_off();
+    }
+
+    if(msg_num != 0)
+        hand_off();
+}
+
+} // namespace messenger
@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "compress.hpp"
+#include "msg_hdr.hpp"
+
+namespace messenger::detail {
+
+namespace {
+
+const size_t MIN_MATCH = 4;
+const size_t MAX_OFFSET = 0xffff;
+const size_t LEN_MASK = 0xf;        // length, which fits in token
+const size_t MAX_HASH_BITS = 12;
+const size_t MIN_HASH_BITS = 8;
+
+// Single byte of compressed input can not expand to more
+const size_t MAX_RATIO = 255;
+
+inline uint32_t read32(const uint8_t *pos) {
+    uint32_t res;
+    std::memcpy(&res, pos, sizeof(res));
+    return res;
+}
+
+inline uint32_t hash32(uint32_t val, unsigned bits) {
+    return (val * 2654435761u) >> (32 - bits);
+}
+
+// Length above LEN_MASK: bytes of 255, followed by remainder
+void write_length(size_t len, std::string &out) {
+    for(; len >= 0xff; len -= 0xff)
+        out.push_back(static_cast<char>(0xff));
+    out.push_back(static_cast<char>(len));
+}
+
+void write_sequence(const uint8_t *lit, size_t lit_len, size_t offset, size_t match_len, std::string &out) {
+    size_t match_code = match_len != 0 ? match_len - MIN_MATCH : 0;
+
+    out.push_back(static_cast<char>(std::min(lit_len, LEN_MASK) << 4 | std::min(match_code, LEN_MASK)));
+    if(lit_len >= LEN_MASK)
+        write_length(lit_len - LEN_MASK, out);
+    out.append(reinterpret_cast<const char *>(lit), lit_len);
+
+    if(match_len == 0)
+        return;
+
+    out.push_back(static_cast<char>(offset & 0xff));
+    out.push_back(static_cast<char>(offset >> 8));
+    if(match_code >= LEN_MASK)
+        write_length(match_code - LEN_MASK, out);
+}
+
+[[noreturn]] void throw_corrupted() {
+    throw std::runtime_error("messenger: lz_decompress: corrupted input");
+}
+
+// Returns false on truncated input or length beyond limit
+bool read_length(const uint8_t *&pos, const uint8_t *end, size_t limit, size_t &len) {
+    for(;;) {
+        if(pos == end)
+            return false;
+
+        uint8_t byte = *pos++;
+        len += byte;
+        if(len > limit)
+            return false;
+        if(byte != 0xff)
+            return true;
+    }
+}
+
+} // namespace
+
+
+void lz_compress(const uint8_t *beg, const uint8_t *end, std::string &out) {
+    size_t len = end - beg;
+    out.reserve(out.size() + len + len / 0xff + 16);
+
+    // Table is sized by input, so short texts do not pay for clearing it
+    unsigned hash_bits = MIN_HASH_BITS;
+    while(hash_bits < MAX_HASH_BITS && (size_t(1) << hash_bits) < len)
+        hash_bits++;
+
+    // Position + 1 of last occurrence of 4 bytes, 0 if none
+    uint32_t table[size_t(1) << MAX_HASH_BITS];
+    std::fill(table, table + (size_t(1) << hash_bits), 0);
+
+    const uint8_t *anchor = beg;
+    const uint8_t *pos = beg;
+
+    while(end - pos >= static_cast<std::ptrdiff_t>(MIN_MATCH)) {
+        uint32_t val = read32(pos);
+        uint32_t &slot = table[hash32(val, hash_bits)];
+        const uint8_t *cand = slot != 0 ? beg + slot - 1 : NULL;
+        bool found = cand != NULL && static_cast<size_t>(pos - cand) <= MAX_OFFSET && read32(cand) == val;
+        slot = static_cast<uint32_t>(pos - beg + 1);
+
+        if(!found) {
+            pos++;
+            continue;
+        }
+
+        size_t match_len = MIN_MATCH;
+        while(pos + match_len != end && cand[match_len] == pos[match_len])
+            match_len++;
+
+        write_sequence(anchor, pos - anchor, pos - cand, match_len, out);
+        pos += match_len;
+        anchor = pos;
+    }
+
+    write_sequence(anchor, end - anchor, 0, 0, out);
+}
+
+const uint8_t *lz_decompress(const uint8_t *beg, const uint8_t *end, size_t raw_len, std::string &out) {
+    size_t out_beg = out.size();
+    out.resize(out_beg + raw_len);
+
+    uint8_t *dst_beg = reinterpret_cast<uint8_t *>(&out[0]) + out_beg;
+    uint8_t *dst_end = dst_beg + raw_len;
+    uint8_t *dst = dst_beg;
+
+    for(;;) {
+        if(beg == end) break;
+        uint8_t token = *beg++;
+
+        size_t lit_len = token >> 4;
+        if(lit_len == LEN_MASK && !read_length(beg, end, raw_len, lit_len)) break;
+        if(lit_len > static_cast<size_t>(end - beg) || lit_len > static_cast<size_t>(dst_end - dst)) break;
+
+        std::memcpy(dst, beg, lit_len);
+        dst += lit_len;
+        beg += lit_len;
+
+        // Last sequence has literals only
+        if(dst == dst_end)
+            return beg;
+
+        if(end - beg < 2) break;
+        size_t offset = beg[0] | (beg[1] << 8);
+        beg += 2;
+        if(offset == 0 || offset > static_cast<size_t>(dst - dst_beg)) break;
+
+        size_t match_len = token & LEN_MASK;
+        if(match_len == LEN_MASK && !read_length(beg, end, raw_len, match_len)) break;
+        match_len += MIN_MATCH;
+        if(match_len > static_cast<size_t>(dst_end - dst)) break;
+
+        // Match may overlap its own output (offset < match_len): copy bytewise
+        const uint8_t *src = dst - offset;
+        if(offset >= match_len) {
+            std::memcpy(dst, src, match_len);
+        } else {
+            for(size_t i = 0; i < match_len; ++i)
+                dst[i] = src[i];
+        }
+        dst += match_len;
+    }
+
+    out.resize(out_beg);
+    throw_corrupted();
+}
+
+void seal_envelope(const std::string &text, std::string &env) {
+    env.clear();
+
+    for(size_t len = text.size(); ; len >>= 7) {
+        if(len < 0x80) {
+            env.push_back(static_cast<char>(len));
+            break;
+        }
+        env.push_back(static_cast<char>(0x80 | (len & 0x7f)));
+    }
+
+    const uint8_t *text_beg = reinterpret_cast<const uint8_t *>(text.data());
+    lz_compress(text_beg, text_beg + text.size(), env);
+
+    if(env.size() % MSGR_MSG_LEN_MAX == 0)
+        env.push_back(0);
+}
+
+void open_envelope(const char *beg, const char *end, std::string &text) {
+    const uint8_t *pos = reinterpret_cast<const uint8_t *>(beg);
+    const uint8_t *env_end = reinterpret_cast<const uint8_t *>(end);
+
+    size_t raw_len = 0;
+    for(unsigned shift = 0; ; shift += 7) {
+        if(pos == env_end || shift >= 64)
+            throw_corrupted();
+
+        uint8_t byte = *pos++;
+        raw_len |= static_cast<size_t>(byte & 0x7f) << shift;
+        if((byte & 0x80) == 0)
+            break;
+    }
+
+    // Do not trust corrupted length to allocate
+    if(raw_len / MAX_RATIO > static_cast<size_t>(env_end - pos))
+        throw_corrupted();
+
+    text.clear();
+    pos = lz_decompress(pos, env_end, raw_len, text);
+
+    // At most pad byte may follow compressed text
+    if(pos != env_end && (env_end - pos != 1 || *pos != 0)) {
+        text.clear();
+        throw_corrupted();
+    }
+}
+
+} // namespace messenger::detail
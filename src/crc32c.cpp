@@ -0,0 +1,146 @@
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <nmmintrin.h>
+#define MESSENGER_CRC32C_SSE42 1
+#elif defined(__aarch64__) && defined(__linux__) && defined(__GNUC__)
+#include <arm_acle.h>
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#define MESSENGER_CRC32C_ARMV8 1
+#endif
+
+#include "util.hpp"
+
+namespace messenger::util {
+
+// Reflected polynomial of CRC32C (Castagnoli)
+static const uint32_t CRC32C_POLY = 0x82f63b78;
+
+// tab[k][byte]: crc of byte followed by k zero bytes, so 8 lookups advance crc by 8 bytes
+struct crc32c_tab_t {
+    uint32_t tab[8][256];
+
+    constexpr crc32c_tab_t(): tab() {
+        for(uint32_t byte = 0; byte < 256; ++byte) {
+            uint32_t c = byte;
+            for(int bit = 0; bit < BITS_PER_BYTE; ++bit)
+                c = (c >> 1) ^ (CRC32C_POLY & (0u - (c & 1)));
+            tab[0][byte] = c;
+        }
+
+        for(size_t k = 1; k < 8; ++k)
+            for(size_t byte = 0; byte < 256; ++byte)
+                tab[k][byte] = (tab[k - 1][byte] >> 8) ^ tab[0][tab[k - 1][byte] & 0xff];
+    }
+};
+
+static constexpr crc32c_tab_t crc32c_tab;
+
+uint32_t crc32c_sw(uint32_t c, const uint8_t *beg, const uint8_t *end) {
+    static_assert(endian::native == endian::little, "messenger: big endian conversion is not supported");
+    const auto &tab = crc32c_tab.tab;
+    c = ~c;
+
+    for(; end - beg >= 8; beg += 8) {
+        uint32_t lo, hi;
+        std::memcpy(&lo, beg, sizeof(lo));
+        std::memcpy(&hi, beg + 4, sizeof(hi));
+        lo ^= c;
+
+        c = tab[7][lo & 0xff] ^ tab[6][(lo >> 8) & 0xff] ^ tab[5][(lo >> 16) & 0xff] ^ tab[4][lo >> 24]
+          ^ tab[3][hi & 0xff] ^ tab[2][(hi >> 8) & 0xff] ^ tab[1][(hi >> 16) & 0xff] ^ tab[0][hi >> 24];
+    }
+
+    for(; beg != end; ++beg)
+        c = tab[0][(c ^ *beg) & 0xff] ^ (c >> 8);
+
+    return ~c;
+}
+
+#if defined(MESSENGER_CRC32C_SSE42)
+
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_hw(uint32_t c, const uint8_t *beg, const uint8_t *end) {
+    uint64_t c64 = ~c;
+
+    for(; end - beg >= 8; beg += 8) {
+        uint64_t word;
+        std::memcpy(&word, beg, sizeof(word));
+        c64 = _mm_crc32_u64(c64, word);
+    }
+
+    c = static_cast<uint32_t>(c64);
+    for(; beg != end; ++beg)
+        c = _mm_crc32_u8(c, *beg);
+
+    return ~c;
+}
+
+static bool has_crc32c_hw() {
+    return __builtin_cpu_supports("sse4.2");
+}
+
+#define MESSENGER_CRC32C_HW_NAME "sse4.2"
+
+#elif defined(MESSENGER_CRC32C_ARMV8)
+
+__attribute__((target("+crc")))
+static uint32_t crc32c_hw(uint32_t c, const uint8_t *beg, const uint8_t *end) {
+    c = ~c;
+
+    for(; end - beg >= 8; beg += 8) {
+        uint64_t word;
+        std::memcpy(&word, beg, sizeof(word));
+        c = __crc32cd(c, word);
+    }
+
+    for(; beg != end; ++beg)
+        c = __crc32cb(c, *beg);
+
+    return ~c;
+}
+
+static bool has_crc32c_hw() {
+    return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+}
+
+#define MESSENGER_CRC32C_HW_NAME "armv8"
+
+#endif
+
+namespace {
+
+using crc32c_fn_t = uint32_t (*)(uint32_t, const uint8_t *, const uint8_t *);
+
+// Implementation is selected once, on first use
+struct crc32c_dispatch_t {
+    crc32c_fn_t fn;
+    const char *name;
+
+    crc32c_dispatch_t(): fn(crc32c_sw), name("slicing-by-8") {
+#ifdef MESSENGER_CRC32C_HW_NAME
+        if(has_crc32c_hw()) {
+            fn = crc32c_hw;
+            name = MESSENGER_CRC32C_HW_NAME;
+        }
+#endif
+    }
+};
+
+const crc32c_dispatch_t &crc32c_dispatch() {
+    static const crc32c_dispatch_t dispatch;
+    return dispatch;
+}
+
+} // namespace
+
+uint32_t crc32c(uint32_t c, const uint8_t *beg, const uint8_t *end) {
+    return crc32c_dispatch().fn(c, beg, end);
+}
+
+const char *crc32c_impl() {
+    return crc32c_dispatch().name;
+}
+
+} // namespace messenger::util
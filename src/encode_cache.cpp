@@ -0,0 +1,158 @@
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include "encode_cache.hpp"
+#include "util.hpp"
+
+namespace messenger {
+
+namespace detail {
+
+// Bookkeeping per cached message (list node, map node), counted against budget
+const size_t ENCODE_CACHE_ENTRY_OVERHEAD = 128;
+
+/**
+ * Shard of encode_cache_t: LRU list of messages, which hash to it
+*/
+struct encode_cache_shard_t
+{
+    struct entry_t {
+        uint64_t hash;
+        std::string name;
+        std::string text;
+        encode_cache_t::buff_ptr_t buff;
+        size_t bytes;
+    };
+
+    using lru_t = std::list<entry_t>;
+
+    std::mutex mutex;
+
+    lru_t lru;                                              // most recently used first
+    std::unordered_map<uint64_t, lru_t::iterator> entries;  // by hash
+    size_t budget = 0;
+    size_t bytes = 0;
+
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evicted = 0;
+};
+
+static inline const uint8_t *bytes_of(const std::string &str) {
+    return reinterpret_cast<const uint8_t *>(str.data());
+}
+
+// High half hashes name, low half hashes length & name & text; text is hashed once
+static inline uint64_t msg_hash(const msg_t &msg) {
+    uint32_t name_crc = util::crc32c(0, bytes_of(msg.name), bytes_of(msg.name) + msg.name.size());
+    uint32_t lead_crc = util::crc32c(static_cast<uint32_t>(msg.name.size()), bytes_of(msg.name), bytes_of(msg.name) + msg.name.size());
+    uint32_t text_crc = util::crc32c(lead_crc, bytes_of(msg.text), bytes_of(msg.text) + msg.text.size());
+
+    return static_cast<uint64_t>(name_crc) << 32 | text_crc;
+}
+
+} // namespace detail
+
+
+encode_cache_t::encode_cache_t(encode_cache_config_t config)
+    : m_config(config)
+{
+    if(m_config.shards == 0)
+        throw std::invalid_argument("messenger: encode_cache_t: shards has to be positive");
+
+    for(size_t i = 0; i < m_config.shards; ++i) {
+        m_shards.push_back(std::make_unique<detail::encode_cache_shard_t>());
+        m_shards.back()->budget = m_config.max_bytes / m_config.shards;
+    }
+}
+
+encode_cache_t::~encode_cache_t() = default;
+
+encode_cache_t::buff_ptr_t encode_cache_t::encode(const msg_t &msg) {
+    using shard_t = detail::encode_cache_shard_t;
+
+    uint64_t hash = detail::msg_hash(msg);
+    shard_t &sh = shard(hash);
+
+    {
+        std::lock_guard<std::mutex> lock(sh.mutex);
+
+        auto it = sh.entries.find(hash);
+        if(it != sh.entries.end() && it->second->name == msg.name && it->second->text == msg.text) {
+            sh.lru.splice(sh.lru.begin(), sh.lru, it->second);
+            sh.hits++;
+            return it->second->buff;
+        }
+        sh.misses++;
+    }
+
+    // Encode outside of lock: concurrent misses of same message encode it twice, first one is kept
+    buff_ptr_t buff = std::make_shared<const std::vector<uint8_t>>(make_buff(msg, m_config.encoding));
+
+    size_t bytes = msg.name.size() + msg.text.size() + buff->size() + detail::ENCODE_CACHE_ENTRY_OVERHEAD;
+    if(bytes > sh.budget)
+        return buff;
+
+    std::lock_guard<std::mutex> lock(sh.mutex);
+
+    auto it = sh.entries.find(hash);
+    if(it != sh.entries.end()) {
+        if(it->second->name == msg.name && it->second->text == msg.text)
+            return it->second->buff;
+
+        // Hash collision: newer message replaces older one
+        sh.bytes -= it->second->bytes;
+        sh.lru.erase(it->second);
+        sh.entries.erase(it);
+        sh.evicted++;
+    }
+
+    while(sh.bytes + bytes > sh.budget) {
+        shard_t::entry_t &last = sh.lru.back();
+        sh.bytes -= last.bytes;
+        sh.entries.erase(last.hash);
+        sh.lru.pop_back();
+        sh.evicted++;
+    }
+
+    sh.lru.push_front(shard_t::entry_t{hash, msg.name, msg.text, buff, bytes});
+    sh.entries.emplace(hash, sh.lru.begin());
+    sh.bytes += bytes;
+
+    return buff;
+}
+
+void encode_cache_t::clear() {
+    for(const std::unique_ptr<detail::encode_cache_shard_t> &sh : m_shards) {
+        std::lock_guard<std::mutex> lock(sh->mutex);
+        sh->entries.clear();
+        sh->lru.clear();
+        sh->bytes = 0;
+    }
+}
+
+encode_cache_stats_t encode_cache_t::stats() const {
+    encode_cache_stats_t res;
+
+    for(const std::unique_ptr<detail::encode_cache_shard_t> &sh : m_shards) {
+        std::lock_guard<std::mutex> lock(sh->mutex);
+        res.hits += sh->hits;
+        res.misses += sh->misses;
+        res.evicted += sh->evicted;
+        res.entries += sh->entries.size();
+        res.bytes += sh->bytes;
+    }
+
+    return res;
+}
+
+detail::encode_cache_shard_t &encode_cache_t::shard(uint64_t hash) const {
+    // Mix both halves, so messages of one sender spread over shards
+    uint64_t mixed = (hash ^ hash >> 29) * 0x9e3779b97f4a7c15ull;
+    return *m_shards[(mixed >> 32) % m_shards.size()];
+}
+
+} // namespace messenger
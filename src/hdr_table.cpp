@@ -0,0 +1,42 @@
+#include "msg_hdr.hpp"
+#include "util.hpp"
+
+namespace messenger::detail {
+
+namespace {
+
+// util::crc4(c, byte, BITS_PER_BYTE): high nibble first
+constexpr uint8_t crc4_byte(uint8_t c, uint8_t byte) {
+    c = util::CRC4_NIBBLE_TAB[c ^ (byte >> 4)];
+    return util::CRC4_NIBBLE_TAB[c ^ (byte & 0xf)];
+}
+
+// Same decoding as msg_hdr_view_t, but at compile time
+constexpr hdr_info_t make_hdr_info(uint8_t byte0, uint8_t byte1) {
+    uint8_t flag = byte0 & MASK_FIRST_N(MSGR_FLAG_BITS);
+    uint8_t name_len = (byte0 >> MSGR_FLAG_BITS) & MASK_FIRST_N(MSGR_NAME_LEN_BITS);
+    uint8_t msg_len = ((byte0 >> (MSGR_FLAG_BITS + MSGR_NAME_LEN_BITS)) & 1)
+                    | ((byte1 & MASK_FIRST_N(MSGR_MSG_LEN_BITS - 1)) << 1);
+    uint8_t crc4 = (byte1 >> (MSGR_MSG_LEN_BITS - 1)) & MASK_FIRST_N(MSGR_CRC4_BITS);
+
+    // CRC4 of header with nullified CRC4 bits
+    uint8_t byte1_no_crc4 = byte1 & ~(MASK_FIRST_N(MSGR_CRC4_BITS) << (MSGR_MSG_LEN_BITS - 1));
+    uint8_t crc4_state = crc4_byte(crc4_byte(0, byte0), byte1_no_crc4);
+
+    return hdr_info_t(flag, name_len, msg_len, crc4, crc4_state);
+}
+
+constexpr std::array<hdr_info_t, HDR_TABLE_SIZE> make_hdr_table() {
+    std::array<hdr_info_t, HDR_TABLE_SIZE> table = {};
+
+    for(size_t hdr = 0; hdr < HDR_TABLE_SIZE; ++hdr)
+        table[hdr] = make_hdr_info(hdr & 0xff, hdr >> BITS_PER_BYTE);
+
+    return table;
+}
+
+} // namespace
+
+extern constexpr std::array<hdr_info_t, HDR_TABLE_SIZE> hdr_table = make_hdr_table();
+
+} // namespace messenger::detail
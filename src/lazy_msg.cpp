@@ -0,0 +1,94 @@
+#include <cstring>
+#include <stdexcept>
+
+#include "lazy_msg.hpp"
+#include "compress.hpp"
+#include "packet.hpp"
+#include "trace.hpp"
+
+namespace messenger {
+
+namespace detail {
+
+// Pass msg field of every text packet of validated message to visit
+template<typename Visit>
+static void visit_payload(const uint8_t *cur, const uint8_t *end, Visit visit) {
+    while(cur != end) {
+        packet_view_t packet(cur);
+        visit(packet.msg(), packet.msg_len());
+        cur = packet.end();
+    }
+}
+
+} // namespace detail
+
+
+lazy_msg_t::lazy_msg_t(buff_ptr_t buff)
+    : lazy_msg_t(buff, 0, buff != nullptr ? buff->size() : 0)
+{}
+
+lazy_msg_t::lazy_msg_t(buff_ptr_t buff, size_t beg, size_t end)
+    : m_buff(std::move(buff))
+    , m_beg(beg)
+    , m_end(end)
+{
+    if(m_buff == nullptr || beg > end || end > m_buff->size())
+        throw std::out_of_range("messenger: lazy_msg_t: message is outside of buffer");
+
+    detail::msg_state_t state;
+    const uint8_t *data = m_buff->data();
+    const uint8_t *cur = data + beg;
+
+    // Same validation as parse_buff, msg fields are only checksummed
+    do {
+        detail::packet_view_t packet = detail::view_packet(cur, data + end);
+        if(!detail::accept_packet(packet, state))
+            m_text_beg = packet.end() - data;
+
+        cur = packet.end();
+    } while(cur != data + end);
+
+    detail::check_msg_state(state);
+
+    if(!state.checked)
+        m_text_beg = beg;
+    m_payload_len = state.text_len;
+    m_compressed = state.compressed;
+    m_name_len = state.name_len;
+    std::memcpy(m_name, state.name, m_name_len);
+    MESSENGER_TRACE_EVENT(msg_complete, m_name, m_name_len, m_payload_len);
+}
+
+const std::string &lazy_msg_t::text() const {
+    if(m_assembled)
+        return m_text;
+
+    std::string payload;
+    std::string &target = m_compressed ? payload : m_text;
+    target.clear();
+    target.reserve(m_payload_len);
+    detail::visit_payload(begin() + (m_text_beg - m_beg), end(), [&](const char *field, size_t len) {
+        target.append(field, len);
+    });
+
+    if(m_compressed)
+        detail::open_envelope(payload.data(), payload.data() + payload.size(), m_text);
+
+    m_assembled = true;
+
+    return m_text;
+}
+
+void lazy_msg_t::stream_text(const sink_t &sink) const {
+    // Assembled or compressed text is passed whole
+    if(m_assembled || m_compressed) {
+        sink(text());
+        return;
+    }
+
+    detail::visit_payload(begin() + (m_text_beg - m_beg), end(), [&](const char *field, size_t len) {
+        sink(std::string_view(field, len));
+    });
+}
+
+} // namespace messenger
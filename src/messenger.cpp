@@ -1,218 +1,370 @@
-#include <iostream>
-#include <array>
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 
 #include "messenger.hpp"
+#include "compress.hpp"
 #include "msg_hdr.hpp"
+#include "packet.hpp"
+#include "padded.hpp"
+#include "trace.hpp"
 #include "util.hpp"
 
 namespace messenger {
 
-const size_t MAX_PACKET_SIZE = detail::HEADER_SIZE + MSGR_NAME_LEN_MAX + MSGR_MSG_LEN_MAX;
-
 /**
  * Covers details of operation
 */
 namespace detail {
 
-class msg_packet_t {
-
-private:
-    std::array<uint8_t, MAX_PACKET_SIZE> m_raw;
-    using m_raw_iter_t = std::array<uint8_t, MAX_PACKET_SIZE>::iterator;
-public:
-    /**
-     * Construct packet from name and message
-     * 
-     * @param name sender's name
-     * @param msg_beg message's beginning
-     * @param msg_end message's end
-     * 
-     * @note first MSGR_MSG_LEN_MAX from message range will be included in packet ignoring rest 
-    */
-    msg_packet_t(
-        const std::string &name,
-        std::string::const_iterator msg_beg,
-        std::string::const_iterator msg_end
-    ) {
-        // Check if name is valid
-        assertm(!name.empty() && name.size() <= MSGR_NAME_LEN_MAX, "msg_packet_t: name has wrong size");
-        // Check validity of msg
-        assertm(msg_beg < msg_end, "msg_packet_t: packet message has wrong iterators");
-
-        std::string::size_type packet_msg_len = std::min(msg_end - msg_beg, 
-            static_cast<std::string::iterator::difference_type>(MSGR_MSG_LEN_MAX) );
-
-        // Get to beginning of name field
-        m_raw_iter_t m_raw_iter = m_raw.begin() + HEADER_SIZE;
-        
-        // Copy name into packet
-        std::copy(name.cbegin(), name.cend(), m_raw_iter);
-        m_raw_iter += name.size(); // Move to beginning of msg field
-        // Copy msg into packet
-        std::copy(msg_beg, msg_beg + packet_msg_len, m_raw_iter);
-
-
-        // Calculate crc4. Have to set vals of header first, before calculating crc4
-        msg_hdr_mod_t hdr_modifier(m_raw.begin(), name.size(), packet_msg_len, 0);
-        uint8_t crc4_res = util::crc4_packet(begin(), end());
-        // Place calculated crc4 in header
-        hdr_modifier.set_crc4(crc4_res);
+size_t buff_size(size_t name_len, size_t text_len) {
+    // Every packet carries header & name, text is spread across packets
+    size_t packet_num = (text_len + MSGR_MSG_LEN_MAX - 1) / MSGR_MSG_LEN_MAX;
+    return packet_num * (HEADER_SIZE + name_len) + text_len;
+}
+
+void check_msg(const msg_t &msg) {
+    // Interface logic: Text and name cant be empty
+    if(msg.name.empty()) throw std::length_error("messenger: make_buf: name is empty");
+
+    if(msg.name.size() > MSGR_NAME_LEN_MAX) throw std::length_error("messenger: make_buf: name is too long");
+
+    if(msg.text.empty()) throw std::length_error("messenger: make_buf: text is empty");
+}
+
+/**
+ * Write single packet directly into output
+ * 
+ * @param name sender's name
+ * @param msg_beg message's beginning
+ * @param msg_end message's end
+ * @param flag flag bits of packet
+ * @param out beginning of output, has to fit whole packet
+ * 
+ * @return end of written packet
+ * 
+ * @note first MSGR_MSG_LEN_MAX from message range will be included in packet ignoring rest 
+*/
+uint8_t *write_single_packet (
+    const std::string &name, 
+    std::string::const_iterator msg_beg, 
+    std::string::const_iterator msg_end, 
+    uint8_t flag,
+    uint8_t *out
+) {
+    // Check if name is valid
+    assertm(!name.empty() && name.size() <= MSGR_NAME_LEN_MAX, "write_single_packet: name has wrong size");
+    // Check validity of msg
+    assertm(msg_beg < msg_end, "write_single_packet: packet message has wrong iterators");
+    static_assert(util::endian::native == util::endian::little, "messenger: big endian conversion is not supported");
+
+    std::string::size_type packet_msg_len = std::min(msg_end - msg_beg, 
+        static_cast<std::string::iterator::difference_type>(MSGR_MSG_LEN_MAX) );
+
+    // Copy name & msg into packet
+    uint8_t *packet_end = std::copy(name.cbegin(), name.cend(), out + HEADER_SIZE);
+    packet_end = std::copy(msg_beg, msg_beg + packet_msg_len, packet_end);
+
+    // Calculate crc4. Have to set vals of header first, before calculating crc4
+    msg_hdr_mod_t hdr_modifier(out, name.size(), packet_msg_len, 0, flag);
+    hdr_modifier.set_crc4(util::crc4_packet(out, packet_end));
+    MESSENGER_TRACE_EVENT(encode_packet, name.data(), name.size(), packet_msg_len);
+
+    return packet_end;
+}
+
+/**
+ * Write single packet with fixed-width copies of fields, same bytes as write_single_packet
+ *
+ * @param name_field sender's name, zero padded to 16 bytes
+ * @param text_end end of whole text: msg field is loaded by 32 bytes, while they are in text
+ * @param out beginning of output, has to fit whole packet & util::PADDING bytes after it
+ *
+ * @note bytes up to util::PADDING after packet are clobbered
+*/
+uint8_t *write_single_packet_padded(
+    const uint8_t *name_field,
+    size_t name_len,
+    std::string::const_iterator msg_beg,
+    std::string::const_iterator msg_end,
+    std::string::const_iterator text_end,
+    uint8_t flag,
+    uint8_t *out
+) {
+    assertm(name_len != 0 && name_len <= MSGR_NAME_LEN_MAX, "write_single_packet_padded: name has wrong size");
+    assertm(msg_beg < msg_end, "write_single_packet_padded: packet message has wrong iterators");
+
+    size_t packet_msg_len = std::min<size_t>(msg_end - msg_beg, MSGR_MSG_LEN_MAX);
+
+    // Tails of both copies are overwritten by msg field & next packet, or land in padding
+    uint8_t *msg_out = out + HEADER_SIZE + name_len;
+    util::copy16(out + HEADER_SIZE, name_field);
+    if(text_end - msg_beg >= static_cast<std::ptrdiff_t>(util::PADDING))
+        util::copy32(msg_out, &*msg_beg);
+    else
+        std::memcpy(msg_out, &*msg_beg, packet_msg_len);    // text itself has no padding
+    uint8_t *packet_end = msg_out + packet_msg_len;
+
+    msg_hdr_mod_t hdr_modifier(out, name_len, packet_msg_len, 0, flag);
+    hdr_modifier.set_crc4(util::crc4_packet(out, packet_end));
+    MESSENGER_TRACE_EVENT(encode_packet, reinterpret_cast<const char *>(name_field), name_len, packet_msg_len);
+
+    return packet_end;
+}
+
+uint8_t *write_packets(const std::string &name, const std::string &text, uint8_t flag, uint8_t *out,
+                       uint32_t *crc32c, bool padded) {
+    uint8_t name_field[16] = {};
+    if(padded)
+        std::memcpy(name_field, name.data(), name.size());
+
+    // As packet has limit on text size, divide text to several packets
+    std::string::const_iterator next_text_pos = text.begin();
+    while(next_text_pos != text.cend()) {
+        std::string::const_iterator packet_text_end = next_text_pos 
+            + std::min(text.cend() - next_text_pos, 
+                       static_cast<std::string::iterator::difference_type>(MSGR_MSG_LEN_MAX));
+
+        if(padded)
+            out = write_single_packet_padded(name_field, name.size(), next_text_pos, packet_text_end, text.cend(), flag, out);
+        else
+            out = write_single_packet(name, next_text_pos, packet_text_end, flag, out);
+
+        // Checksum msg field, which is just written (and is still in cache)
+        if(crc32c != NULL)
+            *crc32c = util::crc32c(*crc32c, out - (packet_text_end - next_text_pos), out);
+
+        next_text_pos = packet_text_end;
     }
 
-    /**
-     * Construct packet from buffer
-     * 
-     * @param buf_beg buffer's beginning
-     * @param buf_end buffer's end (can exceed single packet)
-     * 
-     * @note first MSGR_MSG_LEN_MAX from message range will be included in packet ignoring rest 
-    */
-    msg_packet_t(
-        std::vector<uint8_t>::const_iterator buf_beg,
-        std::vector<uint8_t>::const_iterator buf_end
-    ) {
-        // Check if buffer has at least enough bytes for header
-        assertm((buf_end - buf_beg) >= HEADER_SIZE, "msg_packet_t: buffer does not contain enough bytes");
-        static_assert(util::endian::native == util::endian::little, "messenger: big endian conversion is not supported");
-
-        msg_hdr_view_t buf_hdr_view(buf_beg.base());
-        // Interface logic: If flag of incoming buffer is wrong, send runtime_error
-        if(buf_hdr_view.get_flag() != FLAG_BITS)
-            throw std::runtime_error("messenger: msg_packet_t: invalid flag bits") ;
-
-        size_t packet_size = HEADER_SIZE + buf_hdr_view.get_name_len() + buf_hdr_view.get_msg_len();
-        if(buf_beg + packet_size > buf_end)
-            throw std::runtime_error("messenger: msg_packet_t: indicated name & msg size exceeds packet size");
-
-        // Validate crc4
-        uint8_t crc4_packet = buf_hdr_view.get_crc4(); // CRC4 retrieved from packet
-        uint8_t crc4_real = util::crc4_packet(buf_beg.base(), (buf_beg + packet_size).base());
-
-        if(crc4_real != crc4_packet)
-            throw std::runtime_error("messenger: msg_packet_t: invalid CRC4");
-        
-        assertm(packet_size <= m_raw.size(), "msg_packet_t: packet size is falsely larger");
-        std::copy(buf_beg, buf_beg + packet_size, m_raw.begin());
+    return out;
+}
+
+uint8_t *write_crc32c_packet(const std::string &name, uint32_t crc32c, uint8_t *out) {
+    std::string field(CRC32C_LEN, '\0');
+    std::memcpy(&field[0], &crc32c, CRC32C_LEN);
+
+    return write_single_packet(name, field.cbegin(), field.cend(), CRC32C_FLAG_BITS, out);
+}
+
+size_t packet_size(const uint8_t *hdr) {
+    return hdr_info(hdr).size();
+}
+
+packet_view_t view_packet(const uint8_t *beg, const uint8_t *end) {
+    static_assert(util::endian::native == util::endian::little, "messenger: big endian conversion is not supported");
+
+    if( (end - beg) < static_cast<std::ptrdiff_t>(HEADER_SIZE) )
+        throw std::runtime_error("messenger: view_packet: buffer does not contain enough bytes for packet");
+
+    // Single table load decodes whole header
+    const hdr_info_t &info = hdr_info(beg);
+
+    // Interface logic: If flag of incoming buffer is wrong, send runtime_error
+    if(!info.flag_ok()) {
+        MESSENGER_TRACE_EVENT(flag_failure, NULL, 0, msg_hdr_view_t(beg).get_flag());
+        throw std::runtime_error("messenger: view_packet: invalid flag bits") ;
     }
 
-    std::string name() {
-        msg_hdr_view_t hdr_view(m_raw.begin());
-        const uint8_t *name_beg = begin() + HEADER_SIZE;
+    if(static_cast<std::ptrdiff_t>(info.size()) > end - beg)
+        throw std::runtime_error("messenger: view_packet: indicated name & msg size exceeds packet size");
 
-        return std::string(name_beg, name_beg + hdr_view.get_name_len());
+    // Validate crc4, continuing from crc4 state after header
+    if(util::crc4_range(info.crc4_state(), beg + HEADER_SIZE, beg + info.size()) != info.crc4()) {
+        MESSENGER_TRACE_EVENT(crc4_failure, reinterpret_cast<const char *>(beg + HEADER_SIZE), info.name_len(), info.size());
+        throw std::runtime_error("messenger: view_packet: invalid CRC4");
     }
 
-    std::string msg() {
-        msg_hdr_view_t hdr_view(m_raw.begin());
-        const uint8_t *msg_beg = begin() + HEADER_SIZE + hdr_view.get_name_len();
+    if(info.name_len() == 0) throw std::length_error("messenger: parse_buf: name is empty");
+    if(info.msg_len() == 0) throw std::length_error("messenger: parse_buf: text is empty");
 
-        return std::string(msg_beg, msg_beg + hdr_view.get_msg_len());
+    if(info.checksum() && info.msg_len() != CRC32C_LEN)
+        throw std::runtime_error("messenger: view_packet: invalid size of CRC32C packet");
+
+    MESSENGER_TRACE_EVENT(decode_packet, reinterpret_cast<const char *>(beg + HEADER_SIZE), info.name_len(), info.msg_len());
+
+    return packet_view_t(beg);
+}
+
+bool accept_packet(const packet_view_t &packet, msg_state_t &state) {
+    if(state.packets == 0) {
+        state.name_len = packet.name_len();
+        std::memcpy(state.name, packet.name(), state.name_len);
+    } else if(packet.name_len() != state.name_len || std::memcmp(packet.name(), state.name, state.name_len) != 0) {
+        // Check if name persists across packets
+        throw std::runtime_error("messenger: sender names do not match accross packets");
     }
 
-    // Beginning of packet
-    const uint8_t *begin() {
-        return m_raw.begin();
+    if(packet.checksum()) {
+        if(state.packets != 0)
+            throw std::runtime_error("messenger: CRC32C packet does not lead message");
+
+        state.checked = true;
+        state.crc32c_expected = packet.crc32c();
+        state.packets++;
+        return false;
     }
 
-    // End of packet
-    const uint8_t *end() {
-        msg_hdr_view_t hdr_view(m_raw.begin());
-        return begin() + (HEADER_SIZE 
-               + hdr_view.get_name_len()  + hdr_view.get_msg_len() );
+    // First text packet sets compression of message
+    if(state.packets == static_cast<size_t>(state.checked))
+        state.compressed = packet.compressed();
+    else if(packet.compressed() != state.compressed)
+        throw std::runtime_error("messenger: compressed and plain packets are mixed in message");
+
+    state.packets++;
+    state.text_len += packet.msg_len();
+
+    if(state.checked) {
+        const uint8_t *field = reinterpret_cast<const uint8_t *>(packet.msg());
+        state.crc32c = util::crc32c(state.crc32c, field, field + packet.msg_len());
     }
 
-    size_t size() {
-        return end() - begin();
+    return true;
+}
+
+void check_msg_state(const msg_state_t &state) {
+    if(state.packets == static_cast<size_t>(state.checked))
+        throw std::runtime_error("messenger: message has no text packets");
+
+    if(state.checked && state.crc32c != state.crc32c_expected) {
+        MESSENGER_TRACE_EVENT(crc32c_failure, state.name, state.name_len, state.text_len);
+        throw std::runtime_error("messenger: invalid CRC32C");
     }
+}
 
-};
+void append_packet(const packet_view_t &packet, msg_t &msg, msg_state_t &state) {
+    if(state.packets == 0) {
+        msg.name.assign(packet.name(), packet.name_len());
+        msg.text.clear();
+    }
 
-std::string::const_iterator push_single_packet (
-    const std::string &name, 
-    std::string::const_iterator msg_begin, 
-    std::string::const_iterator msg_end, 
-    std::vector<uint8_t> &out_vec
-) {
-    msg_packet_t packet(name, msg_begin, msg_end);
+    // Add retrieved text
+    if(accept_packet(packet, state))
+        msg.text.append(packet.msg(), packet.msg_len());
+}
 
-    static_assert(util::endian::native == util::endian::little, "messenger: big endian conversion is not supported");
-        
-    std::back_insert_iterator<std::vector<uint8_t>> vec_iter(out_vec);
-    std::copy(packet.begin(), packet.end(), vec_iter);
-    
-    size_t msg_size_packed = packet.size()/*size of whole packet*/ - name.size() - detail::HEADER_SIZE;
-    return msg_begin + msg_size_packed;
-}
-
-std::vector<uint8_t>::const_iterator parse_single_packet (
-    std::vector<uint8_t>::const_iterator buf_beg,
-    std::vector<uint8_t>::const_iterator buf_end,
-    std::string &out_name,
-    std::string &out_text
-) {
-    if( (buf_end - buf_beg) < detail::HEADER_SIZE)
-        throw std::runtime_error("messenger: msg_packet_t: buffer does not contain enough bytes for packet");
+encoding_t plan_encoding(const msg_t &msg, const buff_opts_t &opts, std::string &env) {
+    check_msg(msg);
 
-    msg_packet_t packet(buf_beg, buf_end);
+    bool compress = opts.compress && msg.text.size() >= opts.compress_threshold;
+    if(compress) {
+        seal_envelope(msg.text, env);
 
-    if(packet.name().empty()) throw std::length_error("messenger: parse_buf: name is empty");
-    if(packet.msg().empty()) throw std::length_error("messenger: parse_buf: text is empty");
+        // Incompressible text is sent plain: envelope would cost bytes & inflating
+        compress = env.size() < msg.text.size();
+    }
 
-    out_name = packet.name();
-    out_text = packet.msg();
+    encoding_t enc;
+    enc.payload = compress ? &env : &msg.text;
+    enc.flag = compress ? COMPRESSED_FLAG_BITS : FLAG_BITS;
+    enc.lead_size = opts.crc32c ? HEADER_SIZE + msg.name.size() + CRC32C_LEN : 0;
+    enc.size = enc.lead_size + buff_size(msg.name.size(), enc.payload->size());
 
-    return buf_beg + packet.size() /*+ size of whole packet*/;
+    return enc;
+}
+
+uint8_t *write_encoding(const msg_t &msg, const encoding_t &enc, uint8_t *out, bool padded) {
+    if(enc.lead_size == 0)
+        return write_packets(msg.name, *enc.payload, enc.flag, out, NULL, padded);
+
+    // CRC32C is accumulated while text packets are written, then leading packet is filled in exactly
+    uint32_t crc32c = 0;
+    uint8_t *end = write_packets(msg.name, *enc.payload, enc.flag, out + enc.lead_size, &crc32c, padded);
+    write_crc32c_packet(msg.name, crc32c, out);
+
+    return end;
+}
+
+void finish_msg(msg_t &msg, const msg_state_t &state) {
+    check_msg_state(state);
+
+    if(state.compressed) {
+        // Envelope & text trade buffers with scratch, so decoding into reused message settles to no allocations
+        thread_local std::string env;
+        env.swap(msg.text);
+        open_envelope(env.data(), env.data() + env.size(), msg.text);
+    }
+
+    MESSENGER_TRACE_EVENT(msg_complete, msg.name.data(), msg.name.size(), msg.text.size());
 }
 
 } // namespace detail
 
 
-std::vector<uint8_t> make_buff(const msg_t & msg) {
-    // Interface logic: Text and name cant be empty
-    if(msg.name.empty()) throw std::length_error("messenger: make_buf: name is empty");
+size_t buff_size(const msg_t &msg) {
+    detail::check_msg(msg);
 
-    if(msg.name.size() > MSGR_NAME_LEN_MAX) throw std::length_error("messenger: make_buf: name is too long");
+    return detail::buff_size(msg.name.size(), msg.text.size());
+}
 
-    if(msg.text.empty()) throw std::length_error("messenger: make_buf: text is empty");
+uint8_t *write_buff(const msg_t &msg, uint8_t *out) {
+    detail::check_msg(msg);
 
+    return detail::write_packets(msg.name, msg.text, FLAG_BITS, out);
+}
 
+void append_buff(const msg_t &msg, std::vector<uint8_t> &out) {
+    size_t prev_size = out.size();
+    // Grow output exactly once, by size of encoded msg
+    out.resize(prev_size + buff_size(msg));
+
+    write_buff(msg, out.data() + prev_size);
+}
+
+void append_buff(const msg_t &msg, std::vector<uint8_t> &out, const buff_opts_t &opts) {
+    if(!opts.compress && !opts.crc32c)
+        return append_buff(msg, out);
+
+    std::string env;
+    detail::encoding_t enc = detail::plan_encoding(msg, opts, env);
+
+    size_t prev_size = out.size();
+    out.resize(prev_size + enc.size);
+    detail::write_encoding(msg, enc, out.data() + prev_size);
+}
+
+std::vector<uint8_t> make_buff(const msg_t & msg) {
     std::vector<uint8_t> res;
-    // As packet has limit on text size, divide text to several packets
-    std::string::const_iterator next_text_pos = msg.text.begin();
-    while(next_text_pos != msg.text.cend())
-        next_text_pos = detail::push_single_packet(msg.name, next_text_pos, msg.text.cend(), /* out */ res);
+    append_buff(msg, res);
 
     return res;
 }
 
-msg_t parse_buff(std::vector<uint8_t> & buff) {
-    std::string msg_name;
-    std::string msg_text;
-    bool is_name_retrieved = false;
+std::vector<uint8_t> make_buff(const msg_t & msg, const buff_opts_t & opts) {
+    std::vector<uint8_t> res;
+    append_buff(msg, res, opts);
+
+    return res;
+}
+
+void parse_buff(const uint8_t *beg, const uint8_t *end, msg_t &out) {
+    detail::msg_state_t state;
+
+    // Text is shorter than buffer: grow it at most once instead of packet by packet
+    out.text.reserve(end - beg);
 
     // Parse every packet
-    std::vector<uint8_t>::const_iterator cur_iter = buff.begin();
+    const uint8_t *cur = beg;
     do {
-        std::string tmp_name;
-        std::string tmp_text;
-
         // Throws runtime_error on: Invalid CRC4, invalid buff length to construct packet
-        cur_iter = detail::parse_single_packet(cur_iter, buff.cend(), tmp_name, tmp_text);
+        detail::packet_view_t packet = detail::view_packet(cur, end);
+        detail::append_packet(packet, out, state);
 
-        // Check if name persists across packets
-        if(!is_name_retrieved) {
-            msg_name = std::move(tmp_name);
-            is_name_retrieved = true;
-        } else if(msg_name != tmp_name) {
-            throw std::runtime_error("messenger: sender names do not match accross packets");
-        }
-
-        // Add retrieved text
-        msg_text += tmp_text;
-    } while(cur_iter != buff.end());
-
-    return msg_t(msg_name, msg_text);
+        cur = packet.end();
+    } while(cur != end);
+
+    detail::finish_msg(out, state);
+}
+
+msg_t parse_buff(const uint8_t *beg, const uint8_t *end) {
+    msg_t res;
+    parse_buff(beg, end, res);
+
+    return res;
+}
+
+msg_t parse_buff(std::vector<uint8_t> & buff) {
+    return parse_buff(buff.data(), buff.data() + buff.size());
 }
 
 } // namespace messenger
\ No newline at end of file
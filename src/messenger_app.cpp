@@ -1,10 +1,911 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "batch.hpp"
+#include "encode_cache.hpp"
+#include "lazy_msg.hpp"
 #include "messenger.hpp"
+#include "padded.hpp"
+#include "pipeline.hpp"
+#include "reassembler.hpp"
+#include "sender_encoder.hpp"
+#include "shm_ring.hpp"
+#include "spill_queue.hpp"
+#include "text_index.hpp"
+#include "trace.hpp"
+#include "udp.hpp"
+#include "workload.hpp"
 #include "util.hpp"
 
-int main() {
+/**
+ * Allocation counting, used to report allocations of replay
+*/
+static std::atomic<size_t> g_alloc_num(0);
+static std::atomic<size_t> g_alloc_bytes(0);
+
+namespace {
+
+void *counted_new(size_t size) {
+    g_alloc_num.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+
+    void *ptr = std::malloc(size != 0 ? size : 1);
+    if(ptr == NULL)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void *counted_new_aligned(size_t size, std::align_val_t align) {
+    g_alloc_num.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+
+    // aligned_alloc requires size to be multiple of alignment
+    size_t alignment = static_cast<size_t>(align);
+    size_t rounded = (size + alignment - 1) / alignment * alignment;
+    void *ptr = std::aligned_alloc(alignment, rounded != 0 ? rounded : alignment);
+    if(ptr == NULL)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+} // namespace
+
+void *operator new(size_t size) { return counted_new(size); }
+void *operator new[](size_t size) { return counted_new(size); }
+void *operator new(size_t size, std::align_val_t align) { return counted_new_aligned(size, align); }
+void *operator new[](size_t size, std::align_val_t align) { return counted_new_aligned(size, align); }
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+    try {
+        return counted_new(size);
+    } catch(const std::bad_alloc &) {
+        return NULL;
+    }
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+    try {
+        return counted_new(size);
+    } catch(const std::bad_alloc &) {
+        return NULL;
+    }
+}
+
+// Every variant is released by free, so replaced set stays matched
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+namespace {
+
+using bench_clock_t = std::chrono::steady_clock;
+
+/**
+ * Command line options of gen, replay & bench modes
+*/
+struct options_t {
+    messenger::workload::config_t workload;
+    size_t chunk = 64 * 1024;   // replay read size
+    size_t workers = 16;        // bench-pipeline: most workers
+    std::string trace;          // file of recorded trace events
+    std::string file;
+};
+
+void usage() {
+    std::cerr <<
+        "usage: messenger_app                      round-trip demo message\n"
+        "       messenger_app gen [opts] FILE      write synthetic traffic into FILE ('-' for stdout)\n"
+        "       messenger_app replay [opts] FILE   decode traffic from FILE ('-' for stdin)\n"
+        "       messenger_app bench [opts]         generate traffic in memory and replay it\n"
+        "       messenger_app bench-encode [opts]  compare encoders on generated messages\n"
+        "       messenger_app bench-ipc [opts]     compare shared memory ring & socket between processes\n"
+        "       messenger_app bench-pipeline [opts]  decode generated traffic on 1, 2, 4 .. workers cores\n"
+        "       messenger_app bench-index [opts]   substring queries: trigram index vs decoding every message\n"
+        "       messenger_app bench-udp [opts]     loopback datagrams: sendmmsg/recvmmsg batches vs send per message\n"
+        "       messenger_app bench-spill [opts]   burst into stalled consumer: queue in memory vs spilled to file\n"
+        "\n"
+        "options:\n"
+        "  --senders N          number of senders (1000)\n"
+        "  --msgs N             number of messages (100000)\n"
+        "  --name-len MIN:MAX[:MEAN]   sender name length, exponential if MEAN is set (1:15)\n"
+        "  --text-len MIN:MAX[:MEAN]   message text length (1:512:64)\n"
+        "  --vocabulary N       chatty text of words from vocabulary of N words (0 - random characters)\n"
+        "  --compress BYTES     compress texts of at least BYTES (off)\n"
+        "  --crc32c             lead messages with CRC32C packet (off)\n"
+        "  --corrupt RATIO      fraction of corrupted packets (0)\n"
+        "  --interleave N       number of messages, which packets interleave (1)\n"
+        "  --seed N             random seed (1)\n"
+        "  --chunk BYTES        replay read size (65536)\n"
+        "  --workers N          most workers of bench-pipeline (16)\n"
+        "  --trace FILE         record probe points into FILE (build with MESSENGER_TRACE)\n";
+}
+
+// Returns false on malformed command line
+bool parse_options(int argc, char **argv, options_t &opts) {
+    for(int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if(arg.size() < 2 || arg.compare(0, 2, "--") != 0) {
+            opts.file = arg;
+            continue;
+        }
+
+        // Options without value
+        if(arg == "--crc32c") {
+            opts.workload.buff_opts.crc32c = true;
+            continue;
+        }
+
+        if(i + 1 == argc)
+            return false;
+        std::string val = argv[++i];
+
+        if(arg == "--senders") opts.workload.senders = std::stoul(val);
+        else if(arg == "--msgs") opts.workload.msgs = std::stoul(val);
+        else if(arg == "--name-len") opts.workload.name_len = messenger::workload::length_dist_t::parse(val);
+        else if(arg == "--text-len") opts.workload.text_len = messenger::workload::length_dist_t::parse(val);
+        else if(arg == "--vocabulary") opts.workload.vocabulary = std::stoul(val);
+        else if(arg == "--compress") {
+            opts.workload.buff_opts.compress = true;
+            opts.workload.buff_opts.compress_threshold = std::stoul(val);
+        } else if(arg == "--corrupt") opts.workload.corrupt_ratio = std::stod(val);
+        else if(arg == "--interleave") opts.workload.interleave = std::stoul(val);
+        else if(arg == "--seed") opts.workload.seed = std::stoull(val);
+        else if(arg == "--chunk") opts.chunk = std::max<size_t>(std::stoul(val), 1);
+        else if(arg == "--workers") opts.workers = std::max<size_t>(std::stoul(val), 1);
+        else if(arg == "--trace") opts.trace = val;
+        else return false;
+    }
+
+    return true;
+}
+
+// Percentile of sorted samples
+double percentile(const std::vector<double> &sorted, double p) {
+    if(sorted.empty())
+        return 0;
+    return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+}
+
+/**
+ * Source of replayed stream: either memory or FILE
+*/
+struct stream_source_t {
+    const std::vector<uint8_t> *mem = NULL;
+    size_t mem_pos = 0;
+    FILE *file = NULL;
+
+    // Returns number of read bytes, 0 at end of stream
+    size_t read(uint8_t *out, size_t len) {
+        if(file != NULL)
+            return std::fread(out, 1, len, file);
+
+        size_t n = std::min(len, mem->size() - mem_pos);
+        std::memcpy(out, mem->data() + mem_pos, n);
+        mem_pos += n;
+        return n;
+    }
+};
+
+int replay(stream_source_t &source, size_t chunk_size) {
+    size_t msgs = 0;
+    size_t text_bytes = 0;
+    messenger::reassembler_t reasm([&](std::string_view, std::string_view text, messenger::reassembly_reason_t) {
+        msgs++;
+        text_bytes += text.size();
+    });
+
+    std::vector<uint8_t> chunk(chunk_size);
+    std::vector<double> chunk_us;
+    size_t stream_bytes = 0;
+    bench_clock_t::duration decode_time(0);
+    size_t alloc_num = 0;
+    size_t alloc_bytes = 0;
+
+    for(size_t len; (len = source.read(chunk.data(), chunk.size())) != 0; ) {
+        size_t alloc_num_beg = g_alloc_num.load();
+        size_t alloc_bytes_beg = g_alloc_bytes.load();
+        bench_clock_t::time_point beg = bench_clock_t::now();
+
+        reasm.feed(chunk.data(), chunk.data() + len, beg);
+
+        bench_clock_t::duration elapsed = bench_clock_t::now() - beg;
+        alloc_num += g_alloc_num.load() - alloc_num_beg;
+        alloc_bytes += g_alloc_bytes.load() - alloc_bytes_beg;
+
+        decode_time += elapsed;
+        chunk_us.push_back(std::chrono::duration<double, std::micro>(elapsed).count());
+        stream_bytes += len;
+    }
+    reasm.flush();
+
+    messenger::reassembler_stats_t stats = reasm.stats();
+    double sec = std::max(std::chrono::duration<double>(decode_time).count(), 1e-9);
+    std::sort(chunk_us.begin(), chunk_us.end());
+
+    std::cout << "replay:      " << stream_bytes << " bytes, " << stats.packets << " packets, "
+              << msgs << " msgs (" << text_bytes << " text bytes), "
+              << stats.dropped << " dropped packets, " << stats.evicted << " evicted msgs, " << stats.cut << " cut msgs, "
+              << stats.undecodable << " undecodable msgs, " << stats.crc32c_failed << " CRC32C failed msgs" << std::endl;
+    std::cout << "throughput:  " << stream_bytes / sec / 1e6 << " MB/s, "
+              << msgs / sec << " msgs/s, " << stats.packets / sec << " packets/s" << std::endl;
+    std::cout << "allocations: " << alloc_num << " (" << alloc_bytes << " bytes), "
+              << (msgs != 0 ? static_cast<double>(alloc_num) / msgs : 0) << " per msg" << std::endl;
+    std::cout << "chunk decode latency (" << chunk_size << " bytes, us): p50 " << percentile(chunk_us, 0.5)
+              << " p90 " << percentile(chunk_us, 0.9) << " p99 " << percentile(chunk_us, 0.99)
+              << " p99.9 " << percentile(chunk_us, 0.999)
+              << " max " << (chunk_us.empty() ? 0 : chunk_us.back()) << std::endl;
+
+    return 0;
+}
+
+messenger::workload::traffic_t generate(const options_t &opts) {
+    bench_clock_t::time_point beg = bench_clock_t::now();
+    messenger::workload::traffic_t traffic = messenger::workload::generate_traffic(opts.workload);
+    double sec = std::chrono::duration<double>(bench_clock_t::now() - beg).count();
+
+    std::cerr << "generated:   " << traffic.msgs << " msgs (" << traffic.compressed << " compressed, "
+              << traffic.text_bytes << " text bytes), " << traffic.packets << " packets, "
+              << traffic.corrupted << " corrupted, " << traffic.stream.size() << " bytes in "
+              << sec << " s" << std::endl;
+
+    return traffic;
+}
+
+int run_gen(const options_t &opts) {
+    messenger::workload::traffic_t traffic = generate(opts);
+
+    FILE *out = opts.file == "-" ? stdout : std::fopen(opts.file.c_str(), "wb");
+    if(out == NULL) {
+        std::perror(opts.file.c_str());
+        return 1;
+    }
+
+    bool ok = std::fwrite(traffic.stream.data(), 1, traffic.stream.size(), out) == traffic.stream.size();
+    ok = (out == stdout ? std::fflush(out) : std::fclose(out)) == 0 && ok;
+    if(!ok) {
+        std::perror(opts.file.c_str());
+        return 1;
+    }
+
+    return 0;
+}
+
+int run_replay(const options_t &opts) {
+    stream_source_t source;
+    source.file = opts.file == "-" ? stdin : std::fopen(opts.file.c_str(), "rb");
+    if(source.file == NULL) {
+        std::perror(opts.file.c_str());
+        return 1;
+    }
+
+    int res = replay(source, opts.chunk);
+    if(source.file != stdin)
+        std::fclose(source.file);
+
+    return res;
+}
+
+int run_bench(const options_t &opts) {
+    messenger::workload::traffic_t traffic = generate(opts);
+
+    stream_source_t source;
+    source.mem = &traffic.stream;
+
+    return replay(source, opts.chunk);
+}
+
+/**
+ * Run encoder over messages, report its throughput & allocations
+ *
+ * @param encode encodes single message, returns number of encoded bytes
+*/
+template<typename Encode>
+void measure_encoder(const char *label, const std::vector<messenger::msg_t> &msgs, Encode encode) {
+    size_t bytes = 0;
+    size_t alloc_num_beg = g_alloc_num.load();
+    bench_clock_t::time_point beg = bench_clock_t::now();
+
+    for(const messenger::msg_t &msg : msgs)
+        bytes += encode(msg);
+
+    double sec = std::max(std::chrono::duration<double>(bench_clock_t::now() - beg).count(), 1e-9);
+    size_t alloc_num = g_alloc_num.load() - alloc_num_beg;
+
+    std::cout << label << msgs.size() / sec << " msgs/s, " << bytes / sec / 1e6 << " MB/s, "
+              << static_cast<double>(alloc_num) / msgs.size() << " allocs/msg, " << bytes << " bytes" << std::endl;
+}
+
+/**
+ * Run whole-batch operation once, report its throughput & allocations per message
+ *
+ * @param run processes all msgs_num messages, returns number of processed bytes
+*/
+template<typename Run>
+void measure_batch(const char *label, size_t msgs_num, Run run) {
+    size_t alloc_num_beg = g_alloc_num.load();
+    bench_clock_t::time_point beg = bench_clock_t::now();
+
+    size_t bytes = run();
+
+    double sec = std::max(std::chrono::duration<double>(bench_clock_t::now() - beg).count(), 1e-9);
+    size_t alloc_num = g_alloc_num.load() - alloc_num_beg;
+
+    std::cout << label << msgs_num / sec << " msgs/s, " << bytes / sec / 1e6 << " MB/s, "
+              << static_cast<double>(alloc_num) / msgs_num << " allocs/msg, " << bytes << " bytes" << std::endl;
+}
+
+int run_bench_encode(const options_t &opts) {
+    std::vector<messenger::msg_t> msgs = messenger::workload::generate_msgs(opts.workload);
+
+    measure_encoder("make_buff:        ", msgs, [](const messenger::msg_t &msg) {
+        return messenger::make_buff(msg).size();
+    });
+
+    std::vector<uint8_t> out;
+    measure_encoder("append_buff:      ", msgs, [&](const messenger::msg_t &msg) {
+        out.clear();
+        messenger::append_buff(msg, out);
+        return out.size();
+    });
+
+    messenger::util::padded_buffer_t padded_out;
+    measure_encoder("padded append:    ", msgs, [&](const messenger::msg_t &msg) {
+        padded_out.clear();
+        messenger::append_buff(msg, padded_out);
+        return padded_out.size();
+    });
+
+    if(opts.workload.buff_opts.compress) {
+        messenger::buff_opts_t compress_opts = opts.workload.buff_opts;
+        compress_opts.crc32c = false;
+        measure_encoder("compressed:       ", msgs, [&](const messenger::msg_t &msg) {
+            out.clear();
+            messenger::append_buff(msg, out, compress_opts);
+            return out.size();
+        });
+    }
+
+    if(opts.workload.buff_opts.crc32c) {
+        std::cout << "crc32c implementation: " << messenger::util::crc32c_impl() << std::endl;
+        measure_encoder("crc32c:           ", msgs, [&](const messenger::msg_t &msg) {
+            out.clear();
+            messenger::append_buff(msg, out, opts.workload.buff_opts);
+            return out.size();
+        });
+    }
+
+    // Encoders are built once per sender, before measurement
+    std::unordered_map<std::string, messenger::sender_encoder_t> encoders;
+    for(const messenger::msg_t &msg : msgs)
+        encoders.emplace(msg.name, messenger::sender_encoder_t(msg.name));
+
+    measure_encoder("sender_encoder_t: ", msgs, [&](const messenger::msg_t &msg) {
+        out.clear();
+        encoders.at(msg.name).append(msg.text, out);
+        return out.size();
+    });
+
+    // Encode cache: unique messages (every encode misses), then heartbeats (same 256 messages repeated)
+    messenger::encode_cache_config_t cache_config;
+    cache_config.encoding = opts.workload.buff_opts;
+    messenger::encode_cache_t cache(cache_config);
+    measure_encoder("encode_cache_t:   ", msgs, [&](const messenger::msg_t &msg) {
+        return cache.encode(msg)->size();
+    });
+
+    std::vector<messenger::msg_t> heartbeats;
+    for(size_t i = 0; i < msgs.size(); ++i)
+        heartbeats.push_back(msgs[i % std::min<size_t>(msgs.size(), 256)]);
+
+    measure_encoder("heartbeats, make_buff:      ", heartbeats, [&](const messenger::msg_t &msg) {
+        return messenger::make_buff(msg, opts.workload.buff_opts).size();
+    });
+    messenger::encode_cache_t heartbeat_cache(cache_config);
+    measure_encoder("heartbeats, encode_cache_t: ", heartbeats, [&](const messenger::msg_t &msg) {
+        return heartbeat_cache.encode(msg)->size();
+    });
+    std::cout << "heartbeats, encode_cache_t hit rate: " << heartbeat_cache.stats().hit_rate() << std::endl;
+
+    // Batch: one buffer for all messages, then decoding it message by message vs in one pass
+    messenger::msg_batch_t batch;
+    measure_batch("make_buff_batch:  ", msgs.size(), [&]() {
+        messenger::make_buff_batch(msgs.data(), msgs.data() + msgs.size(), batch, opts.workload.buff_opts);
+        return batch.buff.size();
+    });
+
+    measure_batch("parse_buff loop:  ", msgs.size(), [&]() {
+        size_t bytes = 0;
+        for(size_t i = 0; i < batch.size(); ++i)
+            bytes += messenger::parse_buff(batch.msg_begin(i), batch.msg_end(i)).text.size();
+        return bytes;
+    });
+
+    // Same batch with padding: every message is followed by readable bytes
+    messenger::util::padded_buffer_t padded_batch(batch.buff.data(), batch.buff.data() + batch.buff.size());
+    messenger::msg_t reused;
+    measure_batch("reused parse:     ", msgs.size(), [&]() {
+        size_t bytes = 0;
+        for(size_t i = 0; i < batch.size(); ++i) {
+            messenger::parse_buff(batch.msg_begin(i), batch.msg_end(i), reused);
+            bytes += reused.text.size();
+        }
+        return bytes;
+    });
+
+    measure_batch("padded parse:     ", msgs.size(), [&]() {
+        size_t bytes = 0;
+        for(size_t i = 0; i < batch.size(); ++i) {
+            messenger::parse_buff_padded(padded_batch.data() + batch.offsets[i], padded_batch.data() + batch.offsets[i + 1], reused);
+            bytes += reused.text.size();
+        }
+        return bytes;
+    });
+
+    // Lazy handles: route on name only, or stream text without assembling it
+    messenger::lazy_msg_t::buff_ptr_t shared_batch = std::make_shared<const std::vector<uint8_t>>(batch.buff);
+    measure_batch("lazy, name only:  ", msgs.size(), [&]() {
+        size_t bytes = 0;
+        for(size_t i = 0; i < batch.size(); ++i)
+            bytes += messenger::lazy_msg_t(shared_batch, batch.offsets[i], batch.offsets[i + 1]).name().size();
+        return bytes;
+    });
+
+    measure_batch("lazy, stream:     ", msgs.size(), [&]() {
+        size_t bytes = 0;
+        for(size_t i = 0; i < batch.size(); ++i) {
+            messenger::lazy_msg_t(shared_batch, batch.offsets[i], batch.offsets[i + 1]).stream_text([&](std::string_view piece) {
+                bytes += piece.size();
+            });
+        }
+        return bytes;
+    });
+
+    messenger::parsed_batch_t parsed;
+    measure_batch("parse_batch:      ", msgs.size(), [&]() {
+        messenger::parse_batch(batch, parsed);
+        return parsed.texts.size();
+    });
+
+    messenger::columnar_batch_t cols;
+    measure_batch("append_columnar:  ", msgs.size(), [&]() {
+        messenger::append_columnar(batch, cols);
+        return cols.texts.size();
+    });
+
+    // Analytics scan: text bytes & messages containing '!' per sender, over msg_t vs columns
+    std::vector<messenger::msg_t> decoded;
+    for(size_t i = 0; i < batch.size(); ++i)
+        decoded.push_back(messenger::parse_buff(batch.msg_begin(i), batch.msg_end(i)));
+
+    std::unordered_map<std::string, size_t> bytes_by_name;
+    measure_batch("scan msg_t:       ", msgs.size(), [&]() {
+        size_t bytes = 0;
+        for(const messenger::msg_t &msg : decoded) {
+            if(msg.text.find('!') != std::string::npos)
+                bytes_by_name[msg.name] += msg.text.size();
+            bytes += msg.text.size();
+        }
+        return bytes;
+    });
+
+    std::vector<size_t> bytes_by_id(cols.senders.size());
+    measure_batch("scan columnar:    ", msgs.size(), [&]() {
+        for(size_t i = 0; i < cols.size(); ++i) {
+            if(cols.text(i).find('!') != std::string_view::npos)
+                bytes_by_id[cols.sender_ids[i]] += cols.text_offsets[i + 1] - cols.text_offsets[i];
+        }
+        return cols.texts.size();
+    });
+
+    return 0;
+}
+
+/**
+ * Results of consumer process of bench-ipc, shared with producer
+*/
+struct ipc_result_t {
+    std::atomic<size_t> msgs;       // delivered messages
+    size_t bytes;
+    bench_clock_t::rep end;         // time of last delivery
+    double latency_us[5];           // p50, p90, p99, p99.9, max
+};
+
+/**
+ * Run producer in this process & consumer in child process, connected by transport
+ *
+ * @param paced whether producer waits for delivery of previous message (latency),
+ *              or sends as fast as it can (throughput)
+ * @param send sends single message
+ * @param finish ends stream
+ * @param consume feeds received bytes into reassembler until end of stream
+*/
+template<typename Send, typename Finish, typename Consume>
+void measure_ipc(const char *label, const std::vector<messenger::msg_t> &msgs, bool paced,
+                 Send send, Finish finish, Consume consume) {
+    // Shared with child: send times of messages & results
+    size_t shared_size = sizeof(ipc_result_t) + msgs.size() * sizeof(bench_clock_t::rep);
+    void *shared = mmap(NULL, shared_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(shared == MAP_FAILED)
+        throw std::runtime_error("mmap failed");
+
+    ipc_result_t *result = new (shared) ipc_result_t();
+    bench_clock_t::rep *sent = reinterpret_cast<bench_clock_t::rep *>(result + 1);
+
+    pid_t pid = fork();
+    if(pid < 0)
+        throw std::runtime_error("fork failed");
+
+    if(pid == 0) {
+        std::vector<double> latency_us;
+        latency_us.reserve(msgs.size());
+
+        messenger::reassembler_t reasm([&](std::string_view, std::string_view text, messenger::reassembly_reason_t) {
+            bench_clock_t::rep now = bench_clock_t::now().time_since_epoch().count();
+            latency_us.push_back(std::chrono::duration<double, std::micro>(
+                bench_clock_t::duration(now - sent[latency_us.size()])).count());
+            result->bytes += text.size();
+            result->msgs.store(latency_us.size(), std::memory_order_release);
+        });
+
+        consume(reasm);
+        result->end = bench_clock_t::now().time_since_epoch().count();
+
+        std::sort(latency_us.begin(), latency_us.end());
+        const double ps[] = {0.5, 0.9, 0.99, 0.999};
+        for(size_t i = 0; i < 4; ++i)
+            result->latency_us[i] = percentile(latency_us, ps[i]);
+        result->latency_us[4] = latency_us.empty() ? 0 : latency_us.back();
+        _exit(0);
+    }
+
+    bench_clock_t::time_point beg = bench_clock_t::now();
+    for(size_t i = 0; i < msgs.size(); ++i) {
+        while(paced && result->msgs.load(std::memory_order_acquire) < i) {}
+
+        sent[i] = bench_clock_t::now().time_since_epoch().count();
+        send(msgs[i]);
+    }
+    finish();
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+
+    double sec = std::max(std::chrono::duration<double>(
+        bench_clock_t::duration(result->end) - beg.time_since_epoch()).count(), 1e-9);
+
+    std::cout << label << (paced ? "paced:  " : "flood:  ") << result->msgs << " msgs, "
+              << result->msgs / sec << " msgs/s, " << result->bytes / sec / 1e6 << " MB/s of text; "
+              << "latency (us): p50 " << result->latency_us[0] << " p90 " << result->latency_us[1]
+              << " p99 " << result->latency_us[2] << " p99.9 " << result->latency_us[3]
+              << " max " << result->latency_us[4] << std::endl;
+
+    munmap(shared, shared_size);
+}
+
+int run_bench_ipc(const options_t &opts) {
+    std::vector<messenger::msg_t> msgs = messenger::workload::generate_msgs(opts.workload);
+
+    // Flood measures throughput (latency is dominated by queueing), paced measures latency
+    for(bool paced : {false, true}) {
+        // Shared memory: packets are encoded into ring & decoded in place
+        messenger::shm_ring_t ring = messenger::shm_ring_t::create(1 << 20);
+        ring.set_role(messenger::shm_ring_t::role_t::producer);
+
+        measure_ipc("shm ring   ", msgs, paced, [&](const messenger::msg_t &msg) {
+            ring.write(msg);
+        }, [&]() {
+            ring.close();
+        }, [&](messenger::reassembler_t &reasm) {
+            ring.set_role(messenger::shm_ring_t::role_t::consumer);
+            size_t len;
+            while(const uint8_t *data = ring.read(len)) {
+                reasm.feed(data, data + len);
+                ring.release(len);
+            }
+        });
+
+        // Socket: make_buff per message, copied into kernel & out of it
+        int fds[2];
+        if(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+            throw std::runtime_error("socketpair failed");
+
+        measure_ipc("socketpair ", msgs, paced, [&](const messenger::msg_t &msg) {
+            std::vector<uint8_t> buff = messenger::make_buff(msg);
+            for(size_t pos = 0; pos < buff.size(); ) {
+                ssize_t res = ::write(fds[0], buff.data() + pos, buff.size() - pos);
+                if(res <= 0)
+                    throw std::runtime_error("write failed");
+                pos += res;
+            }
+        }, [&]() {
+            close(fds[0]);
+            close(fds[1]);
+        }, [&](messenger::reassembler_t &reasm) {
+            close(fds[0]);
+            std::vector<uint8_t> chunk(opts.chunk);
+            for(ssize_t len; (len = ::read(fds[1], chunk.data(), chunk.size())) > 0; )
+                reasm.feed(chunk.data(), chunk.data() + len);
+        });
+    }
+
+    return 0;
+}
+
+int run_bench_pipeline(const options_t &opts) {
+    messenger::workload::traffic_t traffic = generate(opts);
+    const std::vector<uint8_t> &stream = traffic.stream;
+
+    // Baseline: single reassembler_t in caller's thread
+    double base_sec;
+    {
+        messenger::reassembler_t reasm([](std::string_view, std::string_view, messenger::reassembly_reason_t) {});
+        bench_clock_t::time_point beg = bench_clock_t::now();
+        for(size_t pos = 0; pos < stream.size(); pos += opts.chunk)
+            reasm.feed(stream.data() + pos, stream.data() + std::min(pos + opts.chunk, stream.size()));
+        reasm.flush();
+        base_sec = std::max(std::chrono::duration<double>(bench_clock_t::now() - beg).count(), 1e-9);
+
+        std::cout << "reassembler_t:    " << traffic.msgs / base_sec << " msgs/s, "
+                  << stream.size() / base_sec / 1e6 << " MB/s" << std::endl;
+    }
+
+    std::cout << "hardware threads: " << std::thread::hardware_concurrency() << std::endl;
+
+    for(size_t workers = 1; workers <= opts.workers; workers *= 2) {
+        messenger::pipeline_config_t config;
+        config.workers = workers;
+
+        messenger::pipeline_t pipeline([](std::string_view, std::string_view, messenger::reassembly_reason_t) {}, config);
+
+        bench_clock_t::time_point beg = bench_clock_t::now();
+        for(size_t pos = 0; pos < stream.size(); pos += opts.chunk)
+            pipeline.feed(stream.data() + pos, stream.data() + std::min(pos + opts.chunk, stream.size()));
+        pipeline.flush();
+        double sec = std::max(std::chrono::duration<double>(bench_clock_t::now() - beg).count(), 1e-9);
+
+        messenger::pipeline_stats_t stats = pipeline.stats();
+        std::cout << "pipeline_t x" << workers << (workers < 10 ? ":  " : ": ") << stats.reassembly.msgs / sec
+                  << " msgs/s, " << stream.size() / sec / 1e6 << " MB/s, speedup " << base_sec / sec << ", "
+                  << stats.batches << " batches (" << stats.stolen << " stolen)" << std::endl;
+    }
+
+    return 0;
+}
+
+int run_bench_index(const options_t &opts) {
+    std::vector<messenger::msg_t> msgs = messenger::workload::generate_msgs(opts.workload);
+
+    messenger::text_index_config_t config;
+    config.encoding = opts.workload.buff_opts;
+    messenger::text_index_t index(config);
+
+    bench_clock_t::time_point beg = bench_clock_t::now();
+    for(const messenger::msg_t &msg : msgs)
+        index.insert(msg);
+    double sec = std::max(std::chrono::duration<double>(bench_clock_t::now() - beg).count(), 1e-9);
+
+    messenger::text_index_stats_t stats = index.stats();
+    std::cout << "index build: " << msgs.size() / sec << " msgs/s, " << stats.text_bytes / sec / 1e6 << " MB/s of text; "
+              << stats.trigrams << " trigrams, " << stats.posting_bytes << " posting bytes ("
+              << static_cast<double>(stats.posting_bytes) / stats.text_bytes << " per text byte), "
+              << stats.stored_bytes << " stored bytes" << std::endl;
+
+    // Queries are substrings of stored texts, 4 to 20 bytes long
+    std::mt19937_64 rng(opts.workload.seed);
+    std::vector<std::string> patterns;
+    for(size_t i = 0; i < 100; ++i) {
+        const std::string &text = msgs[rng() % msgs.size()].text;
+        size_t len = std::min<size_t>(4 + rng() % 17, text.size());
+        patterns.push_back(text.substr(rng() % (text.size() - len + 1), len));
+    }
+
+    size_t hits = 0;
+    beg = bench_clock_t::now();
+    for(const std::string &pattern : patterns)
+        hits += index.find(pattern).size();
+    double index_sec = std::chrono::duration<double>(bench_clock_t::now() - beg).count();
+
+    // Baseline: decode every stored message & search its text
+    messenger::msg_batch_t batch = messenger::make_buff_batch(msgs.data(), msgs.data() + msgs.size(), opts.workload.buff_opts);
+    messenger::msg_t msg;
+    size_t scan_hits = 0;
+    beg = bench_clock_t::now();
+    for(const std::string &pattern : patterns) {
+        for(size_t i = 0; i < batch.size(); ++i) {
+            messenger::parse_buff(batch.msg_begin(i), batch.msg_end(i), msg);
+            scan_hits += msg.text.find(pattern) != std::string::npos;
+        }
+    }
+    double scan_sec = std::chrono::duration<double>(bench_clock_t::now() - beg).count();
+
+    std::cout << "text_index_t: " << index_sec * 1e3 / patterns.size() << " ms/query, " << hits << " hits" << std::endl;
+    std::cout << "decode & scan: " << scan_sec * 1e3 / patterns.size() << " ms/query, " << scan_hits << " hits" << std::endl;
+
+    return hits == scan_hits ? 0 : 1;
+}
+
+/**
+ * Send messages over loopback, while receiver thread decodes them
+ *
+ * @param send sends all messages, returns sender statistics
+ * @param config configuration of receiver
+*/
+template<typename Send>
+void measure_udp(const char *label, const std::vector<messenger::msg_t> &msgs, Send send,
+                 const messenger::udp_config_t &config) {
+    messenger::udp_socket_t rx_sock = messenger::udp_socket_t::bind("127.0.0.1");
+    messenger::udp_socket_t tx_sock = messenger::udp_socket_t::connect("127.0.0.1", rx_sock.port());
+    rx_sock.set_recv_buffer(64 << 20);
+
+    size_t received = 0;
+    std::atomic<bool> sent(false);
+    messenger::udp_receiver_t receiver(rx_sock.fd(), [&](std::string_view, std::string_view) { received++; }, config);
+
+    bench_clock_t::time_point end;
+    std::thread thread([&]() {
+        // Lost datagrams never arrive: stop once sender is done & nothing is queued
+        while(received < msgs.size()) {
+            if(receiver.receive(std::chrono::milliseconds(100)) == 0 && sent.load(std::memory_order_acquire))
+                break;
+        }
+        end = bench_clock_t::now();
+    });
+
+    bench_clock_t::time_point beg = bench_clock_t::now();
+    messenger::udp_stats_t tx = send(tx_sock.fd());
+    sent.store(true, std::memory_order_release);
+    thread.join();
+
+    double sec = std::max(std::chrono::duration<double>(end - beg).count(), 1e-9);
+    messenger::udp_stats_t rx = receiver.stats();
+    std::cout << label << received / sec << " msgs/s, " << rx.datagrams / sec << " datagrams/s, "
+              << static_cast<double>(rx.bytes) / std::max<size_t>(rx.datagrams, 1) << " bytes/datagram; syscalls/msg: send "
+              << static_cast<double>(tx.syscalls) / msgs.size() << ", receive "
+              << static_cast<double>(rx.syscalls) / std::max<size_t>(received, 1) << "; "
+              << msgs.size() - received << " lost" << std::endl;
+}
+
+int run_bench_udp(const options_t &opts) {
+    std::vector<messenger::msg_t> msgs = messenger::workload::generate_msgs(opts.workload);
+
+    messenger::udp_config_t config;
+    config.encoding = opts.workload.buff_opts;
+
+    // Messages, which do not fit datagram, are left out of both runs
+    msgs.erase(std::remove_if(msgs.begin(), msgs.end(), [&](const messenger::msg_t &msg) {
+        return messenger::make_buff(msg, config.encoding).size() > config.datagram_size;
+    }), msgs.end());
+
+    // Whole messages packed into datagrams, batches of datagrams per syscall
+    measure_udp("udp batched:   ", msgs, [&](int fd) {
+        messenger::udp_sender_t sender(fd, config);
+        for(const messenger::msg_t &msg : msgs)
+            sender.send(msg);
+        sender.flush();
+        return sender.stats();
+    }, config);
+
+    // Baseline: make_buff & send per message, recv per datagram
+    messenger::udp_config_t single = config;
+    single.batch = 1;
+    measure_udp("send per msg:  ", msgs, [&](int fd) {
+        messenger::udp_stats_t stats;
+        for(const messenger::msg_t &msg : msgs) {
+            std::vector<uint8_t> buff = messenger::make_buff(msg, config.encoding);
+            if(::send(fd, buff.data(), buff.size(), 0) != static_cast<ssize_t>(buff.size()))
+                throw std::runtime_error("send failed");
+            stats.syscalls++;
+        }
+        return stats;
+    }, single);
+
+    return 0;
+}
+
+int run_bench_spill(const options_t &opts) {
+    std::vector<messenger::msg_t> msgs = messenger::workload::generate_msgs(opts.workload);
+
+    // Consumer stalls for whole burst, then catches up
+    for(bool spill : {false, true}) {
+        messenger::spill_queue_config_t config;
+        config.encoding = opts.workload.buff_opts;
+        config.memory_limit = spill ? 1024 * 1024 : SIZE_MAX;
+        config.disk_limit = SIZE_MAX;
+        messenger::spill_queue_t queue(config);
+
+        bench_clock_t::time_point beg = bench_clock_t::now();
+        for(const messenger::msg_t &msg : msgs)
+            queue.push(msg);
+        double push_sec = std::max(std::chrono::duration<double>(bench_clock_t::now() - beg).count(), 1e-9);
+        messenger::spill_queue_stats_t stats = queue.stats();
+
+        // Consumer copies chunks out, as socket write would
+        std::vector<uint8_t> chunk(opts.chunk);
+        size_t len;
+        beg = bench_clock_t::now();
+        while(const uint8_t *data = queue.read(len)) {
+            len = std::min(len, chunk.size());
+            std::memcpy(chunk.data(), data, len);
+            queue.release(len);
+        }
+        double read_sec = std::max(std::chrono::duration<double>(bench_clock_t::now() - beg).count(), 1e-9);
+
+        std::cout << (spill ? "spilled: " : "memory:  ") << "push " << msgs.size() / push_sec << " msgs/s, "
+                  << stats.pushed_bytes / push_sec / 1e6 << " MB/s; replay " << stats.pushed_bytes / read_sec / 1e6
+                  << " MB/s; peak " << stats.memory_bytes / 1e6 << " MB in memory, " << stats.disk_bytes / 1e6
+                  << " MB in file" << std::endl;
+    }
+
+    return 0;
+}
+
+int run_mode(const std::string &mode, const options_t &opts) {
+    if(mode == "gen" && !opts.file.empty())
+        return run_gen(opts);
+    if(mode == "replay" && !opts.file.empty())
+        return run_replay(opts);
+    if(mode == "bench")
+        return run_bench(opts);
+    if(mode == "bench-encode")
+        return run_bench_encode(opts);
+    if(mode == "bench-ipc")
+        return run_bench_ipc(opts);
+    if(mode == "bench-pipeline")
+        return run_bench_pipeline(opts);
+    if(mode == "bench-index")
+        return run_bench_index(opts);
+    if(mode == "bench-udp")
+        return run_bench_udp(opts);
+    if(mode == "bench-spill")
+        return run_bench_spill(opts);
+
+    usage();
+    return 2;
+}
+
+// Run mode with trace recorder attached, then write recorded events into opts.trace
+int run_traced(const std::string &mode, const options_t &opts) {
+    if(!messenger::trace::ENABLED)
+        std::cerr << "messenger_app: built without MESSENGER_TRACE, trace is empty" << std::endl;
+
+    messenger::trace::recorder_t recorder(1 << 20);
+    messenger::trace::attach(&recorder);
+    int res = run_mode(mode, opts);
+    messenger::trace::attach(NULL);
+
+    std::ofstream out(opts.trace);
+    recorder.dump(out);
+    std::cerr << "trace:       " << recorder.recorded() << " events, last "
+              << std::min<uint64_t>(recorder.recorded(), recorder.capacity()) << " written to " << opts.trace << std::endl;
+
+    return res;
+}
+
+int run_demo() {
     messenger::msg_t msg("Vafo", "HELO EVERDAIANE!!1 dwam jdwn aknwkjan dknaw ndkjanw kj nwa");
     std::vector<uint8_t> buff = messenger::make_buff(msg);
 
@@ -34,4 +935,26 @@ int main() {
     // Consider adding custom buffer test
 
     return 0;
-}
\ No newline at end of file
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    if(argc < 2)
+        return run_demo();
+
+    std::string mode = argv[1];
+    options_t opts;
+
+    try {
+        if(!parse_options(argc, argv, opts)) {
+            usage();
+            return 2;
+        }
+
+        return opts.trace.empty() ? run_mode(mode, opts) : run_traced(mode, opts);
+    } catch(const std::exception &e) {
+        std::cerr << "messenger_app: " << e.what() << std::endl;
+        return 1;
+    }
+}
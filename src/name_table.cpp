@@ -0,0 +1,106 @@
+#include "name_table.hpp"
+
+namespace messenger::detail {
+
+static const size_t MIN_SLOT_NUM = 16;
+static const size_t NO_SLOT = SIZE_MAX;
+
+uint64_t name_key_t::hash() const {
+    uint64_t lo, hi;
+    std::memcpy(&lo, bytes, sizeof(lo));
+    std::memcpy(&hi, bytes + sizeof(lo), sizeof(hi));
+
+    // Multiply-xorshift mix of both halves
+    uint64_t h = lo * 0x9E3779B97F4A7C15ull ^ hi * 0xC2B2AE3D27D4EB4Full;
+    h ^= h >> 32;
+    h *= 0xD6E8FEB86659FD93ull;
+    h ^= h >> 29;
+
+    return h;
+}
+
+name_index_t::name_index_t()
+    : m_slots(MIN_SLOT_NUM, slot_t{name_key_t(), EMPTY})
+    , m_size(0)
+    , m_used(0)
+{}
+
+size_t name_index_t::find_slot(const name_key_t &key) const {
+    size_t mask = m_slots.size() - 1;
+
+    for(size_t i = key.hash() & mask; ; i = (i + 1) & mask) {
+        const slot_t &slot = m_slots[i];
+        if(slot.value == EMPTY)
+            return NO_SLOT;
+        if(slot.value != TOMBSTONE && slot.key == key)
+            return i;
+    }
+}
+
+uint32_t name_index_t::find(const name_key_t &key) const {
+    size_t slot = find_slot(key);
+    return slot == NO_SLOT ? npos : m_slots[slot].value;
+}
+
+void name_index_t::insert(const name_key_t &key, uint32_t value) {
+    assertm(value != EMPTY && value != TOMBSTONE, "name_index_t: reserved value is inserted");
+    assertm(find_slot(key) == NO_SLOT, "name_index_t: key is already present");
+
+    // Keep keys & tombstones under 3/4 of slots
+    if((m_used + 1) * 4 > m_slots.size() * 3) {
+        // Grow only if keys take the space, otherwise rehash just drops tombstones
+        size_t slot_num = (m_size + 1) * 2 * 4 > m_slots.size() * 3 ? m_slots.size() * 2 : m_slots.size();
+        rehash(slot_num);
+    }
+
+    size_t mask = m_slots.size() - 1;
+    size_t i = key.hash() & mask;
+    while(m_slots[i].value != EMPTY && m_slots[i].value != TOMBSTONE)
+        i = (i + 1) & mask;
+
+    if(m_slots[i].value == EMPTY)
+        m_used++;
+
+    m_slots[i].key = key;
+    m_slots[i].value = value;
+    m_size++;
+}
+
+void name_index_t::erase(const name_key_t &key) {
+    size_t slot = find_slot(key);
+    if(slot == NO_SLOT)
+        return;
+
+    m_slots[slot].value = TOMBSTONE;
+    m_size--;
+}
+
+void name_index_t::clear() {
+    for(slot_t &slot : m_slots)
+        slot.value = EMPTY;
+
+    m_size = 0;
+    m_used = 0;
+}
+
+void name_index_t::rehash(size_t slot_num) {
+    // Spare table becomes new one, old one is kept for next rehash
+    m_spare.assign(slot_num, slot_t{name_key_t(), EMPTY});
+    m_spare.swap(m_slots);
+
+    size_t mask = m_slots.size() - 1;
+    for(const slot_t &slot : m_spare) {
+        if(slot.value == EMPTY || slot.value == TOMBSTONE)
+            continue;
+
+        size_t i = slot.key.hash() & mask;
+        while(m_slots[i].value != EMPTY)
+            i = (i + 1) & mask;
+
+        m_slots[i] = slot;
+    }
+
+    m_used = m_size;
+}
+
+} // namespace messenger::detail
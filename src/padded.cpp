@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <new>
+
+#include "padded.hpp"
+#include "packet.hpp"
+
+namespace messenger {
+
+namespace util {
+
+void padded_buffer_t::free_t::operator()(uint8_t *ptr) const {
+    ::operator delete[](ptr, std::align_val_t(ALIGNMENT));
+}
+
+padded_buffer_t::padded_buffer_t(const uint8_t *beg, const uint8_t *end) {
+    append(beg, end);
+}
+
+padded_buffer_t::padded_buffer_t(const padded_buffer_t &other) {
+    append(other.begin(), other.end());
+}
+
+padded_buffer_t &padded_buffer_t::operator=(const padded_buffer_t &other) {
+    if(this != &other) {
+        clear();
+        append(other.begin(), other.end());
+    }
+
+    return *this;
+}
+
+padded_buffer_t::padded_buffer_t(padded_buffer_t &&other) noexcept
+    : m_data(std::move(other.m_data))
+    , m_size(other.m_size)
+    , m_capacity(other.m_capacity)
+{
+    other.m_size = 0;
+    other.m_capacity = 0;
+}
+
+padded_buffer_t &padded_buffer_t::operator=(padded_buffer_t &&other) noexcept {
+    if(this != &other) {
+        m_data = std::move(other.m_data);
+        m_size = other.m_size;
+        m_capacity = other.m_capacity;
+        other.m_size = 0;
+        other.m_capacity = 0;
+    }
+
+    return *this;
+}
+
+void padded_buffer_t::reserve(size_t capacity) {
+    if(capacity <= m_capacity)
+        return;
+
+    uint8_t *ptr = static_cast<uint8_t *>(::operator new[](capacity + PADDING, std::align_val_t(ALIGNMENT)));
+    std::unique_ptr<uint8_t[], free_t> storage(ptr);
+
+    if(m_size != 0)
+        std::memcpy(ptr, m_data.get(), m_size);
+    std::memset(ptr + m_size, 0, capacity + PADDING - m_size);
+
+    m_data = std::move(storage);
+    m_capacity = capacity;
+}
+
+void padded_buffer_t::resize(size_t size) {
+    if(size > m_capacity)
+        reserve(std::max(size, 2 * m_capacity));
+
+    m_size = size;
+}
+
+void padded_buffer_t::append(const uint8_t *beg, const uint8_t *end) {
+    size_t prev_size = m_size;
+    resize(prev_size + (end - beg));
+
+    if(beg != end)
+        std::memcpy(data() + prev_size, beg, end - beg);
+}
+
+} // namespace util
+
+
+uint8_t *write_buff_padded(const msg_t &msg, uint8_t *out) {
+    buff_size(msg);     // validates message
+
+    return detail::write_packets(msg.name, msg.text, FLAG_BITS, out, NULL, true);
+}
+
+void append_buff(const msg_t &msg, util::padded_buffer_t &out, const buff_opts_t &opts) {
+    std::string env;
+    detail::encoding_t enc = detail::plan_encoding(msg, opts, env);
+
+    // Buffer keeps PADDING bytes of slack past its size, so packets are written by fixed-width copies
+    size_t prev_size = out.size();
+    out.resize(prev_size + enc.size);
+    detail::write_encoding(msg, enc, out.data() + prev_size, true);
+}
+
+void parse_buff_padded(const uint8_t *beg, const uint8_t *end, msg_t &out) {
+    detail::msg_state_t state;
+
+    // Text is shorter than buffer: it is sized once, so every msg field is stored by single 32-byte copy.
+    // Reused text is zero filled only past its previous size
+    size_t text_room = (end - beg) + util::PADDING;
+    if(out.text.size() < text_room)
+        out.text.resize(text_room);
+    char *text = &out.text[0];
+
+    try {
+        const uint8_t *cur = beg;
+        do {
+            detail::packet_view_t packet = detail::view_packet(cur, end);
+            if(state.packets == 0)
+                out.name.assign(packet.name(), packet.name_len());
+
+            size_t text_len = state.text_len;
+            if(detail::accept_packet(packet, state))
+                util::copy32(text + text_len, packet.msg());    // input has padding after end
+
+            cur = packet.end();
+        } while(cur != end);
+    } catch(...) {
+        out.text.clear();
+        throw;
+    }
+
+    out.text.resize(state.text_len);
+    detail::finish_msg(out, state);
+}
+
+void parse_buff(const util::padded_buffer_t &buff, msg_t &out) {
+    parse_buff_padded(buff.begin(), buff.end(), out);
+}
+
+} // namespace messenger
@@ -0,0 +1,293 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "pipeline.hpp"
+#include "msg_hdr.hpp"
+#include "name_table.hpp"
+#include "queue.hpp"
+
+namespace messenger {
+
+namespace detail {
+
+/**
+ * Shard of pipeline_t: senders, which names hash to it, with their reassembler
+*/
+struct pipeline_shard_t
+{
+    pipeline_shard_t(const reassembler_t::deliver_t &deliver, const pipeline_config_t &config)
+        : queue(config.queue_batches)
+        , spare(config.queue_batches + 2)
+        , busy(false)
+        , reasm(deliver, config.reassembler)
+        , batches(0)
+        , stolen(0)
+    {}
+
+    util::spsc_queue_t<std::vector<uint8_t>> queue;     // full batches: framing stage -> worker
+    util::spsc_queue_t<std::vector<uint8_t>> spare;     // emptied batches: worker -> framing stage
+
+    std::vector<uint8_t> pending;                       // batch filled by framing stage
+
+    alignas(64) std::atomic<bool> busy;                 // held by worker, which processes shard
+    reassembler_t reasm;                                // guarded by busy
+    size_t batches;                                     // guarded by busy
+    size_t stolen;                                      // guarded by busy
+};
+
+// Invalid flag bits break framing of stream, so they are not recoverable
+static void check_flag(const uint8_t *hdr) {
+    if(!hdr_info(hdr).flag_ok())
+        throw std::runtime_error("messenger: pipeline_t: invalid flag bits");
+}
+
+// Wait for shard, which may be processed by worker
+static void lock_shard(pipeline_shard_t &shard) {
+    while(shard.busy.exchange(true, std::memory_order_acquire))
+        std::this_thread::yield();
+}
+
+static void unlock_shard(pipeline_shard_t &shard) {
+    shard.busy.store(false, std::memory_order_release);
+}
+
+} // namespace detail
+
+
+// Batches processed by worker before it moves on to other shard
+static const size_t BATCHES_PER_TURN = 8;
+
+pipeline_t::pipeline_t(reassembler_t::deliver_t deliver, pipeline_config_t config)
+    : m_config(config)
+    , m_carry_len(0)
+    , m_inflight(0)
+    , m_submits(0)
+    , m_sleepers(0)
+    , m_stop(false)
+{
+    if(m_config.workers == 0 || m_config.shards_per_worker == 0)
+        throw std::invalid_argument("messenger: pipeline_t: workers & shards_per_worker can not be 0");
+    if(m_config.queue_batches == 0)
+        throw std::invalid_argument("messenger: pipeline_t: queue_batches can not be 0");
+
+    size_t shard_num = m_config.workers * m_config.shards_per_worker;
+    m_shards.reserve(shard_num);
+    for(size_t i = 0; i < shard_num; ++i) {
+        m_shards.emplace_back(new detail::pipeline_shard_t(deliver, m_config));
+        m_shards.back()->pending.reserve(m_config.batch_bytes + detail::MAX_PACKET_SIZE);
+    }
+
+    m_workers.reserve(m_config.workers);
+    for(size_t i = 0; i < m_config.workers; ++i)
+        m_workers.emplace_back(&pipeline_t::worker_loop, this, i);
+}
+
+pipeline_t::~pipeline_t() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake_cv.notify_all();
+
+    for(std::thread &worker : m_workers)
+        worker.join();
+}
+
+void pipeline_t::feed(const uint8_t *beg, const uint8_t *end) {
+    // Append packet to batch of its sender's shard
+    auto route = [this](const uint8_t *packet, size_t size) {
+        const detail::hdr_info_t &info = detail::hdr_info(packet);
+        detail::name_key_t key(reinterpret_cast<const char *>(packet + detail::HEADER_SIZE), info.name_len());
+        detail::pipeline_shard_t &shard = *m_shards[key.hash() % m_shards.size()];
+
+        shard.pending.insert(shard.pending.end(), packet, packet + size);
+        if(shard.pending.size() >= m_config.batch_bytes)
+            submit(shard);
+    };
+
+    // Finish packet, which beginning came in previous chunks
+    while(m_carry_len != 0) {
+        size_t need = detail::HEADER_SIZE;
+        if(m_carry_len >= detail::HEADER_SIZE) {
+            detail::check_flag(m_carry);
+            need = detail::packet_size(m_carry);
+
+            if(m_carry_len == need) {
+                route(m_carry, need);
+                m_carry_len = 0;
+                break;
+            }
+        }
+
+        size_t take = std::min(need - m_carry_len, static_cast<size_t>(end - beg));
+        if(take == 0)
+            return;
+
+        std::memcpy(m_carry + m_carry_len, beg, take);
+        m_carry_len += take;
+        beg += take;
+    }
+
+    while(end - beg >= static_cast<std::ptrdiff_t>(detail::HEADER_SIZE)) {
+        detail::check_flag(beg);
+
+        size_t packet_size = detail::packet_size(beg);
+        if(static_cast<std::ptrdiff_t>(packet_size) > end - beg)
+            break;
+
+        route(beg, packet_size);
+        beg += packet_size;
+    }
+
+    // Keep beginning of packet, which is split across chunks
+    assertm(static_cast<size_t>(end - beg) < sizeof(m_carry), "pipeline_t: carry overflow");
+    std::memcpy(m_carry, beg, end - beg);
+    m_carry_len = end - beg;
+
+    // Chunk is not held back: partial batches are queued too
+    for(std::unique_ptr<detail::pipeline_shard_t> &shard : m_shards) {
+        if(!shard->pending.empty())
+            submit(*shard);
+    }
+}
+
+void pipeline_t::drain() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_drain_cv.wait(lock, [this] { return m_inflight.load(std::memory_order_acquire) == 0; });
+}
+
+void pipeline_t::flush() {
+    drain();
+
+    for(std::unique_ptr<detail::pipeline_shard_t> &shard : m_shards) {
+        detail::lock_shard(*shard);
+        shard->reasm.flush();
+        detail::unlock_shard(*shard);
+    }
+}
+
+pipeline_stats_t pipeline_t::stats() {
+    drain();
+
+    pipeline_stats_t res;
+    for(std::unique_ptr<detail::pipeline_shard_t> &shard : m_shards) {
+        detail::lock_shard(*shard);
+        reassembler_stats_t stats = shard->reasm.stats();
+        res.batches += shard->batches;
+        res.stolen += shard->stolen;
+        detail::unlock_shard(*shard);
+
+        res.reassembly.packets += stats.packets;
+        res.reassembly.msgs += stats.msgs;
+        res.reassembly.dropped += stats.dropped;
+        res.reassembly.evicted += stats.evicted;
+        res.reassembly.cut += stats.cut;
+        res.reassembly.undecodable += stats.undecodable;
+        res.reassembly.crc32c_failed += stats.crc32c_failed;
+        res.reassembly.senders += stats.senders;
+        res.reassembly.bytes += stats.bytes;
+    }
+
+    return res;
+}
+
+void pipeline_t::submit(detail::pipeline_shard_t &shard) {
+    // Counted before push, so worker never sees more processed than queued batches
+    m_inflight.fetch_add(1, std::memory_order_acq_rel);
+    while(!shard.queue.push(shard.pending))
+        std::this_thread::yield();
+
+    // Workers, which found nothing to do, sleep till number of submits changes
+    m_submits.fetch_add(1, std::memory_order_seq_cst);
+    if(m_sleepers.load(std::memory_order_seq_cst) != 0) {
+        // Empty critical section orders notification after workers' predicate check
+        { std::lock_guard<std::mutex> lock(m_mutex); }
+        m_wake_cv.notify_all();
+    }
+
+    // Reuse batch, which worker has emptied
+    if(!shard.spare.pop(shard.pending))
+        shard.pending.reserve(m_config.batch_bytes + detail::MAX_PACKET_SIZE);
+}
+
+void pipeline_t::worker_loop(size_t worker) {
+    size_t shard_num = m_shards.size();
+    std::chrono::steady_clock::duration idle_wait = std::min<std::chrono::steady_clock::duration>(
+        m_config.reassembler.idle_timeout, std::chrono::milliseconds(100));
+
+    for(;;) {
+        size_t submits = m_submits.load(std::memory_order_seq_cst);
+        bool worked = false;
+
+        for(size_t i = worker; i < shard_num; i += m_config.workers)
+            worked |= process_shard(*m_shards[i], false);
+
+        // Steal from other workers, starting next to own shards, so thieves spread
+        if(!worked && m_config.steal) {
+            for(size_t i = 1; i < shard_num; ++i) {
+                size_t idx = (worker + i) % shard_num;
+                if(idx % m_config.workers != worker)
+                    worked |= process_shard(*m_shards[idx], true);
+            }
+        }
+
+        if(worked)
+            continue;
+
+        expire_shards(worker);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if(m_stop && m_inflight.load(std::memory_order_acquire) == 0)
+            break;
+
+        m_sleepers.fetch_add(1, std::memory_order_seq_cst);
+        m_wake_cv.wait_for(lock, idle_wait, [&] {
+            return m_stop || m_submits.load(std::memory_order_seq_cst) != submits;
+        });
+        m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+bool pipeline_t::process_shard(detail::pipeline_shard_t &shard, bool stolen) {
+    if(shard.queue.empty() || shard.busy.exchange(true, std::memory_order_acquire))
+        return false;
+
+    std::vector<uint8_t> batch;
+    size_t processed = 0;
+    while(processed < BATCHES_PER_TURN && shard.queue.pop(batch)) {
+        shard.reasm.feed(batch.data(), batch.data() + batch.size());
+        processed++;
+
+        // Spare queue is never full in practice; batch is released otherwise
+        batch.clear();
+        shard.spare.push(batch);
+    }
+
+    shard.batches += processed;
+    if(stolen)
+        shard.stolen += processed;
+    detail::unlock_shard(shard);
+
+    if(processed != 0 && m_inflight.fetch_sub(processed, std::memory_order_acq_rel) == processed) {
+        { std::lock_guard<std::mutex> lock(m_mutex); }
+        m_drain_cv.notify_all();
+    }
+
+    return processed != 0;
+}
+
+void pipeline_t::expire_shards(size_t worker) {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    for(size_t i = worker; i < m_shards.size(); i += m_config.workers) {
+        detail::pipeline_shard_t &shard = *m_shards[i];
+        if(shard.busy.exchange(true, std::memory_order_acquire))
+            continue;
+
+        shard.reasm.expire(now);
+        detail::unlock_shard(shard);
+    }
+}
+
+} // namespace messenger
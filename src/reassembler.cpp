@@ -0,0 +1,277 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "reassembler.hpp"
+#include "compress.hpp"
+#include "msg_hdr.hpp"
+#include "trace.hpp"
+#include "util.hpp"
+
+namespace messenger {
+
+namespace detail {
+
+// Invalid flag bits break framing of stream, so they are not recoverable
+static void check_flag(const uint8_t *hdr) {
+    if(!hdr_info(hdr).flag_ok()) {
+        MESSENGER_TRACE_EVENT(flag_failure, NULL, 0, msg_hdr_view_t(hdr).get_flag());
+        throw std::runtime_error("messenger: reassembler_t: invalid flag bits");
+    }
+}
+
+// Whether framed packet can be accepted
+static bool is_packet_valid(const packet_view_t &packet) {
+    const hdr_info_t &info = hdr_info(packet.begin());
+
+    return info.valid()
+        && (!info.checksum() || info.msg_len() == CRC32C_LEN)
+        && util::crc4_range(info.crc4_state(), packet.begin() + HEADER_SIZE, packet.end()) == info.crc4();
+}
+
+} // namespace detail
+
+
+reassembler_t::reassembler_t(deliver_t deliver, reassembler_config_t config)
+    : m_deliver(std::move(deliver))
+    , m_config(config)
+    , m_lru_head(NIL)
+    , m_lru_tail(NIL)
+    , m_carry_len(0)
+{}
+
+void reassembler_t::feed(const uint8_t *beg, const uint8_t *end, clock_t::time_point now) {
+    // Finish packet, which beginning came in previous chunks
+    while(m_carry_len != 0) {
+        size_t need = detail::HEADER_SIZE;
+        if(m_carry_len >= detail::HEADER_SIZE) {
+            detail::check_flag(m_carry);
+            need = detail::packet_size(m_carry);
+
+            if(m_carry_len == need) {
+                process_packet(detail::packet_view_t(m_carry), now);
+                m_carry_len = 0;
+                break;
+            }
+        }
+
+        size_t take = std::min(need - m_carry_len, static_cast<size_t>(end - beg));
+        if(take == 0)
+            return;
+
+        std::memcpy(m_carry + m_carry_len, beg, take);
+        m_carry_len += take;
+        beg += take;
+    }
+
+    while(end - beg >= static_cast<std::ptrdiff_t>(detail::HEADER_SIZE)) {
+        detail::check_flag(beg);
+
+        size_t packet_size = detail::packet_size(beg);
+        if(static_cast<std::ptrdiff_t>(packet_size) > end - beg)
+            break;
+
+        process_packet(detail::packet_view_t(beg), now);
+        beg += packet_size;
+    }
+
+    // Keep beginning of packet, which is split across chunks
+    assertm(static_cast<size_t>(end - beg) < sizeof(m_carry), "reassembler_t: carry overflow");
+    std::memcpy(m_carry, beg, end - beg);
+    m_carry_len = end - beg;
+}
+
+size_t reassembler_t::expire(clock_t::time_point now) {
+    size_t expired = 0;
+
+    while(m_lru_head != NIL && now - m_entries[m_lru_head].last_seen >= m_config.idle_timeout) {
+        deliver_entry(m_lru_head, reassembly_reason_t::idle);
+        expired++;
+    }
+
+    return expired;
+}
+
+void reassembler_t::flush() {
+    while(m_lru_head != NIL)
+        deliver_entry(m_lru_head, reassembly_reason_t::flush);
+}
+
+void reassembler_t::flush(const std::string &name) {
+    if(name.size() > MSGR_NAME_LEN_MAX)
+        return;
+
+    uint32_t idx = m_index.find(detail::name_key_t(name.data(), name.size()));
+    if(idx != NIL)
+        deliver_entry(idx, reassembly_reason_t::flush);
+}
+
+reassembler_stats_t reassembler_t::stats() const {
+    return m_stats;
+}
+
+void reassembler_t::process_packet(const detail::packet_view_t &packet, clock_t::time_point now) {
+    if(!detail::is_packet_valid(packet)) {
+        MESSENGER_TRACE_EVENT(crc4_failure, packet.name(), packet.name_len(), packet.size());
+        m_stats.dropped++;
+
+        // Message of sender would miss part of text
+        if(packet.name_len() != 0) {
+            uint32_t idx = m_index.find(detail::name_key_t(packet.name(), packet.name_len()));
+            if(idx != NIL)
+                release_entry(idx);
+        }
+        return;
+    }
+
+    MESSENGER_TRACE_EVENT(decode_packet, packet.name(), packet.name_len(), packet.msg_len());
+
+    uint32_t idx = acquire_entry(packet);
+    entry_t &entry = m_entries[idx];
+
+    entry.last_seen = now;
+    lru_unlink(idx);
+    lru_push_back(idx);
+
+    m_stats.packets++;
+
+    // CRC32C packet carries no text
+    if(packet.checksum())
+        return;
+
+    entry.text.append(packet.msg(), packet.msg_len());
+    m_stats.bytes += packet.msg_len();
+
+    if(entry.checked) {
+        const uint8_t *field = reinterpret_cast<const uint8_t *>(packet.msg());
+        entry.crc32c = util::crc32c(entry.crc32c, field, field + packet.msg_len());
+    }
+
+    if(packet.msg_len() < MSGR_MSG_LEN_MAX) {
+        deliver_entry(idx, reassembly_reason_t::complete);
+        return;
+    }
+
+    // Evict least recently updated partial messages
+    while(m_stats.bytes > m_config.max_bytes && m_lru_head != NIL) {
+        m_stats.evicted++;
+        deliver_entry(m_lru_head, reassembly_reason_t::evict);
+    }
+}
+
+uint32_t reassembler_t::acquire_entry(const detail::packet_view_t &packet) {
+    detail::name_key_t key(packet.name(), packet.name_len());
+
+    uint32_t idx = m_index.find(key);
+    if(idx != NIL) {
+        entry_t &entry = m_entries[idx];
+
+        // First text packet after CRC32C packet sets compression of message
+        if(!packet.checksum() && entry.text.empty()) {
+            entry.compressed = packet.compressed();
+            return idx;
+        }
+
+        if(!packet.checksum() && entry.compressed == packet.compressed())
+            return idx;
+
+        // CRC32C packet, or switch between compressed and plain packets cuts previous message short
+        m_stats.cut++;
+        deliver_entry(idx, reassembly_reason_t::cut);
+    }
+
+    // Reuse entry (and capacity of its text) of finished message
+    if(!m_free.empty()) {
+        idx = m_free.back();
+        m_free.pop_back();
+    } else {
+        idx = static_cast<uint32_t>(m_entries.size());
+        m_entries.emplace_back();
+    }
+
+    entry_t &entry = m_entries[idx];
+    entry.key = key;
+    entry.compressed = packet.compressed();
+    entry.checked = packet.checksum();
+    entry.crc32c_expected = entry.checked ? packet.crc32c() : 0;
+    entry.crc32c = 0;
+    entry.prev = NIL;
+    entry.next = NIL;
+    lru_push_back(idx);
+
+    m_index.insert(key, idx);
+    m_stats.senders++;
+
+    return idx;
+}
+
+void reassembler_t::release_entry(uint32_t idx) {
+    entry_t &entry = m_entries[idx];
+
+    m_stats.bytes -= entry.text.size();
+    m_stats.senders--;
+
+    entry.text.clear();
+    if(entry.text.capacity() > m_config.max_kept_capacity)
+        std::string().swap(entry.text);
+
+    m_index.erase(entry.key);
+    lru_unlink(idx);
+    m_free.push_back(idx);
+}
+
+void reassembler_t::deliver_entry(uint32_t idx, reassembly_reason_t reason) {
+    const entry_t &entry = m_entries[idx];
+    std::string_view text(entry.text);
+
+    if(entry.checked && (entry.text.empty() || entry.crc32c != entry.crc32c_expected)) {
+        MESSENGER_TRACE_EVENT(crc32c_failure, entry.key.data(), entry.key.size(), entry.text.size());
+        m_stats.crc32c_failed++;
+        release_entry(idx);
+        return;
+    }
+
+    if(entry.compressed) {
+        try {
+            detail::open_envelope(entry.text.data(), entry.text.data() + entry.text.size(), m_inflated);
+            text = m_inflated;
+        } catch(const std::runtime_error &) {
+            m_stats.undecodable++;
+            release_entry(idx);
+            return;
+        }
+    }
+
+    m_deliver(std::string_view(entry.key.data(), entry.key.size()), text, reason);
+    MESSENGER_TRACE_EVENT(msg_complete, entry.key.data(), entry.key.size(), text.size());
+    m_stats.msgs++;
+
+    release_entry(idx);
+}
+
+void reassembler_t::lru_unlink(uint32_t idx) {
+    entry_t &entry = m_entries[idx];
+
+    if(entry.prev != NIL) m_entries[entry.prev].next = entry.next;
+    else m_lru_head = entry.next;
+
+    if(entry.next != NIL) m_entries[entry.next].prev = entry.prev;
+    else m_lru_tail = entry.prev;
+
+    entry.prev = NIL;
+    entry.next = NIL;
+}
+
+void reassembler_t::lru_push_back(uint32_t idx) {
+    entry_t &entry = m_entries[idx];
+
+    entry.prev = m_lru_tail;
+    entry.next = NIL;
+
+    if(m_lru_tail != NIL) m_entries[m_lru_tail].next = idx;
+    else m_lru_head = idx;
+
+    m_lru_tail = idx;
+}
+
+} // namespace messenger
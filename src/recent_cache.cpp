@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+
+#include "recent_cache.hpp"
+#include "packet.hpp"
+
+namespace messenger {
+
+namespace detail {
+
+/**
+ * Validate encoded message without decoding its text
+ *
+ * @return name of sender
+ *
+ * @note throws on same conditions as parse_buff (except corrupted compressed envelope)
+*/
+static name_key_t check_buff(const uint8_t *beg, const uint8_t *end) {
+    msg_state_t state;
+
+    for(const uint8_t *cur = beg; cur != end; ) {
+        packet_view_t packet = view_packet(cur, end);
+        accept_packet(packet, state);
+
+        cur = packet.end();
+    }
+
+    check_msg_state(state);
+
+    return name_key_t(state.name, state.name_len);
+}
+
+} // namespace detail
+
+
+recent_cache_t::recent_cache_t(recent_cache_config_t config)
+    : m_config(config)
+    , m_lru_head(NIL)
+    , m_lru_tail(NIL)
+    , m_hits(0)
+    , m_misses(0)
+{
+    if(m_config.per_sender == 0)
+        throw std::invalid_argument("messenger: recent_cache_t: per_sender has to be positive");
+}
+
+void recent_cache_t::insert(const msg_t &msg) {
+    // Encode outside of lock, scratch buffer keeps its capacity
+    thread_local std::vector<uint8_t> buff;
+    buff.clear();
+    append_buff(msg, buff, m_config.encoding);
+
+    detail::name_key_t key(msg.name.data(), msg.name.size());
+
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    store(key, buff.data(), buff.data() + buff.size());
+}
+
+void recent_cache_t::insert_buff(const uint8_t *beg, const uint8_t *end) {
+    detail::name_key_t key = detail::check_buff(beg, end);
+
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    store(key, beg, end);
+}
+
+size_t recent_cache_t::recent(const std::string &name, size_t n, std::vector<msg_t> &out) const {
+    if(name.size() > MSGR_NAME_LEN_MAX) {
+        m_misses.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+
+    uint32_t idx = m_index.find(detail::name_key_t(name.data(), name.size()));
+    if(idx == NIL) {
+        m_misses.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+    m_hits.fetch_add(1, std::memory_order_relaxed);
+
+    const sender_t &sender = m_senders[idx];
+    size_t num = std::min(n, sender.count);
+
+    for(size_t i = sender.count - num; i < sender.count; ++i) {
+        const std::vector<uint8_t> &slot = sender.slots[(sender.head + i) % sender.slots.size()];
+        out.push_back(parse_buff(slot.data(), slot.data() + slot.size()));
+    }
+
+    return num;
+}
+
+std::vector<msg_t> recent_cache_t::recent(const std::string &name, size_t n) const {
+    std::vector<msg_t> res;
+    recent(name, n, res);
+
+    return res;
+}
+
+void recent_cache_t::clear() {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+
+    while(m_lru_head != NIL)
+        release_sender(m_lru_head);
+}
+
+recent_cache_stats_t recent_cache_t::stats() const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+
+    recent_cache_stats_t res = m_stats;
+    res.hits = m_hits.load(std::memory_order_relaxed);
+    res.misses = m_misses.load(std::memory_order_relaxed);
+
+    return res;
+}
+
+void recent_cache_t::store(const detail::name_key_t &key, const uint8_t *beg, const uint8_t *end) {
+    uint32_t idx = acquire_sender(key);
+    sender_t &sender = m_senders[idx];
+
+    // Full ring: newest message takes slot of oldest one
+    if(sender.count == sender.slots.size())
+        drop_oldest(sender, false);
+
+    std::vector<uint8_t> &slot = sender.slots[(sender.head + sender.count) % sender.slots.size()];
+    slot.assign(beg, end);
+    // Slot of much longer message does not keep its excess outside of budget
+    if(slot.capacity() > 2 * slot.size())
+        std::vector<uint8_t>(slot).swap(slot);
+    sender.count++;
+    sender.bytes += slot.size();
+
+    m_stats.inserts++;
+    m_stats.msgs++;
+    m_stats.bytes += slot.size();
+
+    lru_unlink(idx);
+    lru_push_back(idx);
+
+    enforce_budget(idx);
+}
+
+uint32_t recent_cache_t::acquire_sender(const detail::name_key_t &key) {
+    uint32_t idx = m_index.find(key);
+    if(idx != NIL)
+        return idx;
+
+    if(!m_free.empty()) {
+        idx = m_free.back();
+        m_free.pop_back();
+    } else {
+        idx = static_cast<uint32_t>(m_senders.size());
+        m_senders.emplace_back();
+    }
+
+    sender_t &sender = m_senders[idx];
+    sender.key = key;
+    sender.slots.resize(m_config.per_sender);
+    sender.head = 0;
+    sender.count = 0;
+    sender.bytes = 0;
+    sender.prev = NIL;
+    sender.next = NIL;
+    lru_push_back(idx);
+
+    m_index.insert(key, idx);
+    m_stats.senders++;
+
+    return idx;
+}
+
+void recent_cache_t::release_sender(uint32_t idx) {
+    sender_t &sender = m_senders[idx];
+
+    m_stats.msgs -= sender.count;
+    m_stats.bytes -= sender.bytes;
+    m_stats.senders--;
+
+    // Memory of evicted sender is returned, so budget bounds actual footprint
+    std::vector<std::vector<uint8_t>>().swap(sender.slots);
+    sender.count = 0;
+    sender.bytes = 0;
+
+    m_index.erase(sender.key);
+    lru_unlink(idx);
+    m_free.push_back(idx);
+}
+
+void recent_cache_t::drop_oldest(sender_t &sender, bool release) {
+    std::vector<uint8_t> &slot = sender.slots[sender.head];
+
+    sender.bytes -= slot.size();
+    m_stats.bytes -= slot.size();
+    m_stats.msgs--;
+    // Memory of evicted message is returned, so budget bounds actual footprint
+    if(release)
+        std::vector<uint8_t>().swap(slot);
+    else
+        slot.clear();
+
+    sender.head = (sender.head + 1) % sender.slots.size();
+    sender.count--;
+}
+
+void recent_cache_t::enforce_budget(uint32_t keep) {
+    while(m_stats.bytes > m_config.max_bytes) {
+        if(m_lru_head != keep) {
+            m_stats.evicted_senders++;
+            m_stats.evicted_msgs += m_senders[m_lru_head].count;
+            release_sender(m_lru_head);
+            continue;
+        }
+
+        // Only just updated sender is left: keep at least its newest message
+        sender_t &sender = m_senders[keep];
+        if(sender.count <= 1)
+            break;
+
+        drop_oldest(sender, true);
+        m_stats.evicted_msgs++;
+    }
+}
+
+void recent_cache_t::lru_unlink(uint32_t idx) {
+    sender_t &sender = m_senders[idx];
+
+    if(sender.prev != NIL) m_senders[sender.prev].next = sender.next;
+    else m_lru_head = sender.next;
+
+    if(sender.next != NIL) m_senders[sender.next].prev = sender.prev;
+    else m_lru_tail = sender.prev;
+
+    sender.prev = NIL;
+    sender.next = NIL;
+}
+
+void recent_cache_t::lru_push_back(uint32_t idx) {
+    sender_t &sender = m_senders[idx];
+
+    sender.prev = m_lru_tail;
+    sender.next = NIL;
+
+    if(m_lru_tail != NIL) m_senders[m_lru_tail].next = idx;
+    else m_lru_head = idx;
+
+    m_lru_tail = idx;
+}
+
+} // namespace messenger
@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "relay.hpp"
+#include "msg_hdr.hpp"
+#include "packet.hpp"
+#include "util.hpp"
+
+namespace messenger {
+
+namespace detail {
+
+// Check only what is required to walk packets: flag bits & bounds
+static packet_view_t frame_packet(const uint8_t *beg, const uint8_t *end) {
+    if( (end - beg) < static_cast<std::ptrdiff_t>(HEADER_SIZE) )
+        throw std::runtime_error("messenger: relay_t: buffer does not contain enough bytes for packet");
+
+    if(!hdr_info(beg).flag_ok())
+        throw std::runtime_error("messenger: relay_t: invalid flag bits");
+
+    packet_view_t packet(beg);
+    if(static_cast<std::ptrdiff_t>(packet.size()) > end - beg)
+        throw std::runtime_error("messenger: relay_t: indicated name & msg size exceeds packet size");
+
+    return packet;
+}
+
+// crc4 of header (with nullified crc4 bits) followed by name
+static uint8_t crc4_prefix(const uint8_t *hdr, const char *name, size_t name_len) {
+    const uint8_t *name_beg = reinterpret_cast<const uint8_t *>(name);
+
+    return util::crc4_range(hdr_info(hdr).crc4_state(), name_beg, name_beg + name_len);
+}
+
+/**
+ * Write header & new name of packet, updating its CRC4 incrementally
+ *
+ * @param packet original packet
+ * @param name new name
+ * @param out beginning of rewritten packet (may be beginning of original packet)
+ *
+ * @note payload is not touched: it has to be already in place or copied afterwards.
+ *
+ * Packet's CRC4 = crc4_zeros(crc4(hdr + name), msg_len) ^ crc4(0, msg), as crc4 is linear.
+ * Hence CRC4 of rewritten packet is original CRC4 ^ crc4_zeros(old prefix ^ new prefix, msg_len)
+*/
+static void rewrite_prefix(const packet_view_t &packet, const std::string &name, uint8_t *out) {
+    // Read everything from original packet before it is overwritten
+    uint8_t msg_len = packet.msg_len();
+    uint8_t flag = msg_hdr_view_t(packet.begin()).get_flag();
+    uint8_t crc4_old = msg_hdr_view_t(packet.begin()).get_crc4();
+    uint8_t prefix_crc4_old = crc4_prefix(packet.begin(), packet.name(), packet.name_len());
+
+    msg_hdr_mod_t hdr_mod(out, name.size(), msg_len, 0, flag);
+    std::copy(name.begin(), name.end(), out + HEADER_SIZE);
+
+    uint8_t prefix_crc4_new = crc4_prefix(out, name.data(), name.size());
+    hdr_mod.set_crc4(crc4_old ^ util::crc4_zeros(prefix_crc4_old ^ prefix_crc4_new, msg_len));
+}
+
+} // namespace detail
+
+
+void relay_t::add_rename(const std::string &from, const std::string &to) {
+    for(const std::string *name : {&from, &to}) {
+        if(name->empty()) throw std::length_error("messenger: relay_t: name is empty");
+        if(name->size() > MSGR_NAME_LEN_MAX) throw std::length_error("messenger: relay_t: name is too long");
+    }
+
+    for(rename_t &rename : m_renames) {
+        if(rename.from == from) {
+            rename.to = to;
+            return;
+        }
+    }
+
+    m_renames.push_back(rename_t{from, to});
+}
+
+const relay_t::rename_t *relay_t::find_rename(const char *name, size_t name_len) const {
+    for(const rename_t &rename : m_renames) {
+        if(rename.from.size() == name_len && std::memcmp(rename.from.data(), name, name_len) == 0)
+            return &rename;
+    }
+
+    return NULL;
+}
+
+relay_stats_t relay_t::forward(const uint8_t *beg, const uint8_t *end, std::vector<uint8_t> &out) const {
+    relay_stats_t stats;
+    stats.bytes_in = end - beg;
+
+    size_t out_beg = out.size();
+    out.reserve(out_beg + stats.bytes_in);
+
+    for(const uint8_t *cur = beg; cur != end; stats.packets++) {
+        detail::packet_view_t packet = detail::frame_packet(cur, end);
+        const rename_t *rename = find_rename(packet.name(), packet.name_len());
+
+        if(rename == NULL) {
+            out.insert(out.end(), packet.begin(), packet.end());
+        } else {
+            size_t out_pos = out.size();
+            out.resize(out_pos + detail::HEADER_SIZE + rename->to.size() + packet.msg_len());
+
+            uint8_t *packet_out = out.data() + out_pos;
+            detail::rewrite_prefix(packet, rename->to, packet_out);
+            std::memcpy(packet_out + detail::HEADER_SIZE + rename->to.size(), packet.msg(), packet.msg_len());
+
+            stats.renamed++;
+            stats.crc_bytes_saved += packet.msg_len();
+        }
+
+        cur = packet.end();
+    }
+
+    stats.bytes_out = out.size() - out_beg;
+    return stats;
+}
+
+relay_stats_t relay_t::rewrite_in_place(uint8_t *beg, uint8_t *end) const {
+    relay_stats_t stats;
+    stats.bytes_in = end - beg;
+    stats.bytes_out = stats.bytes_in;
+
+    for(uint8_t *cur = beg; cur != end; stats.packets++) {
+        detail::packet_view_t packet = detail::frame_packet(cur, end);
+        const rename_t *rename = find_rename(packet.name(), packet.name_len());
+
+        if(rename != NULL) {
+            if(rename->to.size() != packet.name_len())
+                throw std::invalid_argument("messenger: relay_t: in place rename has to keep name length");
+
+            detail::rewrite_prefix(packet, rename->to, cur);
+
+            stats.renamed++;
+            stats.crc_bytes_saved += packet.msg_len();
+            stats.copy_bytes_saved += packet.msg_len();
+        }
+
+        cur += packet.size();
+    }
+
+    return stats;
+}
+
+} // namespace messenger
@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "sender_encoder.hpp"
+#include "packet.hpp"
+#include "trace.hpp"
+#include "util.hpp"
+
+namespace messenger {
+
+sender_encoder_t::sender_encoder_t(const std::string &name) {
+    if(name.empty()) throw std::length_error("messenger: sender_encoder_t: name is empty");
+    if(name.size() > MSGR_NAME_LEN_MAX) throw std::length_error("messenger: sender_encoder_t: name is too long");
+
+    m_name_len = static_cast<uint8_t>(name.size());
+    std::memcpy(m_name, name.data(), m_name_len);
+
+    // CRC4 transition over name segment
+    for(uint8_t c = 0; c <= MSGR_CRC4_MAX; ++c)
+        m_name_crc4[c] = util::crc4_range(c, m_name, m_name + m_name_len);
+
+    // Headers depend only on msg_len, CRC4 state entering name depends only on header
+    std::memset(m_hdr, 0, sizeof(m_hdr));
+    for(uint8_t msg_len = 0; msg_len <= MSGR_MSG_LEN_MAX; ++msg_len) {
+        detail::msg_hdr_mod_t hdr_mod(m_hdr[msg_len], m_name_len, msg_len, 0);
+        m_prefix_crc4[msg_len] = m_name_crc4[detail::hdr_info(m_hdr[msg_len]).crc4_state()];
+    }
+}
+
+std::string sender_encoder_t::name() const {
+    return std::string(reinterpret_cast<const char *>(m_name), m_name_len);
+}
+
+size_t sender_encoder_t::buff_size(size_t text_len) const {
+    size_t packet_num = (text_len + MSGR_MSG_LEN_MAX - 1) / MSGR_MSG_LEN_MAX;
+    return packet_num * (detail::HEADER_SIZE + m_name_len) + text_len;
+}
+
+uint8_t *sender_encoder_t::write(const char *text, size_t text_len, uint8_t *out) const {
+    if(text_len == 0) throw std::length_error("messenger: sender_encoder_t: text is empty");
+
+    const uint8_t *text_beg = reinterpret_cast<const uint8_t *>(text);
+    const uint8_t *text_end = text_beg + text_len;
+
+    while(text_beg != text_end) {
+        size_t msg_len = std::min<size_t>(text_end - text_beg, MSGR_MSG_LEN_MAX);
+        uint8_t *payload = out + detail::HEADER_SIZE + m_name_len;
+
+        out[0] = m_hdr[msg_len][0];
+        std::memcpy(out + detail::HEADER_SIZE, m_name, m_name_len);
+        std::memcpy(payload, text_beg, msg_len);
+
+        // Only payload is CRC'd, header & name are tabulated
+        uint8_t crc4 = util::crc4_range(m_prefix_crc4[msg_len], payload, payload + msg_len);
+        out[1] = m_hdr[msg_len][1] | (crc4 << (MSGR_MSG_LEN_BITS - 1));
+        MESSENGER_TRACE_EVENT(encode_packet, reinterpret_cast<const char *>(m_name), m_name_len, msg_len);
+
+        out = payload + msg_len;
+        text_beg += msg_len;
+    }
+
+    return out;
+}
+
+void sender_encoder_t::append(const std::string &text, std::vector<uint8_t> &out) const {
+    if(text.empty()) throw std::length_error("messenger: sender_encoder_t: text is empty");
+
+    size_t prev_size = out.size();
+    out.resize(prev_size + buff_size(text.size()));
+
+    write(text.data(), text.size(), out.data() + prev_size);
+}
+
+std::vector<uint8_t> sender_encoder_t::make_buff(const std::string &text) const {
+    std::vector<uint8_t> res;
+    append(text, res);
+
+    return res;
+}
+
+} // namespace messenger
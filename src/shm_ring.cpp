@@ -0,0 +1,359 @@
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "shm_ring.hpp"
+
+namespace messenger {
+
+namespace detail {
+
+const uint64_t SHM_RING_MAGIC = 0x474e49524753454dull;    // "MESGRING"
+
+/**
+ * Control block of ring, first page of memfd
+ *
+ * @details Positions are free running byte counters, offset in ring is position & (capacity - 1).
+ *          Every side writes own position only. *_seq are futex words, which are bumped on
+ *          wakeup, *_waiting tell peer, whether side is (about to be) asleep.
+*/
+struct shm_ring_header_t
+{
+    uint64_t magic;
+    uint64_t capacity;
+
+    alignas(64) std::atomic<uint64_t> head;         // written by producer
+    std::atomic<uint32_t> data_seq;                 // consumer sleeps on it
+    std::atomic<uint32_t> consumer_waiting;
+
+    alignas(64) std::atomic<uint64_t> tail;         // written by consumer
+    std::atomic<uint32_t> space_seq;                // producer sleeps on it
+    std::atomic<uint32_t> producer_waiting;
+
+    alignas(64) std::atomic<int32_t> producer_pid;  // 0 - not registered
+    std::atomic<int32_t> consumer_pid;
+    std::atomic<uint32_t> closed;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "messenger: shm_ring_t: 64-bit atomics have to be lock free");
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "messenger: shm_ring_t: futex word has to be 32-bit");
+
+static size_t page_size() {
+    return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+[[noreturn]] static void throw_errno(const char *what) {
+    throw std::system_error(errno, std::generic_category(), std::string("messenger: shm_ring_t: ") + what);
+}
+
+// Wait while word equals val, at most timeout. Spurious wakeups are fine for callers
+static void futex_wait(std::atomic<uint32_t> &word, uint32_t val, std::chrono::nanoseconds timeout) {
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(timeout.count() / 1000000000);
+    ts.tv_nsec = static_cast<long>(timeout.count() % 1000000000);
+
+    // Not FUTEX_PRIVATE: word is shared between processes
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT, val, &ts, NULL, 0);
+}
+
+static void futex_wake(std::atomic<uint32_t> &word) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+// Wake peer, if it is asleep (or about to sleep) on seq
+static void wake_peer(std::atomic<uint32_t> &waiting, std::atomic<uint32_t> &seq) {
+    if(waiting.load(std::memory_order_seq_cst) != 0 && waiting.exchange(0, std::memory_order_seq_cst) != 0) {
+        seq.fetch_add(1, std::memory_order_seq_cst);
+        futex_wake(seq);
+    }
+}
+
+// Process is gone: does not exist or is zombie (not reaped by parent yet)
+static bool is_process_gone(pid_t pid) {
+    if(kill(pid, 0) != 0)
+        return errno == ESRCH;
+
+    char path[32];
+    std::snprintf(path, sizeof(path), "/proc/%d/stat", static_cast<int>(pid));
+    FILE *file = std::fopen(path, "r");
+    if(file == NULL)
+        return false;
+
+    // "pid (comm) state ...", comm may contain ')'
+    char buff[512];
+    size_t len = std::fread(buff, 1, sizeof(buff) - 1, file);
+    std::fclose(file);
+    buff[len] = '\0';
+
+    const char *comm_end = std::strrchr(buff, ')');
+    return comm_end != NULL && comm_end[1] == ' ' && (comm_end[2] == 'Z' || comm_end[2] == 'X');
+}
+
+} // namespace detail
+
+
+const std::chrono::milliseconds shm_ring_t::POLL_INTERVAL(50);
+
+shm_ring_t shm_ring_t::create(size_t capacity) {
+    size_t page = detail::page_size();
+
+    size_t rounded = page;
+    while(rounded < capacity)
+        rounded <<= 1;
+
+    int fd = memfd_create("messenger_shm_ring", MFD_CLOEXEC);
+    if(fd < 0)
+        detail::throw_errno("memfd_create");
+
+    if(ftruncate(fd, static_cast<off_t>(page + rounded)) != 0) {
+        int err = errno;
+        ::close(fd);
+        errno = err;
+        detail::throw_errno("ftruncate");
+    }
+
+    try {
+        return shm_ring_t(fd, true, rounded);
+    } catch(...) {
+        ::close(fd);
+        throw;
+    }
+}
+
+shm_ring_t shm_ring_t::attach(int fd) {
+    int own_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if(own_fd < 0)
+        detail::throw_errno("dup");
+
+    try {
+        return shm_ring_t(own_fd, false, 0);
+    } catch(...) {
+        ::close(own_fd);
+        throw;
+    }
+}
+
+shm_ring_t::shm_ring_t(int fd, bool init, size_t capacity)
+    : m_fd(fd)
+    , m_capacity(capacity)
+    , m_hdr(NULL)
+    , m_data(NULL)
+{
+    size_t page = detail::page_size();
+    static_assert(sizeof(detail::shm_ring_header_t) <= 4096, "messenger: shm_ring_t: control block exceeds page");
+
+    void *hdr = mmap(NULL, page, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if(hdr == MAP_FAILED)
+        detail::throw_errno("mmap of control block");
+    m_hdr = static_cast<detail::shm_ring_header_t *>(hdr);
+
+    if(init) {
+        // Memory of fresh memfd is zeroed: positions, flags & pids start at 0
+        new (m_hdr) detail::shm_ring_header_t();
+        m_hdr->capacity = m_capacity;
+        m_hdr->magic = detail::SHM_RING_MAGIC;
+    } else {
+        struct stat st;
+        if(fstat(m_fd, &st) != 0) {
+            unmap();
+            detail::throw_errno("fstat");
+        }
+
+        m_capacity = m_hdr->capacity;
+        if(m_hdr->magic != detail::SHM_RING_MAGIC || m_capacity == 0 || (m_capacity & (m_capacity - 1)) != 0
+            || static_cast<size_t>(st.st_size) != page + m_capacity) {
+            unmap();
+            throw std::runtime_error("messenger: shm_ring_t: descriptor does not hold ring");
+        }
+    }
+
+    // Reserve twice capacity of address space, then map data pages into both halves
+    void *base = mmap(NULL, 2 * m_capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(base == MAP_FAILED) {
+        unmap();
+        detail::throw_errno("mmap of address space");
+    }
+    m_data = static_cast<uint8_t *>(base);
+
+    for(size_t half = 0; half < 2; ++half) {
+        void *res = mmap(m_data + half * m_capacity, m_capacity, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_FIXED, m_fd, static_cast<off_t>(page));
+        if(res == MAP_FAILED) {
+            unmap();
+            detail::throw_errno("mmap of data");
+        }
+    }
+}
+
+shm_ring_t::shm_ring_t(shm_ring_t &&other) noexcept
+    : m_fd(other.m_fd)
+    , m_capacity(other.m_capacity)
+    , m_hdr(other.m_hdr)
+    , m_data(other.m_data)
+{
+    other.m_fd = -1;
+    other.m_hdr = NULL;
+    other.m_data = NULL;
+}
+
+shm_ring_t &shm_ring_t::operator=(shm_ring_t &&other) noexcept {
+    if(this != &other) {
+        unmap();
+        if(m_fd >= 0)
+            ::close(m_fd);
+
+        m_fd = other.m_fd;
+        m_capacity = other.m_capacity;
+        m_hdr = other.m_hdr;
+        m_data = other.m_data;
+
+        other.m_fd = -1;
+        other.m_hdr = NULL;
+        other.m_data = NULL;
+    }
+
+    return *this;
+}
+
+shm_ring_t::~shm_ring_t() {
+    unmap();
+    if(m_fd >= 0)
+        ::close(m_fd);
+}
+
+void shm_ring_t::unmap() {
+    if(m_data != NULL)
+        munmap(m_data, 2 * m_capacity);
+    if(m_hdr != NULL)
+        munmap(m_hdr, detail::page_size());
+
+    m_data = NULL;
+    m_hdr = NULL;
+}
+
+void shm_ring_t::set_role(role_t role) {
+    std::atomic<int32_t> &pid = role == role_t::producer ? m_hdr->producer_pid : m_hdr->consumer_pid;
+    pid.store(static_cast<int32_t>(getpid()), std::memory_order_seq_cst);
+}
+
+void shm_ring_t::check_peer(role_t peer) const {
+    const std::atomic<int32_t> &pid = peer == role_t::producer ? m_hdr->producer_pid : m_hdr->consumer_pid;
+
+    pid_t peer_pid = pid.load(std::memory_order_acquire);
+    if(peer_pid != 0 && detail::is_process_gone(peer_pid))
+        throw std::runtime_error(peer == role_t::producer
+            ? "messenger: shm_ring_t: producer process is gone"
+            : "messenger: shm_ring_t: consumer process is gone");
+}
+
+uint8_t *shm_ring_t::reserve(size_t len, clock_t::duration timeout) {
+    if(len > m_capacity)
+        throw std::length_error("messenger: shm_ring_t: reserved span exceeds capacity");
+
+    uint64_t head = m_hdr->head.load(std::memory_order_relaxed);
+    clock_t::time_point beg = clock_t::now();
+
+    for(;;) {
+        if(m_capacity - (head - m_hdr->tail.load(std::memory_order_acquire)) >= len)
+            return m_data + (head & (m_capacity - 1));
+
+        check_peer(role_t::consumer);
+
+        clock_t::duration left = timeout - (clock_t::now() - beg);
+        if(left <= clock_t::duration::zero())
+            return NULL;
+
+        // Announce sleep, then re-check: either consumer sees announcement, or we see its release
+        uint32_t seq = m_hdr->space_seq.load(std::memory_order_seq_cst);
+        m_hdr->producer_waiting.store(1, std::memory_order_seq_cst);
+        if(m_capacity - (head - m_hdr->tail.load(std::memory_order_seq_cst)) < len)
+            detail::futex_wait(m_hdr->space_seq, seq, std::min<clock_t::duration>(left, POLL_INTERVAL));
+        m_hdr->producer_waiting.store(0, std::memory_order_relaxed);
+    }
+}
+
+void shm_ring_t::commit(size_t len) {
+    uint64_t head = m_hdr->head.load(std::memory_order_relaxed);
+    m_hdr->head.store(head + len, std::memory_order_seq_cst);
+
+    detail::wake_peer(m_hdr->consumer_waiting, m_hdr->data_seq);
+}
+
+bool shm_ring_t::write(const msg_t &msg, clock_t::duration timeout) {
+    size_t size = buff_size(msg);
+
+    uint8_t *out = reserve(size, timeout);
+    if(out == NULL)
+        return false;
+
+    // Span may cross end of ring: second mapping makes it contiguous
+    write_buff(msg, out);
+    commit(size);
+
+    return true;
+}
+
+void shm_ring_t::close() {
+    m_hdr->closed.store(1, std::memory_order_seq_cst);
+
+    m_hdr->data_seq.fetch_add(1, std::memory_order_seq_cst);
+    detail::futex_wake(m_hdr->data_seq);
+}
+
+bool shm_ring_t::closed() const {
+    return m_hdr->closed.load(std::memory_order_acquire) != 0;
+}
+
+const uint8_t *shm_ring_t::read(size_t &len, clock_t::duration timeout) {
+    uint64_t tail = m_hdr->tail.load(std::memory_order_relaxed);
+    clock_t::time_point beg = clock_t::now();
+
+    for(;;) {
+        uint64_t head = m_hdr->head.load(std::memory_order_acquire);
+        if(head != tail) {
+            len = static_cast<size_t>(head - tail);
+            return m_data + (tail & (m_capacity - 1));
+        }
+
+        len = 0;
+        // Closed flag is set after last commit: ring is drained
+        if(closed() && m_hdr->head.load(std::memory_order_acquire) == tail)
+            return NULL;
+
+        check_peer(role_t::producer);
+
+        clock_t::duration left = timeout - (clock_t::now() - beg);
+        if(left <= clock_t::duration::zero())
+            return NULL;
+
+        uint32_t seq = m_hdr->data_seq.load(std::memory_order_seq_cst);
+        m_hdr->consumer_waiting.store(1, std::memory_order_seq_cst);
+        if(m_hdr->head.load(std::memory_order_seq_cst) == tail && !closed())
+            detail::futex_wait(m_hdr->data_seq, seq, std::min<clock_t::duration>(left, POLL_INTERVAL));
+        m_hdr->consumer_waiting.store(0, std::memory_order_relaxed);
+    }
+}
+
+void shm_ring_t::release(size_t len) {
+    uint64_t tail = m_hdr->tail.load(std::memory_order_relaxed);
+    m_hdr->tail.store(tail + len, std::memory_order_seq_cst);
+
+    detail::wake_peer(m_hdr->producer_waiting, m_hdr->space_seq);
+}
+
+} // namespace messenger
@@ -0,0 +1,316 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "spill_queue.hpp"
+#include "packet.hpp"
+
+namespace messenger {
+
+namespace detail {
+
+const size_t SPILL_CHUNK_SIZE = 64 * 1024;      // size of memory chunk, unless bytes are longer
+const size_t SPILL_SPARE_CHUNKS = 8;            // drained chunks kept for reuse
+
+static size_t spill_page_size() {
+    return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+[[noreturn]] static void throw_spill_errno(const char *what) {
+    throw std::system_error(errno, std::generic_category(), std::string("messenger: spill_queue_t: ") + what);
+}
+
+// Unlinked temporary file in dir
+static int open_spill_file(std::string dir) {
+    if(dir.empty()) {
+        const char *tmp = std::getenv("TMPDIR");
+        dir = tmp != NULL && *tmp != '\0' ? tmp : "/tmp";
+    }
+
+    int fd = open(dir.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+    if(fd >= 0)
+        return fd;
+
+    // File system without O_TMPFILE
+    std::string path = dir + "/messenger_spill_XXXXXX";
+    fd = mkostemp(&path[0], O_CLOEXEC);
+    if(fd < 0)
+        throw_spill_errno("temporary file");
+    unlink(path.c_str());
+
+    return fd;
+}
+
+} // namespace detail
+
+
+spill_queue_t::spill_queue_t(spill_queue_config_t config)
+    : m_config(config)
+    , m_fd(-1)
+{
+    if(m_config.memory_limit == 0 || m_config.segment_size == 0)
+        throw std::invalid_argument("messenger: spill_queue_t: memory_limit & segment_size have to be positive");
+
+    size_t page = detail::spill_page_size();
+    m_config.segment_size = (m_config.segment_size + page - 1) / page * page;
+
+    m_fd = detail::open_spill_file(m_config.dir);
+}
+
+spill_queue_t::~spill_queue_t() {
+    unmap_window(m_wmap, m_wmap_len);
+    unmap_window(m_rmap, m_rmap_len);
+    ::close(m_fd);
+}
+
+bool spill_queue_t::push(const uint8_t *beg, const uint8_t *end) {
+    size_t len = end - beg;
+    if(len == 0)
+        return true;
+
+    bool disk;
+    uint8_t *out = reserve(len, disk);
+    if(out == NULL)
+        return false;
+
+    std::memcpy(out, beg, len);
+    commit(len, disk);
+
+    return true;
+}
+
+bool spill_queue_t::push(const msg_t &msg) {
+    detail::encoding_t enc = detail::plan_encoding(msg, m_config.encoding, m_env);
+
+    bool disk;
+    uint8_t *out = reserve(enc.size, disk);
+    if(out == NULL)
+        return false;
+
+    detail::write_encoding(msg, enc, out);
+    commit(enc.size, disk);
+
+    return true;
+}
+
+uint8_t *spill_queue_t::reserve(size_t len, bool &disk) {
+    uint64_t tail;
+    bool rewound = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Nothing goes into memory behind file part, until it is drained
+        disk = m_stats.disk_bytes != 0 || m_stats.memory_bytes + len > m_config.memory_limit;
+        if(!disk)
+            return reserve_memory(len);
+
+        if(m_stats.disk_bytes + len > m_config.disk_limit) {
+            m_stats.rejected++;
+            return NULL;
+        }
+
+        // Drained file, which blocks were given back, is written from beginning
+        if(m_stats.disk_bytes == 0 && !m_punching && m_disk_tail != 0) {
+            m_disk_head = m_disk_tail = m_punched = 0;
+            rewound = true;
+        }
+        tail = m_disk_tail;
+    }
+
+    // Window over punched blocks has to allocate them again
+    if(rewound)
+        unmap_window(m_wmap, m_wmap_len);
+
+    return reserve_disk(tail, len);
+}
+
+void spill_queue_t::commit(size_t len, bool disk) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if(disk) {
+        m_disk_tail += len;
+        m_stats.disk_bytes += len;
+        m_stats.spilled_bytes += len;
+    } else {
+        m_chunks.back().end += len;
+        m_stats.memory_bytes += len;
+    }
+
+    m_stats.pushed_bytes += len;
+}
+
+uint8_t *spill_queue_t::reserve_memory(size_t len) {
+    if(!m_chunks.empty()) {
+        chunk_t &back = m_chunks.back();
+        // Drained last chunk restarts
+        if(back.beg == back.end)
+            back.beg = back.end = 0;
+        if(back.data.size() - back.end >= len)
+            return back.data.data() + back.end;
+    }
+
+    chunk_t chunk;
+    if(!m_spare.empty()) {
+        chunk = std::move(m_spare.back());
+        m_spare.pop_back();
+    }
+    if(chunk.data.size() < len)
+        chunk.data.resize(std::max(detail::SPILL_CHUNK_SIZE, len));
+    chunk.beg = chunk.end = 0;
+
+    // Drained last chunk (too short for len) is replaced
+    if(!m_chunks.empty() && m_chunks.back().beg == m_chunks.back().end) {
+        if(m_spare.size() < detail::SPILL_SPARE_CHUNKS)
+            m_spare.push_back(std::move(m_chunks.back()));
+        m_chunks.pop_back();
+    }
+
+    m_chunks.push_back(std::move(chunk));
+
+    return m_chunks.back().data.data();
+}
+
+uint8_t *spill_queue_t::reserve_disk(uint64_t tail, size_t len) {
+    if(m_wmap != NULL && tail >= m_wmap_off && tail + len <= m_wmap_off + m_wmap_len)
+        return m_wmap + (tail - m_wmap_off);
+
+    size_t page = detail::spill_page_size();
+    uint64_t off = tail / page * page;
+    size_t map_len = (tail - off + std::max(len, m_config.segment_size) + page - 1) / page * page;
+
+    // Blocks are allocated upfront (also those punched out before): full disk is error here,
+    // not SIGBUS on write into window
+    int err = posix_fallocate(m_fd, static_cast<off_t>(off), static_cast<off_t>(map_len));
+    if(err != 0) {
+        errno = err;
+        detail::throw_spill_errno("fallocate");
+    }
+
+    uint8_t *map = map_window(off, map_len, m_wmap, m_wmap_off, m_wmap_len);
+
+    return map + (tail - off);
+}
+
+uint8_t *spill_queue_t::map_window(uint64_t offset, size_t len, uint8_t *&map, uint64_t &map_off, size_t &map_len) {
+    unmap_window(map, map_len);
+
+    void *res = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, static_cast<off_t>(offset));
+    if(res == MAP_FAILED)
+        detail::throw_spill_errno("mmap");
+
+    map = static_cast<uint8_t *>(res);
+    map_off = offset;
+    map_len = len;
+
+    return map;
+}
+
+void spill_queue_t::unmap_window(uint8_t *&map, size_t &map_len) {
+    if(map != NULL)
+        munmap(map, map_len);
+    map = NULL;
+    map_len = 0;
+}
+
+const uint8_t *spill_queue_t::read(size_t &len) {
+    uint64_t head, tail;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Drained chunks are never left in front of others
+        if(m_stats.memory_bytes != 0) {
+            const chunk_t &front = m_chunks.front();
+            len = front.end - front.beg;
+            return front.data.data() + front.beg;
+        }
+
+        if(m_stats.disk_bytes == 0) {
+            len = 0;
+            return NULL;
+        }
+
+        head = m_disk_head;
+        tail = m_disk_tail;
+    }
+
+    if(m_rmap == NULL || head < m_rmap_off || head >= m_rmap_off + m_rmap_len) {
+        uint64_t off = head / m_config.segment_size * m_config.segment_size;
+        map_window(off, m_config.segment_size, m_rmap, m_rmap_off, m_rmap_len);
+    }
+
+    len = std::min(m_rmap_off + m_rmap_len, tail) - head;
+    return m_rmap + (head - m_rmap_off);
+}
+
+void spill_queue_t::release(size_t len) {
+    if(len == 0)
+        return;
+
+    uint64_t punch_beg;
+    uint64_t punch_end;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if(m_stats.memory_bytes != 0) {
+            chunk_t &front = m_chunks.front();
+            if(len > front.end - front.beg)
+                throw std::out_of_range("messenger: spill_queue_t: release exceeds readable bytes");
+
+            front.beg += len;
+            m_stats.memory_bytes -= len;
+
+            if(front.beg == front.end && m_chunks.size() > 1) {
+                if(m_spare.size() < detail::SPILL_SPARE_CHUNKS)
+                    m_spare.push_back(std::move(front));
+                m_chunks.pop_front();
+            }
+            return;
+        }
+
+        if(len > m_stats.disk_bytes || m_rmap == NULL || m_disk_head < m_rmap_off
+           || m_disk_head + len > m_rmap_off + m_rmap_len)
+            throw std::out_of_range("messenger: spill_queue_t: release exceeds readable bytes");
+
+        m_disk_head += len;
+        m_stats.disk_bytes -= len;
+        m_stats.replayed_bytes += len;
+
+        // Replayed segments are given back, whole file, once it is drained
+        uint64_t replayed = m_stats.disk_bytes == 0 ? m_disk_head : m_disk_head / m_config.segment_size * m_config.segment_size;
+        if(replayed <= m_punched)
+            return;
+
+        punch_beg = m_punched;
+        punch_end = replayed;
+        m_punched = replayed;
+        m_punching = true;
+    }
+
+    // Best effort, file system may not support it
+    fallocate(m_fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+              static_cast<off_t>(punch_beg), static_cast<off_t>(punch_end - punch_beg));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_punching = false;
+}
+
+size_t spill_queue_t::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    return m_stats.memory_bytes + m_stats.disk_bytes;
+}
+
+spill_queue_stats_t spill_queue_t::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    return m_stats;
+}
+
+} // namespace messenger
@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+
+#include "text_index.hpp"
+
+namespace messenger {
+
+namespace detail {
+
+const size_t GRAM_LEN = 3;
+
+// Trigram at pos as 24-bit key
+static inline uint32_t gram_at(const char *pos) {
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(pos);
+    return static_cast<uint32_t>(bytes[0]) << 16 | static_cast<uint32_t>(bytes[1]) << 8 | bytes[2];
+}
+
+// Distinct trigrams of text, sorted
+static void collect_grams(std::string_view text, std::vector<uint32_t> &grams) {
+    grams.clear();
+    for(size_t i = 0; i + GRAM_LEN <= text.size(); ++i)
+        grams.push_back(gram_at(text.data() + i));
+
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+}
+
+// LEB128: 7 bits per byte, high bit marks continuation
+static size_t put_varint(uint32_t val, std::vector<uint8_t> &out) {
+    size_t len = 1;
+    while(val >= 0x80) {
+        out.push_back(static_cast<uint8_t>(val | 0x80));
+        val >>= 7;
+        len++;
+    }
+    out.push_back(static_cast<uint8_t>(val));
+
+    return len;
+}
+
+static inline uint32_t get_varint(const uint8_t *&pos) {
+    uint32_t val = 0;
+    for(unsigned shift = 0; ; shift += 7) {
+        uint8_t byte = *pos++;
+        val |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if(byte < 0x80)
+            return val;
+    }
+}
+
+} // namespace detail
+
+
+text_index_t::text_index_t(text_index_config_t config)
+    : m_config(config)
+{
+    m_store.offsets.push_back(0);
+}
+
+uint32_t text_index_t::insert(const msg_t &msg) {
+    // Encode outside of lock, scratch buffer keeps its capacity
+    thread_local std::vector<uint8_t> buff;
+    buff.clear();
+    append_buff(msg, buff, m_config.encoding);
+
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    uint32_t id = store(buff.data(), buff.data() + buff.size());
+    index_text(id, msg.text);
+
+    return id;
+}
+
+uint32_t text_index_t::insert_buff(const uint8_t *beg, const uint8_t *end) {
+    // Validate & decode outside of lock
+    thread_local msg_t msg;
+    parse_buff(beg, end, msg);
+
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    uint32_t id = store(beg, end);
+    index_text(id, msg.text);
+
+    return id;
+}
+
+std::vector<uint32_t> text_index_t::find(std::string_view pattern, size_t limit) const {
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> res;
+
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+
+    if(pattern.size() < detail::GRAM_LEN) {
+        candidates.resize(m_store.size());
+        for(size_t id = 0; id < candidates.size(); ++id)
+            candidates[id] = static_cast<uint32_t>(id);
+    } else {
+        std::vector<uint32_t> grams;
+        detail::collect_grams(pattern, grams);
+
+        // Rarest postings first: candidates only shrink
+        std::vector<const posting_t *> postings;
+        for(uint32_t gram : grams) {
+            auto it = m_postings.find(gram);
+            if(it == m_postings.end())
+                return res;
+            postings.push_back(&it->second);
+        }
+        std::sort(postings.begin(), postings.end(), [](const posting_t *a, const posting_t *b) {
+            return a->count < b->count;
+        });
+
+        const uint8_t *pos = postings[0]->ids.data();
+        candidates.resize(postings[0]->count);
+        for(uint32_t i = 0, id = 0; i < postings[0]->count; ++i) {
+            id = i == 0 ? detail::get_varint(pos) : id + detail::get_varint(pos);
+            candidates[i] = id;
+        }
+
+        for(size_t p = 1; p < postings.size() && !candidates.empty(); ++p) {
+            const posting_t &posting = *postings[p];
+            pos = posting.ids.data();
+            uint32_t left = posting.count;
+            uint32_t id = 0;
+            bool started = false;
+            size_t kept = 0;
+
+            // Merge ascending candidates with ascending posting
+            for(uint32_t candidate : candidates) {
+                while((!started || id < candidate) && left != 0) {
+                    id = started ? id + detail::get_varint(pos) : detail::get_varint(pos);
+                    started = true;
+                    left--;
+                }
+
+                if(started && id == candidate)
+                    candidates[kept++] = candidate;
+                else if(left == 0 && (!started || id < candidate))
+                    break;
+            }
+            candidates.resize(kept);
+        }
+    }
+
+    // Trigrams may come from different places of text: verify against stored packets
+    msg_t msg;
+    for(uint32_t id : candidates) {
+        if(res.size() >= limit)
+            break;
+
+        parse_buff(m_store.msg_begin(id), m_store.msg_end(id), msg);
+        if(msg.text.find(pattern) != std::string::npos)
+            res.push_back(id);
+    }
+
+    return res;
+}
+
+msg_t text_index_t::msg(uint32_t id) const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+
+    if(id >= m_store.size())
+        throw std::out_of_range("messenger: text_index_t: unknown id");
+
+    return parse_buff(m_store.msg_begin(id), m_store.msg_end(id));
+}
+
+size_t text_index_t::size() const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return m_store.size();
+}
+
+text_index_stats_t text_index_t::stats() const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+
+    text_index_stats_t res = m_stats;
+    res.trigrams = m_postings.size();
+    return res;
+}
+
+void text_index_t::index_text(uint32_t id, std::string_view text) {
+    detail::collect_grams(text, m_grams);
+
+    for(uint32_t gram : m_grams) {
+        posting_t &posting = m_postings[gram];
+        m_stats.posting_bytes += detail::put_varint(posting.count == 0 ? id : id - posting.last, posting.ids);
+        posting.last = id;
+        posting.count++;
+    }
+
+    m_stats.msgs++;
+    m_stats.text_bytes += text.size();
+}
+
+uint32_t text_index_t::store(const uint8_t *beg, const uint8_t *end) {
+    if(m_store.size() >= UINT32_MAX)
+        throw std::length_error("messenger: text_index_t: too many messages");
+
+    m_store.buff.insert(m_store.buff.end(), beg, end);
+    m_store.offsets.push_back(m_store.buff.size());
+    m_stats.stored_bytes += end - beg;
+
+    return static_cast<uint32_t>(m_store.size() - 1);
+}
+
+} // namespace messenger
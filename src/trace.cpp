@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "trace.hpp"
+
+namespace messenger::trace {
+
+std::atomic<recorder_t *> g_recorder(NULL);
+
+const char *event_name(event_t event) {
+    switch(event) {
+        case event_t::encode_packet: return "encode_packet";
+        case event_t::decode_packet: return "decode_packet";
+        case event_t::crc4_failure: return "crc4_failure";
+        case event_t::crc32c_failure: return "crc32c_failure";
+        case event_t::flag_failure: return "flag_failure";
+        case event_t::msg_complete: return "msg_complete";
+    }
+
+    return "unknown";
+}
+
+recorder_t::recorder_t(size_t capacity)
+    : m_next(0)
+{
+    size_t slot_num = 1;
+    while(slot_num < capacity)
+        slot_num <<= 1;
+
+    m_slots.reset(new slot_t[slot_num]);
+    m_mask = slot_num - 1;
+
+    for(size_t i = 0; i < slot_num; ++i)
+        m_slots[i].seq.store(0, std::memory_order_relaxed);
+}
+
+void recorder_t::record(event_t event, const char *name, size_t name_len, size_t size) noexcept {
+    uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    name_len = std::min<size_t>(name_len, MSGR_NAME_LEN_MAX);
+    uint64_t name_words[2] = {0, 0};
+    if(name != NULL)
+        std::memcpy(name_words, name, name_len);
+
+    uint64_t meta = static_cast<uint64_t>(event) | static_cast<uint64_t>(name_len) << 8
+        | static_cast<uint64_t>(std::min<size_t>(size, UINT32_MAX)) << 32;
+
+    uint64_t idx = m_next.fetch_add(1, std::memory_order_relaxed);
+    slot_t &slot = m_slots[idx & m_mask];
+
+    slot.seq.store(2 * idx + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.words[0].store(ns, std::memory_order_relaxed);
+    slot.words[1].store(meta, std::memory_order_relaxed);
+    slot.words[2].store(name_words[0], std::memory_order_relaxed);
+    slot.words[3].store(name_words[1], std::memory_order_relaxed);
+
+    slot.seq.store(2 * idx + 2, std::memory_order_release);
+}
+
+std::vector<record_t> recorder_t::snapshot() const {
+    uint64_t next = m_next.load(std::memory_order_acquire);
+    uint64_t first = next > capacity() ? next - capacity() : 0;
+
+    std::vector<record_t> res;
+    res.reserve(next - first);
+
+    for(uint64_t idx = first; idx < next; ++idx) {
+        const slot_t &slot = m_slots[idx & m_mask];
+
+        // Skip slot, which is still written or is already overwritten
+        uint64_t seq = slot.seq.load(std::memory_order_acquire);
+        if(seq != 2 * idx + 2)
+            continue;
+
+        uint64_t words[4];
+        for(size_t i = 0; i < 4; ++i)
+            words[i] = slot.words[i].load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(slot.seq.load(std::memory_order_relaxed) != seq)
+            continue;
+
+        record_t rec;
+        rec.seq = idx;
+        rec.ns = words[0];
+        rec.event = static_cast<event_t>(words[1] & 0xff);
+        rec.name_len = static_cast<uint8_t>(words[1] >> 8);
+        rec.size = static_cast<uint32_t>(words[1] >> 32);
+        std::memcpy(rec.name_buf, words + 2, sizeof(rec.name_buf));
+        res.push_back(rec);
+    }
+
+    return res;
+}
+
+void recorder_t::dump(std::ostream &out) const {
+    for(const record_t &rec : snapshot())
+        out << rec.seq << ' ' << rec.ns << ' ' << event_name(rec.event) << ' '
+            << (rec.name_len != 0 ? rec.name() : std::string_view("-")) << ' ' << rec.size << '\n';
+}
+
+void attach(recorder_t *recorder) {
+    g_recorder.store(recorder, std::memory_order_release);
+}
+
+} // namespace messenger::trace
@@ -0,0 +1,281 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "udp.hpp"
+#include "packet.hpp"
+
+namespace messenger {
+
+namespace detail {
+
+[[noreturn]] static void throw_udp_errno(const char *what) {
+    throw std::system_error(errno, std::generic_category(), std::string("messenger: udp: ") + what);
+}
+
+static sockaddr_in make_addr(const std::string &ip, uint16_t port) {
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if(inet_pton(AF_INET, ip.c_str(), &addr.sin_addr) != 1)
+        throw std::invalid_argument("messenger: udp: malformed IPv4 address");
+
+    return addr;
+}
+
+// One header per batch slot of datagram_size bytes
+static void init_hdrs(std::vector<uint8_t> &buff, std::vector<::mmsghdr> &hdrs, std::vector<::iovec> &iovs,
+                      const udp_config_t &config) {
+    if(config.batch == 0)
+        throw std::invalid_argument("messenger: udp: batch has to be positive");
+
+    buff.resize(config.batch * config.datagram_size);
+    hdrs.resize(config.batch);
+    iovs.resize(config.batch);
+
+    for(size_t i = 0; i < config.batch; ++i) {
+        iovs[i].iov_base = buff.data() + i * config.datagram_size;
+        iovs[i].iov_len = config.datagram_size;
+
+        std::memset(&hdrs[i], 0, sizeof(hdrs[i]));
+        hdrs[i].msg_hdr.msg_iov = &iovs[i];
+        hdrs[i].msg_hdr.msg_iovlen = 1;
+    }
+}
+
+} // namespace detail
+
+
+udp_socket_t udp_socket_t::bind(const std::string &ip, uint16_t port) {
+    sockaddr_in addr = detail::make_addr(ip, port);
+
+    int fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if(fd < 0)
+        detail::throw_udp_errno("socket");
+    udp_socket_t res(fd);
+
+    if(::bind(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) != 0)
+        detail::throw_udp_errno("bind");
+
+    return res;
+}
+
+udp_socket_t udp_socket_t::connect(const std::string &ip, uint16_t port) {
+    sockaddr_in addr = detail::make_addr(ip, port);
+
+    int fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if(fd < 0)
+        detail::throw_udp_errno("socket");
+    udp_socket_t res(fd);
+
+    if(::connect(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) != 0)
+        detail::throw_udp_errno("connect");
+
+    return res;
+}
+
+udp_socket_t::udp_socket_t(udp_socket_t &&other) noexcept
+    : m_fd(other.m_fd)
+{
+    other.m_fd = -1;
+}
+
+udp_socket_t &udp_socket_t::operator=(udp_socket_t &&other) noexcept {
+    if(this != &other) {
+        if(m_fd >= 0)
+            ::close(m_fd);
+        m_fd = other.m_fd;
+        other.m_fd = -1;
+    }
+
+    return *this;
+}
+
+udp_socket_t::~udp_socket_t() {
+    if(m_fd >= 0)
+        ::close(m_fd);
+}
+
+uint16_t udp_socket_t::port() const {
+    sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    if(::getsockname(m_fd, reinterpret_cast<sockaddr *>(&addr), &len) != 0)
+        detail::throw_udp_errno("getsockname");
+
+    return ntohs(addr.sin_port);
+}
+
+void udp_socket_t::set_recv_buffer(size_t bytes) {
+    int val = static_cast<int>(std::min<size_t>(bytes, INT32_MAX));
+    if(::setsockopt(m_fd, SOL_SOCKET, SO_RCVBUF, &val, sizeof(val)) != 0)
+        detail::throw_udp_errno("setsockopt");
+}
+
+
+udp_sender_t::udp_sender_t(int fd, udp_config_t config)
+    : m_fd(fd)
+    , m_config(config)
+{
+    if(m_config.datagram_size < detail::MAX_PACKET_SIZE)
+        throw std::invalid_argument("messenger: udp_sender_t: datagram can not hold packet");
+
+    detail::init_hdrs(m_buff, m_hdrs, m_iovs, m_config);
+    m_lens.reserve(m_config.batch);
+}
+
+udp_sender_t::~udp_sender_t() {
+    try {
+        flush();
+    } catch(const std::system_error &) {
+        // Queued datagrams are lost, destructor does not throw
+    }
+}
+
+void udp_sender_t::send(const msg_t &msg) {
+    detail::encoding_t enc = detail::plan_encoding(msg, m_config.encoding, m_env);
+    if(enc.size > m_config.datagram_size)
+        throw std::length_error("messenger: udp_sender_t: message exceeds datagram");
+
+    if(m_fill + enc.size > m_config.datagram_size)
+        close_datagram();
+
+    uint8_t *slot = m_buff.data() + m_lens.size() * m_config.datagram_size;
+    detail::write_encoding(msg, enc, slot + m_fill);
+    m_fill += enc.size;
+    m_stats.msgs++;
+
+    // Last packet is full, so only end of datagram ends message
+    if(enc.payload->size() % MSGR_MSG_LEN_MAX == 0)
+        close_datagram();
+}
+
+void udp_sender_t::flush() {
+    close_datagram();
+    if(m_lens.empty())
+        return;
+
+    for(size_t i = 0; i < m_lens.size(); ++i)
+        m_iovs[i].iov_len = m_lens[i];
+
+    size_t sent = 0;
+    while(sent < m_lens.size()) {
+        int res = ::sendmmsg(m_fd, m_hdrs.data() + sent, m_lens.size() - sent, 0);
+        m_stats.syscalls++;
+        if(res < 0) {
+            if(errno == EINTR)
+                continue;
+            m_lens.clear();
+            detail::throw_udp_errno("sendmmsg");
+        }
+
+        for(int i = 0; i < res; ++i)
+            m_stats.bytes += m_lens[sent + i];
+        m_stats.datagrams += res;
+        sent += res;
+    }
+
+    m_lens.clear();
+}
+
+void udp_sender_t::close_datagram() {
+    if(m_fill == 0)
+        return;
+
+    m_lens.push_back(m_fill);
+    m_fill = 0;
+
+    if(m_lens.size() == m_config.batch)
+        flush();
+}
+
+
+udp_receiver_t::udp_receiver_t(int fd, deliver_t deliver, udp_config_t config)
+    : m_fd(fd)
+    , m_deliver(std::move(deliver))
+    , m_config(config)
+{
+    detail::init_hdrs(m_buff, m_hdrs, m_iovs, m_config);
+}
+
+udp_receiver_t::~udp_receiver_t() = default;
+
+size_t udp_receiver_t::receive(std::chrono::milliseconds timeout) {
+    int res;
+    for(;;) {
+        res = ::recvmmsg(m_fd, m_hdrs.data(), m_hdrs.size(), MSG_DONTWAIT, NULL);
+        m_stats.syscalls++;
+        if(res >= 0)
+            break;
+        if(errno == EINTR)
+            continue;
+        if(errno != EAGAIN && errno != EWOULDBLOCK)
+            detail::throw_udp_errno("recvmmsg");
+        if(timeout.count() <= 0)
+            return 0;
+
+        // Nothing is queued: wait for first datagram once
+        pollfd pfd = {m_fd, POLLIN, 0};
+        int ready = ::poll(&pfd, 1, static_cast<int>(timeout.count()));
+        m_stats.syscalls++;
+        if(ready < 0 && errno != EINTR)
+            detail::throw_udp_errno("poll");
+        if(ready == 0)
+            return 0;
+        timeout = std::chrono::milliseconds(0);
+    }
+
+    for(int i = 0; i < res; ++i) {
+        const ::mmsghdr &hdr = m_hdrs[i];
+        m_stats.datagrams++;
+        m_stats.bytes += hdr.msg_len;
+
+        if(hdr.msg_hdr.msg_flags & MSG_TRUNC) {
+            m_stats.dropped++;
+            continue;
+        }
+
+        const uint8_t *beg = static_cast<const uint8_t *>(m_iovs[i].iov_base);
+        decode(beg, beg + hdr.msg_len);
+    }
+
+    return res;
+}
+
+void udp_receiver_t::decode(const uint8_t *beg, const uint8_t *end) {
+    detail::msg_state_t state;
+    const uint8_t *cur = beg;
+
+    while(cur != end) {
+        bool last;
+        try {
+            detail::packet_view_t packet = detail::view_packet(cur, end);
+            detail::append_packet(packet, m_msg, state);
+            cur = packet.end();
+
+            // Text packet, which is not full, ends message; end of datagram ends any message
+            last = (!packet.checksum() && packet.msg_len() < MSGR_MSG_LEN_MAX) || cur == end;
+            if(last)
+                detail::finish_msg(m_msg, state);
+        } catch(const std::exception &) {
+            // Framing of rest of datagram is unknown
+            m_stats.dropped++;
+            return;
+        }
+
+        if(last) {
+            m_stats.msgs++;
+            m_deliver(m_msg.name, m_msg.text);
+            state = detail::msg_state_t();
+        }
+    }
+}
+
+} // namespace messenger
@@ -5,11 +5,6 @@
 
 namespace messenger::util {
 
-static const uint8_t crc4_tab[] = {
-    0x0, 0x7, 0xe, 0x9, 0xb, 0xc, 0x5, 0x2,
-    0x1, 0x6, 0xf, 0x8, 0xa, 0xd, 0x4, 0x3,
-};
-
 uint8_t crc4(uint8_t c, uint64_t x, size_t bits)
 {
     int i;
@@ -19,23 +14,60 @@ uint8_t crc4(uint8_t c, uint64_t x, size_t bits)
     bits = (bits + 3) & ~0x3;
     /* Calculate crc4 over four-bit nibbles, starting at the MSbit */
     for (i = bits - 4; i >= 0; i -= 4)
-        c = crc4_tab[c ^ ((x >> i) & 0xf)];
+        c = CRC4_NIBBLE_TAB[c ^ ((x >> i) & 0xf)];
     return c;
 }
 
+// crc4 of whole byte for every starting crc4: one lookup per byte instead of nibble loop
+struct crc4_byte_tab_t {
+    uint8_t tab[16][256];
+
+    constexpr crc4_byte_tab_t(): tab() {
+        for(size_t c = 0; c < 16; ++c)
+            for(size_t byte = 0; byte < 256; ++byte)
+                tab[c][byte] = CRC4_NIBBLE_TAB[CRC4_NIBBLE_TAB[c ^ (byte >> 4)] ^ (byte & 0xf)];
+    }
+};
+
+static constexpr crc4_byte_tab_t crc4_byte_tab;
+
 uint8_t crc4_range(uint8_t c, const uint8_t *beg, const uint8_t *end) {
     for(; beg != end; ++beg)
-        c = crc4(c, *beg, BITS_PER_BYTE);
+        c = crc4_byte_tab.tab[c][*beg];
     
     return c;
 }
 
+// crc4 states after running over [0, CRC4_ZEROS_TAB_LEN) zero bytes
+static const size_t CRC4_ZEROS_TAB_LEN = 64;
+
+struct crc4_zeros_tab_t {
+    uint8_t tab[CRC4_ZEROS_TAB_LEN][16];
+
+    crc4_zeros_tab_t() {
+        for(uint8_t c = 0; c < 16; ++c) {
+            tab[0][c] = c;
+            for(size_t len = 1; len < CRC4_ZEROS_TAB_LEN; ++len)
+                tab[len][c] = crc4(tab[len - 1][c], 0, BITS_PER_BYTE);
+        }
+    }
+};
+
+static const crc4_zeros_tab_t crc4_zeros_tab;
+
+uint8_t crc4_zeros(uint8_t c, size_t len) {
+    for(; len >= CRC4_ZEROS_TAB_LEN; len -= CRC4_ZEROS_TAB_LEN - 1)
+        c = crc4_zeros_tab.tab[CRC4_ZEROS_TAB_LEN - 1][c];
+
+    return crc4_zeros_tab.tab[len][c];
+}
+
 uint8_t crc4_packet(const uint8_t *beg, const uint8_t *end) {
     assertm((end - beg) >= HEADER_SIZE, 
             "crc4_packet: packet does not have enough bytes for header");
 
-    detail::msg_hdr_view_t hdr_view(beg);
-    uint8_t crc4_res = hdr_view.calculate_crc4();
+    // crc4 of header is taken from header table
+    uint8_t crc4_res = detail::hdr_info(beg).crc4_state();
 
     beg += HEADER_SIZE;
 
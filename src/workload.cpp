@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <unordered_set>
+
+#include "workload.hpp"
+#include "packet.hpp"
+
+namespace messenger::workload {
+
+namespace {
+
+using rng_t = std::mt19937_64;
+
+size_t draw_len(const length_dist_t &dist, rng_t &rng) {
+    if(dist.mean == 0)
+        return std::uniform_int_distribution<size_t>(dist.min, dist.max)(rng);
+
+    std::exponential_distribution<double> exp_dist(1.0 / dist.mean);
+    size_t len = static_cast<size_t>(exp_dist(rng));
+    return std::min(std::max(len, dist.min), dist.max);
+}
+
+std::string draw_text(const length_dist_t &dist, const std::vector<std::string> &words, rng_t &rng) {
+    static const char ALPHABET[] = "abcdefghijklmnopqrstuvwxyz ABCDEFGHIJKLMNOPQRSTUVWXYZ 0123456789.,!?";
+
+    size_t len = std::max<size_t>(draw_len(dist, rng), 1);
+    // Message of full packets can not be told apart from its continuation
+    if(len % MSGR_MSG_LEN_MAX == 0)
+        len++;
+
+    if(!words.empty()) {
+        // Chatty text: words of small vocabulary, frequent ones first (exponential rank)
+        std::geometric_distribution<size_t> rank_dist(std::min(1.0, 8.0 / words.size()));
+        std::string text;
+        while(text.size() < len) {
+            text += words[std::min(rank_dist(rng), words.size() - 1)];
+            text += ' ';
+        }
+        text.resize(len);
+        return text;
+    }
+
+    std::uniform_int_distribution<size_t> char_dist(0, sizeof(ALPHABET) - 2);
+    std::string text(len, ' ');
+    for(char &c : text)
+        c = ALPHABET[char_dist(rng)];
+
+    return text;
+}
+
+// Lowercase words of 2-10 letters
+std::vector<std::string> draw_words(size_t num, rng_t &rng) {
+    std::uniform_int_distribution<size_t> len_dist(2, 10);
+    std::uniform_int_distribution<int> letter_dist('a', 'z');
+
+    std::vector<std::string> words(num);
+    for(std::string &word : words) {
+        word.resize(len_dist(rng));
+        for(char &c : word)
+            c = static_cast<char>(letter_dist(rng));
+    }
+
+    return words;
+}
+
+// Unique names: index in base 36, padded with letters up to drawn length
+std::vector<std::string> draw_names(const config_t &config, rng_t &rng) {
+    static const char DIGITS[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+    std::vector<std::string> names;
+    names.reserve(config.senders);
+
+    for(size_t i = 0; i < config.senders; ++i) {
+        std::string name;
+        for(size_t idx = i; name.empty() || idx != 0; idx /= 36)
+            name += DIGITS[idx % 36];
+
+        size_t len = std::min<size_t>(draw_len(config.name_len, rng), MSGR_NAME_LEN_MAX);
+        std::uniform_int_distribution<int> letter_dist('A', 'Z');
+        while(name.size() < len)
+            name += static_cast<char>(letter_dist(rng));
+
+        if(name.size() > MSGR_NAME_LEN_MAX)
+            throw std::invalid_argument("messenger: workload: too many senders for name length");
+
+        names.push_back(name);
+    }
+
+    return names;
+}
+
+void check_config(const config_t &config) {
+    if(config.senders == 0)
+        throw std::invalid_argument("messenger: workload: no senders");
+    if(config.interleave == 0 || config.interleave > config.senders)
+        throw std::invalid_argument("messenger: workload: interleave has to be within [1, senders]");
+    if(config.name_len.min > config.name_len.max || config.text_len.min > config.text_len.max)
+        throw std::invalid_argument("messenger: workload: invalid length distribution");
+}
+
+} // namespace
+
+
+length_dist_t length_dist_t::parse(const std::string &str) {
+    length_dist_t dist = {0, 0, 0};
+    size_t first = str.find(':');
+    if(first == std::string::npos)
+        throw std::invalid_argument("messenger: workload: length distribution has to be MIN:MAX[:MEAN]");
+
+    size_t second = str.find(':', first + 1);
+    dist.min = std::stoul(str.substr(0, first));
+    dist.max = std::stoul(str.substr(first + 1, second - first - 1));
+    if(second != std::string::npos)
+        dist.mean = std::stoul(str.substr(second + 1));
+
+    if(dist.min > dist.max)
+        throw std::invalid_argument("messenger: workload: MIN exceeds MAX");
+
+    return dist;
+}
+
+std::vector<msg_t> generate_msgs(const config_t &config) {
+    check_config(config);
+
+    rng_t rng(config.seed);
+    std::vector<std::string> names = draw_names(config, rng);
+    std::vector<std::string> words = draw_words(config.vocabulary, rng);
+    std::uniform_int_distribution<size_t> sender_dist(0, names.size() - 1);
+
+    std::vector<msg_t> msgs;
+    msgs.reserve(config.msgs);
+    for(size_t i = 0; i < config.msgs; ++i) {
+        const std::string &name = names[sender_dist(rng)];
+        msgs.emplace_back(name, draw_text(config.text_len, words, rng));
+    }
+
+    return msgs;
+}
+
+traffic_t generate_traffic(const config_t &config) {
+    check_config(config);
+
+    struct in_flight_t {
+        size_t sender;
+        std::vector<uint8_t> buff;
+        size_t pos;
+    };
+
+    rng_t rng(config.seed);
+    std::vector<std::string> names = draw_names(config, rng);
+    std::vector<std::string> words = draw_words(config.vocabulary, rng);
+    std::uniform_int_distribution<size_t> sender_dist(0, names.size() - 1);
+    std::uniform_real_distribution<double> corrupt_dist(0.0, 1.0);
+
+    traffic_t traffic;
+    std::vector<in_flight_t> in_flight;
+    std::unordered_set<size_t> busy_senders;
+
+    auto start_msg = [&]() {
+        size_t sender;
+        do {
+            sender = sender_dist(rng);
+        } while(busy_senders.count(sender) != 0);
+        busy_senders.insert(sender);
+
+        msg_t msg(names[sender], draw_text(config.text_len, words, rng));
+        traffic.text_bytes += msg.text.size();
+        traffic.msgs++;
+        in_flight.push_back(in_flight_t{sender, make_buff(msg, config.buff_opts), 0});
+
+        // Compression is told by first text packet, which may follow CRC32C packet
+        const uint8_t *text_packet = in_flight.back().buff.data();
+        if(detail::packet_view_t(text_packet).checksum())
+            text_packet += detail::packet_size(text_packet);
+        traffic.compressed += detail::packet_view_t(text_packet).compressed();
+    };
+
+    size_t started = 0;
+    for(; started < config.msgs && in_flight.size() < config.interleave; ++started)
+        start_msg();
+
+    while(!in_flight.empty()) {
+        size_t slot = std::uniform_int_distribution<size_t>(0, in_flight.size() - 1)(rng);
+        in_flight_t &cur = in_flight[slot];
+
+        // Emit next packet of message
+        const uint8_t *packet = cur.buff.data() + cur.pos;
+        size_t packet_size = detail::packet_size(packet);
+        size_t out_pos = traffic.stream.size();
+        traffic.stream.insert(traffic.stream.end(), packet, packet + packet_size);
+        traffic.packets++;
+
+        if(config.corrupt_ratio > 0 && corrupt_dist(rng) < config.corrupt_ratio) {
+            // Flip bit of last payload byte, keeping header intact
+            traffic.stream[out_pos + packet_size - 1] ^= 0x1;
+            traffic.corrupted++;
+        }
+
+        cur.pos += packet_size;
+        if(cur.pos == cur.buff.size()) {
+            busy_senders.erase(cur.sender);
+            in_flight.erase(in_flight.begin() + slot);
+
+            if(started < config.msgs) {
+                start_msg();
+                started++;
+            }
+        }
+    }
+
+    return traffic;
+}
+
+} // namespace messenger::workload
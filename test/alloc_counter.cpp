@@ -0,0 +1,165 @@
+#include "alloc_counter.hpp"
+
+#include <cstdlib>
+#include <new>
+
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+#define TEST_ALLOC_SANITIZED 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer) || __has_feature(thread_sanitizer) || __has_feature(memory_sanitizer)
+#define TEST_ALLOC_SANITIZED 1
+#endif
+#endif
+
+// glibc exports its allocator under __libc_ names, so malloc can be interposed without dlsym
+#if defined(__GLIBC__) && !defined(TEST_ALLOC_SANITIZED)
+#define TEST_ALLOC_MALLOC 1
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t num, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+}
+#endif
+
+namespace test::alloc {
+
+namespace {
+
+// Trivial thread_local: no lazy initialization, which could allocate itself
+thread_local size_t t_num = 0;
+thread_local size_t t_bytes = 0;
+
+inline void record(size_t size) {
+    t_num++;
+    t_bytes += size;
+}
+
+// Allocation, which is not counted again by interposed malloc
+inline void *raw_malloc(size_t size) {
+#ifdef TEST_ALLOC_MALLOC
+    return __libc_malloc(size);
+#else
+    return std::malloc(size);
+#endif
+}
+
+inline void raw_free(void *ptr) {
+#ifdef TEST_ALLOC_MALLOC
+    __libc_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+
+void *counted_new(size_t size) {
+    record(size);
+
+    void *ptr = raw_malloc(size != 0 ? size : 1);
+    if(ptr == NULL)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void *counted_new_aligned(size_t size, std::align_val_t align) {
+    record(size);
+
+    // aligned_alloc requires size to be multiple of alignment
+    size_t alignment = static_cast<size_t>(align);
+    size_t rounded = (size + alignment - 1) / alignment * alignment;
+    void *ptr = std::aligned_alloc(alignment, rounded != 0 ? rounded : alignment);
+    if(ptr == NULL)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+} // namespace
+
+counts_t thread_counts() {
+    return counts_t{t_num, t_bytes};
+}
+
+bool counts_malloc() {
+#ifdef TEST_ALLOC_MALLOC
+    return true;
+#else
+    return false;
+#endif
+}
+
+} // namespace test::alloc
+
+
+void *operator new(size_t size) {
+    return test::alloc::counted_new(size);
+}
+
+void *operator new[](size_t size) {
+    return test::alloc::counted_new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+    try {
+        return test::alloc::counted_new(size);
+    } catch(const std::bad_alloc &) {
+        return NULL;
+    }
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+    try {
+        return test::alloc::counted_new(size);
+    } catch(const std::bad_alloc &) {
+        return NULL;
+    }
+}
+
+void *operator new(size_t size, std::align_val_t align) {
+    return test::alloc::counted_new_aligned(size, align);
+}
+
+void *operator new[](size_t size, std::align_val_t align) {
+    return test::alloc::counted_new_aligned(size, align);
+}
+
+void operator delete(void *ptr) noexcept { test::alloc::raw_free(ptr); }
+void operator delete[](void *ptr) noexcept { test::alloc::raw_free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { test::alloc::raw_free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { test::alloc::raw_free(ptr); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { test::alloc::raw_free(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { test::alloc::raw_free(ptr); }
+
+// aligned_alloc memory is released by free (interposed one forwards to __libc_free)
+void operator delete(void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+
+#ifdef TEST_ALLOC_MALLOC
+
+extern "C" {
+
+void *malloc(size_t size) {
+    test::alloc::record(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t num, size_t size) {
+    test::alloc::record(num * size);
+    return __libc_calloc(num, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    test::alloc::record(size);
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+    __libc_free(ptr);
+}
+
+} // extern "C"
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef TEST_ALLOC_COUNTER_H
+#define TEST_ALLOC_COUNTER_H
+
+#include <cstddef>
+#include <utility>
+
+namespace test {
+
+/**
+ * Allocation counting of test binary
+ *
+ * @details alloc_counter.cpp replaces global operator new & delete (every form) and, on glibc
+ *          without sanitizers, interposes malloc, calloc & realloc. Allocations are counted
+ *          per thread, so threads of other tests do not disturb measurement.
+*/
+namespace alloc {
+
+/**
+ * Number & size of heap allocations
+*/
+struct counts_t
+{
+    size_t num = 0;     /**< number of allocations */
+    size_t bytes = 0;   /**< requested bytes */
+};
+
+// Allocations of calling thread since its start
+counts_t thread_counts();
+
+// Whether malloc family is counted (sanitizers own malloc, so only operator new is counted then)
+bool counts_malloc();
+
+/**
+ * Allocations of calling thread since construction of scope
+ *
+ * @sample
+ *
+ * test::alloc::scope_t scope;
+ * messenger::parse_buff(beg, end, msg);
+ * REQUIRE(scope.counts().num == 0);
+*/
+class scope_t {
+
+private:
+    counts_t m_beg;
+
+public:
+    scope_t(): m_beg(thread_counts()) {}
+
+    counts_t counts() const {
+        counts_t now = thread_counts();
+        return counts_t{now.num - m_beg.num, now.bytes - m_beg.bytes};
+    }
+
+};
+
+// Allocations of single call of fn
+template<typename Fn>
+counts_t count(Fn &&fn) {
+    scope_t scope;
+    std::forward<Fn>(fn)();
+    return scope.counts();
+}
+
+} // namespace alloc
+
+} // namespace test
+
+#endif
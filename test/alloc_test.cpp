@@ -0,0 +1,230 @@
+#include <catch2/catch_all.hpp>
+
+#include <cstdlib>
+#include <functional>
+#include <memory>
+
+#include "messenger.hpp"
+#include "reassembler.hpp"
+#include "relay.hpp"
+#include "segmented.hpp"
+#include "sender_encoder.hpp"
+
+#include "alloc_counter.hpp"
+#include "test_util.hpp"
+
+
+namespace test {
+
+namespace {
+
+// Longer than small string buffer, shorter than packet multiple
+const std::string TEXT = util::repeat_string("hot path text ", 14) + "!";
+
+messenger::buff_opts_t compress_opts() {
+    messenger::buff_opts_t opts;
+    opts.compress = true;
+    opts.compress_threshold = 0;
+    return opts;
+}
+
+messenger::buff_opts_t crc32c_opts() {
+    messenger::buff_opts_t opts;
+    opts.crc32c = true;
+    return opts;
+}
+
+// Keeps allocation observable, so compiler can not elide pair of new & delete
+const void *volatile g_sink = NULL;
+
+template<typename T>
+T *keep(T *ptr) {
+    g_sink = ptr;
+    return ptr;
+}
+
+/**
+ * Allocation budget of API call
+*/
+struct budget_t
+{
+    const char *api;
+    size_t allocs;                  // at most, per call in steady state
+    std::function<void()> call;
+};
+
+} // namespace
+
+/**
+ * Allocation counter Unit Tests
+*/
+
+TEST_CASE("alloc counter: counts allocations of calling thread", "[alloc][normal]") {
+    alloc::scope_t scope;
+
+    std::unique_ptr<int> one(keep(new int(1)));
+    std::unique_ptr<int[]> arr(keep(new int[100]));
+    REQUIRE(scope.counts().num == 2);
+    REQUIRE(scope.counts().bytes >= sizeof(int) * 101);
+
+    if(alloc::counts_malloc()) {
+        void *ptr = keep(std::malloc(64));
+        REQUIRE(scope.counts().num == 3);
+        std::free(ptr);
+    }
+
+    // Releasing is not allocation
+    size_t before = scope.counts().num;
+    one.reset();
+    arr.reset();
+    REQUIRE(scope.counts().num == before);
+
+    REQUIRE(alloc::count([]() { std::string small("short"); keep(small.data()); }).num == 0);
+    REQUIRE(alloc::count([]() { std::vector<uint8_t> big(1000); keep(big.data()); }).num == 1);
+}
+
+/**
+ * Zero-allocation hot paths
+*/
+
+TEST_CASE("parse_buff: decoding into reused target performs 0 allocations", "[alloc][normal]") {
+    messenger::msg_t target;
+
+    for(const messenger::buff_opts_t &opts : {messenger::buff_opts_t(), compress_opts(), crc32c_opts()}) {
+        std::vector<uint8_t> buff = messenger::make_buff(messenger::msg_t("Sender", TEXT), opts);
+
+        // Warm up: target & scratch grow to fit message
+        messenger::parse_buff(buff.data(), buff.data() + buff.size(), target);
+        messenger::parse_buff(buff.data(), buff.data() + buff.size(), target);
+
+        alloc::counts_t counts = alloc::count([&]() {
+            for(int i = 0; i < 100; ++i)
+                messenger::parse_buff(buff.data(), buff.data() + buff.size(), target);
+        });
+
+        REQUIRE(counts.num == 0);
+        REQUIRE(target.name == "Sender");
+        REQUIRE(target.text == TEXT);
+    }
+}
+
+TEST_CASE("append_buff: encoding into reserved output performs 0 allocations", "[alloc][normal]") {
+    messenger::msg_t msg("Sender", TEXT);
+    messenger::sender_encoder_t encoder("Sender");
+
+    std::vector<uint8_t> out;
+    out.reserve(4096);
+
+    alloc::counts_t counts = alloc::count([&]() {
+        for(int i = 0; i < 100; ++i) {
+            out.clear();
+            messenger::append_buff(msg, out);
+            messenger::append_buff(msg, out, crc32c_opts());
+            encoder.append(msg.text, out);
+            messenger::write_buff(msg, out.data());
+        }
+    });
+
+    REQUIRE(counts.num == 0);
+    REQUIRE(messenger::parse_buff(out.data(), out.data() + messenger::buff_size(msg)).text == TEXT);
+}
+
+TEST_CASE("reassembler_t: steady state feed performs 0 allocations", "[alloc][normal]") {
+    size_t delivered = 0;
+    messenger::reassembler_t reasm([&](std::string_view, std::string_view text, messenger::reassembly_reason_t) {
+        delivered += text == TEXT;
+    });
+
+    std::vector<uint8_t> stream;
+    for(int sender = 0; sender < 50; ++sender) {
+        std::string name = "S" + std::to_string(sender);
+        messenger::append_buff(messenger::msg_t(name, TEXT), stream);
+        messenger::append_buff(messenger::msg_t(name, TEXT), stream, compress_opts());
+        messenger::append_buff(messenger::msg_t(name, TEXT), stream, crc32c_opts());
+    }
+
+    // Warm up: senders' entries, text buffers & index tables are allocated once
+    for(int round = 0; round < 3; ++round)
+        reasm.feed(stream.data(), stream.data() + stream.size());
+
+    alloc::counts_t counts = alloc::count([&]() {
+        for(int round = 0; round < 10; ++round) {
+            // Odd chunks, so packets are split across feeds
+            for(size_t pos = 0; pos < stream.size(); pos += 37)
+                reasm.feed(stream.data() + pos, stream.data() + std::min(pos + 37, stream.size()));
+        }
+    });
+
+    REQUIRE(counts.num == 0);
+    REQUIRE(delivered == 13 * 150);
+}
+
+TEST_CASE("relay_t: forwarding into reserved output performs 0 allocations", "[alloc][normal]") {
+    messenger::relay_t relay;
+    relay.add_rename("Alice", "Bob");
+
+    std::vector<uint8_t> in;
+    messenger::append_buff(messenger::msg_t("Alice", TEXT), in);
+    messenger::append_buff(messenger::msg_t("Carol", TEXT), in);
+
+    std::vector<uint8_t> out;
+    out.reserve(2 * in.size());
+
+    alloc::counts_t counts = alloc::count([&]() {
+        for(int i = 0; i < 100; ++i) {
+            out.clear();
+            relay.forward(in.data(), in.data() + in.size(), out);
+        }
+    });
+
+    REQUIRE(counts.num == 0);
+}
+
+/**
+ * Allocation budgets of API
+ *
+ * Budgets are upper bounds per call in steady state, for TEXT of single sender.
+ * Raising one is deliberate change of API cost: update README table together with it.
+*/
+
+TEST_CASE("allocation budgets of API", "[alloc][normal]") {
+    messenger::msg_t msg("Sender", TEXT);
+    std::vector<uint8_t> plain = messenger::make_buff(msg);
+    std::vector<uint8_t> packed = messenger::make_buff(msg, compress_opts());
+    std::vector<std::vector<uint8_t>> segments = {
+        std::vector<uint8_t>(plain.begin(), plain.begin() + 10),
+        std::vector<uint8_t>(plain.begin() + 10, plain.end())
+    };
+
+    messenger::msg_t target;
+    std::vector<uint8_t> out;
+    out.reserve(4096);
+
+    const budget_t budgets[] = {
+        {"make_buff", 1, [&]() { messenger::make_buff(msg); }},
+        {"make_buff compressed", 2, [&]() { messenger::make_buff(msg, compress_opts()); }},
+        {"append_buff", 0, [&]() { out.clear(); messenger::append_buff(msg, out); }},
+        {"append_buff crc32c", 0, [&]() { out.clear(); messenger::append_buff(msg, out, crc32c_opts()); }},
+        {"append_buff compressed", 1, [&]() { out.clear(); messenger::append_buff(msg, out, compress_opts()); }},
+        {"write_buff", 0, [&]() { messenger::write_buff(msg, out.data()); }},
+        {"parse_buff", 1, [&]() { messenger::parse_buff(plain); }},
+        {"parse_buff compressed", 2, [&]() { messenger::parse_buff(packed); }},
+        {"parse_buff into target", 0, [&]() { messenger::parse_buff(plain.data(), plain.data() + plain.size(), target); }},
+        {"parse_buff into target compressed", 0,
+            [&]() { messenger::parse_buff(packed.data(), packed.data() + packed.size(), target); }},
+        {"parse_segments", 1, [&]() { messenger::parse_segments(segments); }},
+    };
+
+    for(const budget_t &budget : budgets) {
+        // Warm up: thread local scratch buffers grow to fit message
+        budget.call();
+
+        alloc::counts_t counts = alloc::count(budget.call);
+
+        INFO(budget.api << ": " << counts.num << " allocations, " << counts.bytes << " bytes (budget "
+             << budget.allocs << ")");
+        REQUIRE(counts.num <= budget.allocs);
+    }
+}
+
+} // namespace test
@@ -0,0 +1,116 @@
+#include <catch2/catch_all.hpp>
+
+#include <algorithm>
+#include <mutex>
+#include <thread>
+
+#include "batch_encoder.hpp"
+#include "messenger.hpp"
+#include "msg_hdr.hpp"
+
+#include "test_util.hpp"
+
+
+namespace test {
+
+/**
+ * batch_encoder_t Unit Tests
+*/
+
+TEST_CASE("batch_encoder_t: single producer keeps order of messages", "[batch_encoder_t][normal]") {
+    const size_t MSG_NUM = 100;
+    std::vector<uint8_t> out;
+    std::vector<uint8_t> expected;
+    size_t delivered = 0;
+    size_t max_msg_num = 0;
+
+    messenger::batch_config_t config;
+    config.max_batch_msgs = 16;
+
+    {
+        // Sink runs on writer thread: assertions are made after flush
+        messenger::batch_encoder_t enc([&](const uint8_t *beg, const uint8_t *end, size_t msg_num) {
+            max_msg_num = std::max(max_msg_num, msg_num);
+            out.insert(out.end(), beg, end);
+            delivered += msg_num;
+        }, config);
+
+        for(size_t i = 0; i < MSG_NUM; ++i) {
+            messenger::msg_t msg("Name", "Message #" + std::to_string(i) + util::repeat_string("-", i));
+            messenger::append_buff(msg, expected);
+            enc.submit(msg);
+        }
+
+        enc.flush();
+        REQUIRE(delivered == MSG_NUM);
+        REQUIRE(max_msg_num <= 16);
+
+        messenger::batch_stats_t stats = enc.stats();
+        REQUIRE(stats.msgs == MSG_NUM);
+        REQUIRE(stats.bytes == expected.size());
+        REQUIRE(stats.batches >= MSG_NUM / 16);
+    }
+
+    REQUIRE_THAT(out, Catch::Matchers::RangeEquals(expected));
+}
+
+TEST_CASE("batch_encoder_t: many producers", "[batch_encoder_t][normal]") {
+    const size_t THREAD_NUM = 4;
+    const size_t MSG_NUM = 2000;
+    std::vector<uint8_t> out;
+
+    {
+        messenger::batch_encoder_t enc([&](const uint8_t *beg, const uint8_t *end, size_t) {
+            out.insert(out.end(), beg, end);
+        });
+
+        std::vector<std::thread> producers;
+        for(size_t t = 0; t < THREAD_NUM; ++t) {
+            producers.emplace_back([&enc, t, MSG_NUM] {
+                for(size_t i = 0; i < MSG_NUM; ++i)
+                    enc.submit(messenger::msg_t("T" + std::to_string(t), std::to_string(i)));
+            });
+        }
+
+        for(std::thread &producer : producers)
+            producer.join();
+    }
+    // Destructor delivered every message
+
+    // Every message fits single packet: walk packets, check order per producer
+    std::vector<size_t> next_idx(THREAD_NUM, 0);
+    size_t pos = 0;
+    while(pos < out.size()) {
+        messenger::detail::msg_hdr_view_t hdr_view(out.data() + pos);
+        size_t packet_size = messenger::detail::HEADER_SIZE + hdr_view.get_name_len() + hdr_view.get_msg_len();
+
+        std::vector<uint8_t> packet(out.begin() + pos, out.begin() + pos + packet_size);
+        messenger::msg_t msg = messenger::parse_buff(packet);
+
+        size_t t = std::stoul(msg.name.substr(1));
+        REQUIRE(t < THREAD_NUM);
+        REQUIRE(msg.text == std::to_string(next_idx[t]));
+        next_idx[t]++;
+
+        pos += packet_size;
+    }
+
+    for(size_t t = 0; t < THREAD_NUM; ++t)
+        REQUIRE(next_idx[t] == MSG_NUM);
+}
+
+TEST_CASE("batch_encoder_t: invalid message throws in producer", "[batch_encoder_t][false]") {
+    size_t delivered = 0;
+    messenger::batch_encoder_t enc([&](const uint8_t *, const uint8_t *, size_t msg_num) {
+        delivered += msg_num;
+    });
+
+    CHECK_THROWS_AS(enc.submit(messenger::msg_t("", "Lorem ipsum")), std::length_error);
+    CHECK_THROWS_AS(enc.submit(messenger::msg_t("TooLongToBeAName", "Lorem ipsum")), std::length_error);
+    CHECK_THROWS_AS(enc.submit(messenger::msg_t("Name", "")), std::length_error);
+
+    enc.flush();
+    REQUIRE(delivered == 0);
+}
+
+} // namespace test
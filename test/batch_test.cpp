@@ -0,0 +1,260 @@
+#include <catch2/catch_all.hpp>
+
+#include "batch.hpp"
+#include "messenger.hpp"
+#include "msg_hdr.hpp"
+
+#include "alloc_counter.hpp"
+#include "test_util.hpp"
+
+
+namespace test {
+
+namespace {
+
+std::vector<messenger::msg_t> sample_msgs() {
+    return {
+        messenger::msg_t("Alice", "Hi"),
+        messenger::msg_t("Bob", util::repeat_string("long text ", 30) + "!"),
+        messenger::msg_t(util::repeat_string("N", MSGR_NAME_LEN_MAX), util::repeat_string("y", MSGR_MSG_LEN_MAX)),
+        messenger::msg_t("C", util::repeat_string("compressible ", 50))
+    };
+}
+
+bool same(const messenger::msg_t &a, const messenger::msg_t &b) {
+    return a.name == b.name && a.text == b.text;
+}
+
+messenger::buff_opts_t batch_opts(bool compress, bool crc32c) {
+    messenger::buff_opts_t opts;
+    opts.compress = compress;
+    opts.compress_threshold = 0;
+    opts.crc32c = crc32c;
+    return opts;
+}
+
+} // namespace
+
+/**
+ * make_buff_batch Unit Tests
+*/
+
+TEST_CASE("make_buff_batch: buffer is concatenation of messages", "[batch][normal]") {
+    std::vector<messenger::msg_t> msgs = sample_msgs();
+
+    for(bool compress : {false, true}) {
+        for(bool crc32c : {false, true}) {
+            messenger::buff_opts_t opts = batch_opts(compress, crc32c);
+            messenger::msg_batch_t batch = messenger::make_buff_batch(msgs, opts);
+
+            REQUIRE(batch.size() == msgs.size());
+            REQUIRE(batch.offsets.front() == 0);
+            REQUIRE(batch.offsets.back() == batch.buff.size());
+
+            for(size_t i = 0; i < msgs.size(); ++i) {
+                REQUIRE(std::vector<uint8_t>(batch.msg_begin(i), batch.msg_end(i)) == messenger::make_buff(msgs[i], opts));
+                REQUIRE(same(messenger::parse_buff(batch.msg_begin(i), batch.msg_end(i)), msgs[i]));
+            }
+        }
+    }
+}
+
+TEST_CASE("make_buff_batch: empty batch", "[batch][normal]") {
+    messenger::msg_batch_t batch = messenger::make_buff_batch(std::vector<messenger::msg_t>());
+    REQUIRE(batch.size() == 0);
+    REQUIRE(batch.buff.empty());
+
+    messenger::parsed_batch_t parsed = messenger::parse_batch(batch);
+    REQUIRE(parsed.size() == 0);
+
+    // Table of no offsets at all is empty batch too
+    REQUIRE(messenger::parse_batch(messenger::msg_batch_t()).size() == 0);
+}
+
+TEST_CASE("make_buff_batch: invalid message", "[batch][false]") {
+    std::vector<messenger::msg_t> msgs = sample_msgs();
+    msgs.emplace_back("", "no name");
+
+    messenger::msg_batch_t batch = messenger::make_buff_batch(sample_msgs());
+
+    for(bool compress : {false, true}) {
+        CHECK_THROWS_AS(messenger::make_buff_batch(msgs.data(), msgs.data() + msgs.size(), batch,
+            batch_opts(compress, false)), std::length_error);
+        REQUIRE(batch.size() == 0);
+        REQUIRE(batch.buff.empty());
+    }
+}
+
+/**
+ * parse_batch Unit Tests
+*/
+
+TEST_CASE("parse_batch: round trip into shared storage", "[batch][normal]") {
+    std::vector<messenger::msg_t> msgs = sample_msgs();
+    messenger::parsed_batch_t parsed;
+
+    for(bool compress : {false, true}) {
+        for(bool crc32c : {false, true}) {
+            messenger::msg_batch_t batch = messenger::make_buff_batch(msgs, batch_opts(compress, crc32c));
+            messenger::parse_batch(batch, parsed);
+
+            REQUIRE(parsed.size() == msgs.size());
+            size_t text_bytes = 0;
+            for(size_t i = 0; i < msgs.size(); ++i) {
+                REQUIRE(parsed.name(i) == msgs[i].name);
+                REQUIRE(parsed.text(i) == msgs[i].text);
+                REQUIRE(same(parsed.msg(i), msgs[i]));
+                text_bytes += msgs[i].text.size();
+            }
+            REQUIRE(parsed.texts.size() == text_bytes);
+        }
+    }
+}
+
+TEST_CASE("parse_batch: reused output performs 0 allocations", "[batch][normal]") {
+    std::vector<messenger::msg_t> msgs;
+    for(int i = 0; i < 100; ++i)
+        msgs.push_back(messenger::msg_t("S" + std::to_string(i % 7), util::repeat_string("text ", i) + "!"));
+
+    messenger::msg_batch_t batch;
+    messenger::parsed_batch_t parsed;
+
+    // Warm up: output storage grows to fit batch
+    messenger::make_buff_batch(msgs.data(), msgs.data() + msgs.size(), batch);
+    messenger::parse_batch(batch, parsed);
+
+    alloc::counts_t counts = alloc::count([&]() {
+        messenger::make_buff_batch(msgs.data(), msgs.data() + msgs.size(), batch);
+        messenger::parse_batch(batch, parsed);
+    });
+
+    REQUIRE(counts.num == 0);
+    REQUIRE(parsed.size() == msgs.size());
+    REQUIRE(same(parsed.msg(99), msgs[99]));
+}
+
+TEST_CASE("parse_batch: invalid batch", "[batch][false]") {
+    messenger::msg_batch_t batch = messenger::make_buff_batch(sample_msgs());
+    messenger::parsed_batch_t parsed = messenger::parse_batch(batch);
+
+    SECTION("offset inside packet") {
+        batch.offsets[2] -= 1;
+        CHECK_THROWS_AS(messenger::parse_batch(batch, parsed), std::runtime_error);
+    }
+
+    SECTION("offsets are not ascending") {
+        batch.offsets[2] = batch.offsets[1];
+        CHECK_THROWS_AS(messenger::parse_batch(batch, parsed), std::runtime_error);
+    }
+
+    SECTION("corrupted packet") {
+        batch.buff[batch.offsets[3] + 2] ^= 0x01;
+        CHECK_THROWS_AS(messenger::parse_batch(batch, parsed), std::runtime_error);
+    }
+
+    SECTION("offsets exceed buffer") {
+        batch.offsets.back() = batch.buff.size() + 200;
+        CHECK_THROWS_AS(messenger::parse_batch(batch, parsed), std::out_of_range);
+    }
+
+    // Output holds no partial batch
+    REQUIRE(parsed.size() == 0);
+    REQUIRE(parsed.texts.empty());
+}
+
+/**
+ * append_columnar Unit Tests
+*/
+
+TEST_CASE("append_columnar: senders are dictionary encoded", "[batch][normal]") {
+    std::vector<messenger::msg_t> msgs = sample_msgs();
+    msgs.push_back(messenger::msg_t("Bob", "again"));
+    msgs.push_back(messenger::msg_t("Alice", "and again"));
+
+    for(bool compress : {false, true}) {
+        messenger::msg_batch_t batch = messenger::make_buff_batch(msgs, batch_opts(compress, true));
+        messenger::columnar_batch_t cols = messenger::parse_columnar(batch);
+
+        REQUIRE(cols.size() == msgs.size());
+        REQUIRE(cols.text_offsets.size() == msgs.size() + 1);
+        REQUIRE(cols.senders.size() == 4);
+        REQUIRE(cols.sender_ids == std::vector<uint32_t>{0, 1, 2, 3, 1, 0});
+        REQUIRE(cols.sender(1) == "Bob");
+        REQUIRE(cols.sender_id("Alice") == 0);
+        REQUIRE(cols.sender_id("Nobody") == messenger::detail::name_index_t::npos);
+        REQUIRE(cols.sender_id(util::repeat_string("N", MSGR_NAME_LEN_MAX + 1)) == messenger::detail::name_index_t::npos);
+
+        for(size_t i = 0; i < msgs.size(); ++i)
+            REQUIRE(same(cols.msg(i), msgs[i]));
+
+        // Next batch keeps ids of known senders
+        std::vector<messenger::msg_t> more = {messenger::msg_t("Dave", "new"), messenger::msg_t("Bob", "old")};
+        messenger::append_columnar(messenger::make_buff_batch(more), cols);
+        REQUIRE(cols.size() == msgs.size() + 2);
+        REQUIRE(cols.sender_ids[msgs.size()] == 4);
+        REQUIRE(cols.sender_ids[msgs.size() + 1] == 1);
+        REQUIRE(cols.text(msgs.size() + 1) == "old");
+    }
+}
+
+TEST_CASE("append_columnar: reused output performs 0 allocations", "[batch][normal]") {
+    std::vector<messenger::msg_t> msgs;
+    for(int i = 0; i < 100; ++i)
+        msgs.push_back(messenger::msg_t("S" + std::to_string(i % 7), util::repeat_string("text ", i) + "!"));
+
+    messenger::msg_batch_t batch = messenger::make_buff_batch(msgs);
+    messenger::columnar_batch_t cols;
+
+    // Warm up: columns & dictionary grow to fit batch
+    messenger::append_columnar(batch, cols);
+
+    alloc::counts_t counts = alloc::count([&]() {
+        cols.clear();
+        messenger::append_columnar(batch, cols);
+    });
+
+    REQUIRE(counts.num == 0);
+    REQUIRE(cols.senders.size() == 7);
+    REQUIRE(same(cols.msg(99), msgs[99]));
+}
+
+TEST_CASE("append_columnar: columns grow geometrically across small batches", "[batch][normal]") {
+    std::vector<messenger::msg_t> msgs = {messenger::msg_t("Alice", "small"), messenger::msg_t("Bob", "batch")};
+    messenger::msg_batch_t batch = messenger::make_buff_batch(msgs);
+
+    messenger::columnar_batch_t cols;
+    messenger::append_columnar(batch, cols);
+
+    // Reallocations per column are logarithmic in number of batches
+    alloc::counts_t counts = alloc::count([&]() {
+        for(int i = 0; i < 5000; ++i)
+            messenger::append_columnar(batch, cols);
+    });
+
+    REQUIRE(cols.size() == 2 * 5001);
+    REQUIRE(counts.num < 3 * 20);
+}
+
+TEST_CASE("append_columnar: invalid batch", "[batch][false]") {
+    messenger::columnar_batch_t cols = messenger::parse_columnar(messenger::make_buff_batch(sample_msgs()));
+
+    std::vector<messenger::msg_t> msgs = {messenger::msg_t("New", "sender"), messenger::msg_t("Bob", "text")};
+    messenger::msg_batch_t batch = messenger::make_buff_batch(msgs);
+    batch.buff[batch.offsets[1] + 2] ^= 0x01;
+    CHECK_THROWS_AS(messenger::append_columnar(batch, cols), std::runtime_error);
+
+    batch.offsets[2] = batch.offsets[1];
+    CHECK_THROWS_AS(messenger::append_columnar(batch, cols), std::runtime_error);
+
+    batch.offsets.back() = batch.buff.size() + 200;
+    CHECK_THROWS_AS(messenger::append_columnar(batch, cols), std::out_of_range);
+
+    // Output holds no partial batch, sender of failed batch is forgotten
+    REQUIRE(cols.size() == 4);
+    REQUIRE(cols.text_offsets.size() == 5);
+    REQUIRE(cols.senders.size() == 4);
+    REQUIRE(cols.sender_id("New") == messenger::detail::name_index_t::npos);
+    REQUIRE(cols.texts.size() == cols.text_offsets.back());
+}
+
+} // namespace test
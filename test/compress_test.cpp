@@ -0,0 +1,225 @@
+#include <catch2/catch_all.hpp>
+
+#include <random>
+
+#include "messenger.hpp"
+#include "compress.hpp"
+#include "packet.hpp"
+#include "reassembler.hpp"
+#include "relay.hpp"
+#include "segmented.hpp"
+
+#include "test_util.hpp"
+
+
+namespace test {
+
+namespace {
+
+std::string chatty_text(size_t len) {
+    std::string text;
+    for(size_t i = 0; text.size() < len; ++i)
+        text += i % 3 == 0 ? "hello there " : (i % 3 == 1 ? "how are you " : "fine thanks ");
+    text.resize(len);
+    return text;
+}
+
+std::string random_text(size_t len, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::string text(len, ' ');
+    for(char &c : text)
+        c = static_cast<char>(rng());
+    return text;
+}
+
+messenger::buff_opts_t compress_opts(size_t threshold = 0) {
+    messenger::buff_opts_t opts;
+    opts.compress = true;
+    opts.compress_threshold = threshold;
+    return opts;
+}
+
+} // namespace
+
+/**
+ * LZ codec Unit Tests
+*/
+
+TEST_CASE("lz: round trip", "[compress][normal]") {
+    std::vector<std::string> texts = {
+        "a", "abcd", "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+        chatty_text(100), chatty_text(5000), random_text(300, 1), random_text(70000, 2),
+        util::repeat_string("x", 100000)
+    };
+
+    for(const std::string &text : texts) {
+        const uint8_t *beg = reinterpret_cast<const uint8_t *>(text.data());
+        std::string packed;
+        messenger::detail::lz_compress(beg, beg + text.size(), packed);
+
+        std::string res = "prefix";
+        const uint8_t *packed_beg = reinterpret_cast<const uint8_t *>(packed.data());
+        const uint8_t *packed_end = packed_beg + packed.size();
+        REQUIRE(messenger::detail::lz_decompress(packed_beg, packed_end, text.size(), res) == packed_end);
+        REQUIRE(res == "prefix" + text);
+    }
+
+    // Repetitive text shrinks
+    std::string chatty = chatty_text(5000);
+    std::string packed;
+    const uint8_t *beg = reinterpret_cast<const uint8_t *>(chatty.data());
+    messenger::detail::lz_compress(beg, beg + chatty.size(), packed);
+    REQUIRE(packed.size() < chatty.size() / 10);
+}
+
+TEST_CASE("lz: corrupted input", "[compress][false]") {
+    std::string text = chatty_text(1000);
+    std::string env;
+    messenger::detail::seal_envelope(text, env);
+
+    std::string res = "kept";
+    SECTION("truncated") {
+        CHECK_THROWS_AS(messenger::detail::open_envelope(env.data(), env.data() + env.size() - 2, res), std::runtime_error);
+    }
+    SECTION("trailing garbage") {
+        env += "xy";
+        CHECK_THROWS_AS(messenger::detail::open_envelope(env.data(), env.data() + env.size(), res), std::runtime_error);
+    }
+    SECTION("length does not match") {
+        env[0] = static_cast<char>(env[0] + 1);
+        CHECK_THROWS_AS(messenger::detail::open_envelope(env.data(), env.data() + env.size(), res), std::runtime_error);
+    }
+    SECTION("huge length") {
+        std::string huge = "\xff\xff\xff\xff\xff\xff\xff\xff\x7f";
+        CHECK_THROWS_AS(messenger::detail::open_envelope(huge.data(), huge.data() + huge.size(), res), std::runtime_error);
+    }
+
+    // Flipped byte either throws or inflates to other text, never reads out of bounds
+    std::string flipped = env;
+    for(size_t i = 0; i < flipped.size(); ++i) {
+        flipped[i] ^= 0x5a;
+        try {
+            messenger::detail::open_envelope(flipped.data(), flipped.data() + flipped.size(), res);
+        } catch(const std::runtime_error &) {}
+        flipped[i] = env[i];
+    }
+}
+
+TEST_CASE("lz: envelope never fills last packet", "[compress][normal]") {
+    for(size_t len = 1; len < 2000; len += 7) {
+        std::string env;
+        messenger::detail::seal_envelope(chatty_text(len), env);
+        REQUIRE(env.size() % MSGR_MSG_LEN_MAX != 0);
+
+        std::string res;
+        messenger::detail::open_envelope(env.data(), env.data() + env.size(), res);
+        REQUIRE(res == chatty_text(len));
+    }
+}
+
+/**
+ * Compressed messages Unit Tests
+*/
+
+TEST_CASE("make_buff: compressed round trip", "[compress][normal]") {
+    messenger::msg_t msg("Chatty", chatty_text(2000));
+
+    std::vector<uint8_t> plain = messenger::make_buff(msg);
+    std::vector<uint8_t> packed = messenger::make_buff(msg, compress_opts());
+    REQUIRE(packed.size() < plain.size() / 4);
+    REQUIRE(messenger::detail::packet_view_t(packed.data()).compressed());
+
+    messenger::msg_t parsed = messenger::parse_buff(packed);
+    REQUIRE(parsed.name == msg.name);
+    REQUIRE(parsed.text == msg.text);
+
+    // Scattered across segments
+    std::vector<std::vector<uint8_t>> segments = {
+        std::vector<uint8_t>(packed.begin(), packed.begin() + 5),
+        std::vector<uint8_t>(packed.begin() + 5, packed.end())
+    };
+    REQUIRE(messenger::parse_segments(segments).text == msg.text);
+}
+
+TEST_CASE("make_buff: compression is skipped", "[compress][normal]") {
+    SECTION("below threshold") {
+        messenger::msg_t msg("Name", chatty_text(100));
+        std::vector<uint8_t> res = messenger::make_buff(msg, compress_opts(101));
+        REQUIRE(res == messenger::make_buff(msg));
+    }
+    SECTION("incompressible text") {
+        messenger::msg_t msg("Name", random_text(500, 3));
+        std::vector<uint8_t> res = messenger::make_buff(msg, compress_opts());
+        REQUIRE(res == messenger::make_buff(msg));
+    }
+    SECTION("disabled") {
+        messenger::msg_t msg("Name", chatty_text(500));
+        REQUIRE(messenger::make_buff(msg, messenger::buff_opts_t()) == messenger::make_buff(msg));
+    }
+
+    std::vector<uint8_t> out = {0x1};
+    CHECK_THROWS_AS(messenger::append_buff(messenger::msg_t("", chatty_text(500)), out, compress_opts()), std::length_error);
+    CHECK_THROWS_AS(messenger::append_buff(messenger::msg_t("Name", ""), out, compress_opts()), std::length_error);
+    REQUIRE(out.size() == 1);
+}
+
+TEST_CASE("parse_buff: compressed and plain packets mixed", "[compress][false]") {
+    std::vector<uint8_t> packed = messenger::make_buff(messenger::msg_t("Name", chatty_text(2000)), compress_opts());
+    std::vector<uint8_t> plain = messenger::make_buff(messenger::msg_t("Name", chatty_text(20)));
+
+    std::vector<uint8_t> mixed(packed.begin(), packed.begin() + messenger::detail::packet_size(packed.data()));
+    mixed.insert(mixed.end(), plain.begin(), plain.end());
+
+    CHECK_THROWS_AS(messenger::parse_buff(mixed), std::runtime_error);
+}
+
+TEST_CASE("reassembler_t: compressed messages are inflated", "[compress][normal]") {
+    std::vector<std::pair<std::string, std::string>> delivered;
+    messenger::reassembler_t reasm([&](std::string_view name, std::string_view text, messenger::reassembly_reason_t) {
+        delivered.emplace_back(std::string(name), std::string(text));
+    });
+
+    std::vector<uint8_t> stream;
+    messenger::append_buff(messenger::msg_t("A", chatty_text(3000)), stream, compress_opts());
+    messenger::append_buff(messenger::msg_t("B", "short"), stream, compress_opts());
+    messenger::append_buff(messenger::msg_t("A", chatty_text(61)), stream, compress_opts(1000));
+
+    // Byte by byte, so every packet is split across chunks
+    for(size_t i = 0; i < stream.size(); ++i)
+        reasm.feed(stream.data() + i, stream.data() + i + 1);
+
+    REQUIRE(delivered.size() == 3);
+    REQUIRE(delivered[0] == std::make_pair(std::string("A"), chatty_text(3000)));
+    REQUIRE(delivered[1] == std::make_pair(std::string("B"), std::string("short")));
+    REQUIRE(delivered[2] == std::make_pair(std::string("A"), chatty_text(61)));
+
+    SECTION("truncated compressed message is not delivered") {
+        std::string text = chatty_text(3000) + random_text(100, 4);
+        std::vector<uint8_t> packed = messenger::make_buff(messenger::msg_t("C", text), compress_opts());
+        REQUIRE(packed.size() > 2 * messenger::detail::packet_size(packed.data()));
+
+        reasm.feed(packed.data(), packed.data() + messenger::detail::packet_size(packed.data()));
+        reasm.flush();
+
+        REQUIRE(delivered.size() == 3);
+        REQUIRE(reasm.stats().undecodable == 1);
+    }
+}
+
+TEST_CASE("relay_t: renaming keeps compressed packets", "[compress][normal]") {
+    std::vector<uint8_t> packed = messenger::make_buff(messenger::msg_t("Alice", chatty_text(2000)), compress_opts());
+
+    messenger::relay_t relay;
+    relay.add_rename("Alice", "Bobby");
+
+    std::vector<uint8_t> out;
+    relay.forward(packed.data(), packed.data() + packed.size(), out);
+    relay.rewrite_in_place(packed.data(), packed.data() + packed.size());
+    REQUIRE(out == packed);
+
+    messenger::msg_t parsed = messenger::parse_buff(packed);
+    REQUIRE(parsed.name == "Bobby");
+    REQUIRE(parsed.text == chatty_text(2000));
+}
+
+} // namespace test
@@ -0,0 +1,227 @@
+#include <catch2/catch_all.hpp>
+
+#include <random>
+
+#include "messenger.hpp"
+#include "msg_hdr.hpp"
+#include "packet.hpp"
+#include "reassembler.hpp"
+#include "relay.hpp"
+#include "segmented.hpp"
+#include "util.hpp"
+
+#include "test_util.hpp"
+
+
+namespace test {
+
+namespace {
+
+std::vector<uint8_t> random_bytes(size_t len, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::vector<uint8_t> bytes(len);
+    for(uint8_t &byte : bytes)
+        byte = static_cast<uint8_t>(rng());
+    return bytes;
+}
+
+messenger::buff_opts_t crc32c_opts(bool compress = false) {
+    messenger::buff_opts_t opts;
+    opts.crc32c = true;
+    opts.compress = compress;
+    opts.compress_threshold = 0;
+    return opts;
+}
+
+// Flip bit of byte at pos and fix CRC4 of packet, which contains it: corruption CRC4 can not see
+void corrupt_past_crc4(std::vector<uint8_t> &buff, size_t pos) {
+    size_t packet = 0;
+    while(packet + messenger::detail::packet_size(buff.data() + packet) <= pos)
+        packet += messenger::detail::packet_size(buff.data() + packet);
+
+    buff[pos] ^= 0x10;
+
+    uint8_t *beg = buff.data() + packet;
+    messenger::detail::msg_hdr_mod_t(beg).set_crc4(
+        messenger::util::crc4_packet(beg, beg + messenger::detail::packet_size(beg)));
+}
+
+} // namespace
+
+/**
+ * crc32c Unit Tests
+*/
+
+TEST_CASE("crc32c: known values", "[crc32c][normal]") {
+    const char *check = "123456789";
+    const uint8_t *beg = reinterpret_cast<const uint8_t *>(check);
+
+    REQUIRE(messenger::util::crc32c(0, beg, beg + 9) == 0xe3069283);
+    REQUIRE(messenger::util::crc32c_sw(0, beg, beg + 9) == 0xe3069283);
+    REQUIRE(messenger::util::crc32c(0, beg, beg) == 0);
+
+    // iSCSI test vector: 32 zero bytes
+    std::vector<uint8_t> zeros(32, 0);
+    REQUIRE(messenger::util::crc32c(0, zeros.data(), zeros.data() + zeros.size()) == 0x8a9136aa);
+}
+
+TEST_CASE("crc32c: hardware & software agree at every length & split", "[crc32c][normal]") {
+    std::vector<uint8_t> bytes = random_bytes(300, 1);
+
+    for(size_t len = 0; len <= bytes.size(); len += 7) {
+        const uint8_t *beg = bytes.data() + len % 5;
+        const uint8_t *end = bytes.data() + len;
+        if(beg > end)
+            continue;
+
+        uint32_t whole = messenger::util::crc32c_sw(0, beg, end);
+        REQUIRE(messenger::util::crc32c(0, beg, end) == whole);
+
+        for(const uint8_t *split = beg; split <= end; split += 13) {
+            REQUIRE(messenger::util::crc32c(messenger::util::crc32c(0, beg, split), split, end) == whole);
+            REQUIRE(messenger::util::crc32c_sw(messenger::util::crc32c_sw(0, beg, split), split, end) == whole);
+        }
+    }
+}
+
+/**
+ * CRC32C packet Unit Tests
+*/
+
+TEST_CASE("make_buff: CRC32C round trip", "[crc32c][normal]") {
+    std::string text = util::repeat_string("checksummed text ", 40) + "!";
+    messenger::msg_t msg("Checked", text);
+
+    for(bool compress : {false, true}) {
+        std::vector<uint8_t> res = messenger::make_buff(msg, crc32c_opts(compress));
+
+        // CRC32C packet leads message, then same text packets follow as without CRC32C
+        messenger::detail::packet_view_t lead = messenger::detail::view_packet(res.data(), res.data() + res.size());
+        REQUIRE(lead.checksum());
+        REQUIRE(lead.msg_len() == messenger::detail::CRC32C_LEN);
+        REQUIRE(std::string(lead.name(), lead.name_len()) == "Checked");
+
+        messenger::buff_opts_t no_crc32c = crc32c_opts(compress);
+        no_crc32c.crc32c = false;
+        REQUIRE(std::vector<uint8_t>(res.begin() + lead.size(), res.end()) == messenger::make_buff(msg, no_crc32c));
+        REQUIRE(messenger::detail::packet_view_t(lead.end()).compressed() == compress);
+
+        REQUIRE(messenger::parse_buff(res).text == text);
+
+        std::vector<std::vector<uint8_t>> segments = {
+            std::vector<uint8_t>(res.begin(), res.begin() + 3),
+            std::vector<uint8_t>(res.begin() + 3, res.end())
+        };
+        REQUIRE(messenger::parse_segments(segments).text == text);
+    }
+}
+
+TEST_CASE("parse_buff: corruption missed by CRC4", "[crc32c][false]") {
+    messenger::msg_t msg("Name", util::repeat_string("payload ", 20));
+    std::vector<uint8_t> res = messenger::make_buff(msg, crc32c_opts());
+
+    SECTION("text byte") {
+        corrupt_past_crc4(res, res.size() - 1);
+        CHECK_THROWS_AS(messenger::parse_buff(res), std::runtime_error);
+    }
+
+    SECTION("carried CRC32C") {
+        size_t lead_size = messenger::detail::packet_size(res.data());
+        corrupt_past_crc4(res, lead_size - 1);
+        CHECK_THROWS_AS(messenger::parse_buff(res), std::runtime_error);
+    }
+
+    SECTION("without CRC32C corruption goes unnoticed") {
+        std::vector<uint8_t> plain = messenger::make_buff(msg);
+        corrupt_past_crc4(plain, plain.size() - 1);
+        REQUIRE(messenger::parse_buff(plain).text != msg.text);
+    }
+}
+
+TEST_CASE("parse_buff: misplaced CRC32C packet", "[crc32c][false]") {
+    std::vector<uint8_t> res = messenger::make_buff(messenger::msg_t("Name", "text"), crc32c_opts());
+    size_t lead_size = messenger::detail::packet_size(res.data());
+
+    SECTION("alone") {
+        res.resize(lead_size);
+        CHECK_THROWS_AS(messenger::parse_buff(res), std::runtime_error);
+    }
+
+    SECTION("after text") {
+        std::vector<uint8_t> swapped(res.begin() + lead_size, res.end());
+        swapped.insert(swapped.end(), res.begin(), res.begin() + lead_size);
+        CHECK_THROWS_AS(messenger::parse_buff(swapped), std::runtime_error);
+    }
+
+    SECTION("wrong size") {
+        messenger::detail::msg_hdr_mod_t hdr(res.data());
+        hdr.set_msg_len(messenger::detail::CRC32C_LEN - 1);
+        hdr.set_crc4(messenger::util::crc4_packet(res.data(), res.data() + lead_size - 1));
+        res.erase(res.begin() + lead_size - 1);
+        CHECK_THROWS_AS(messenger::parse_buff(res), std::runtime_error);
+    }
+}
+
+TEST_CASE("reassembler_t: CRC32C is checked before delivery", "[crc32c][normal]") {
+    std::vector<std::pair<std::string, std::string>> delivered;
+    messenger::reassembler_t reasm([&](std::string_view name, std::string_view text, messenger::reassembly_reason_t) {
+        delivered.emplace_back(std::string(name), std::string(text));
+    });
+
+    std::string long_text = util::repeat_string("long ", 30) + "!";
+    std::vector<uint8_t> stream;
+    messenger::append_buff(messenger::msg_t("A", long_text), stream, crc32c_opts());
+    messenger::append_buff(messenger::msg_t("B", "plain"), stream);
+    messenger::append_buff(messenger::msg_t("A", long_text), stream, crc32c_opts(true));
+    size_t corrupted_beg = stream.size();
+    messenger::append_buff(messenger::msg_t("C", long_text), stream, crc32c_opts());
+    corrupt_past_crc4(stream, corrupted_beg + 20);
+
+    // Byte by byte, so every packet is split across chunks
+    for(size_t i = 0; i < stream.size(); ++i)
+        reasm.feed(stream.data() + i, stream.data() + i + 1);
+
+    REQUIRE(delivered.size() == 3);
+    REQUIRE(delivered[0] == std::make_pair(std::string("A"), long_text));
+    REQUIRE(delivered[1] == std::make_pair(std::string("B"), std::string("plain")));
+    REQUIRE(delivered[2] == std::make_pair(std::string("A"), long_text));
+    REQUIRE(reasm.stats().crc32c_failed == 1);
+    REQUIRE(reasm.stats().dropped == 0);
+
+    SECTION("partial message is not delivered") {
+        std::vector<uint8_t> res = messenger::make_buff(messenger::msg_t("D", long_text), crc32c_opts());
+        size_t lead_size = messenger::detail::packet_size(res.data());
+        reasm.feed(res.data(), res.data() + lead_size + messenger::detail::packet_size(res.data() + lead_size));
+        reasm.flush();
+
+        REQUIRE(delivered.size() == 3);
+        REQUIRE(reasm.stats().crc32c_failed == 2);
+    }
+
+    SECTION("message of full packets is checked on flush") {
+        std::string full_text = util::repeat_string("x", 2 * MSGR_MSG_LEN_MAX);
+        std::vector<uint8_t> res = messenger::make_buff(messenger::msg_t("E", full_text), crc32c_opts());
+        reasm.feed(res.data(), res.data() + res.size());
+        reasm.flush();
+
+        REQUIRE(delivered.size() == 4);
+        REQUIRE(delivered[3].second == full_text);
+    }
+}
+
+TEST_CASE("relay_t: renaming keeps CRC32C valid", "[crc32c][normal]") {
+    std::string text = util::repeat_string("relayed ", 10) + "!";
+    std::vector<uint8_t> res = messenger::make_buff(messenger::msg_t("Alice", text), crc32c_opts());
+
+    messenger::relay_t relay;
+    relay.add_rename("Alice", "Bob");
+
+    std::vector<uint8_t> out;
+    relay.forward(res.data(), res.data() + res.size(), out);
+
+    messenger::msg_t parsed = messenger::parse_buff(out);
+    REQUIRE(parsed.name == "Bob");
+    REQUIRE(parsed.text == text);
+}
+
+} // namespace test
@@ -0,0 +1,155 @@
+#include <catch2/catch_all.hpp>
+
+#include <atomic>
+#include <thread>
+
+#include "encode_cache.hpp"
+#include "messenger.hpp"
+
+#include "alloc_counter.hpp"
+#include "test_util.hpp"
+
+
+namespace test {
+
+/**
+ * encode_cache_t Unit Tests
+*/
+
+TEST_CASE("encode_cache_t: returns same buffers as make_buff", "[encode_cache_t][normal]") {
+    std::vector<messenger::msg_t> msgs = {
+        messenger::msg_t("Node1", "status: OK"),
+        messenger::msg_t("Node2", "status: OK"),
+        messenger::msg_t("Node1", "status: DEGRADED"),
+        messenger::msg_t("Node", "1status: OK"),
+        messenger::msg_t("Heartbeat", util::repeat_string("beat ", 40))
+    };
+
+    for(bool crc32c : {false, true}) {
+        messenger::encode_cache_config_t config;
+        config.encoding.crc32c = crc32c;
+        messenger::encode_cache_t cache(config);
+
+        for(size_t round = 0; round < 3; ++round) {
+            for(const messenger::msg_t &msg : msgs) {
+                messenger::encode_cache_t::buff_ptr_t buff = cache.encode(msg);
+                REQUIRE(*buff == messenger::make_buff(msg, config.encoding));
+            }
+        }
+
+        messenger::encode_cache_stats_t stats = cache.stats();
+        REQUIRE(stats.misses == msgs.size());
+        REQUIRE(stats.hits == 2 * msgs.size());
+        REQUIRE(stats.entries == msgs.size());
+        REQUIRE(stats.evicted == 0);
+        REQUIRE(stats.hit_rate() > 0.66);
+        REQUIRE(stats.hit_rate() < 0.67);
+
+        // Hit shares buffer of first encode
+        REQUIRE(cache.encode(msgs[0]) == cache.encode(msgs[0]));
+
+        cache.clear();
+        REQUIRE(cache.stats().entries == 0);
+        REQUIRE(cache.stats().bytes == 0);
+        REQUIRE(*cache.encode(msgs[1]) == messenger::make_buff(msgs[1], config.encoding));
+    }
+}
+
+TEST_CASE("encode_cache_t: evicts least recently used messages", "[encode_cache_t][normal]") {
+    messenger::encode_cache_config_t config;
+    config.shards = 1;
+    config.max_bytes = 4096;
+    messenger::encode_cache_t cache(config);
+
+    messenger::msg_t hot("Hot", "keep me");
+    messenger::encode_cache_t::buff_ptr_t held = cache.encode(hot);
+
+    for(size_t i = 0; i < 1000; ++i) {
+        cache.encode(messenger::msg_t("Cold", "message " + std::to_string(i)));
+        cache.encode(hot);
+        REQUIRE(cache.stats().bytes <= config.max_bytes);
+    }
+
+    messenger::encode_cache_stats_t stats = cache.stats();
+    REQUIRE(stats.evicted > 0);
+    REQUIRE(stats.entries + stats.evicted == 1001);
+    REQUIRE(stats.hits == 1000);
+    REQUIRE(cache.encode(hot) == held);
+
+    // Evicted buffer stays valid for its holder
+    messenger::encode_cache_t::buff_ptr_t cold = cache.encode(messenger::msg_t("Cold", "message 0"));
+    REQUIRE(cache.stats().misses == 1002);
+    cache.clear();
+    REQUIRE(messenger::parse_buff(cold->data(), cold->data() + cold->size()).text == "message 0");
+}
+
+TEST_CASE("encode_cache_t: hit performs 0 allocations", "[encode_cache_t][normal]") {
+    messenger::encode_cache_t cache;
+    messenger::msg_t msg("Heartbeat", util::repeat_string("alive ", 30));
+    cache.encode(msg);
+
+    size_t bytes = 0;
+    alloc::counts_t counts = alloc::count([&]() {
+        for(int i = 0; i < 100; ++i)
+            bytes += cache.encode(msg)->size();
+    });
+
+    REQUIRE(counts.num == 0);
+    REQUIRE(bytes == 100 * messenger::buff_size(msg));
+}
+
+TEST_CASE("encode_cache_t: concurrent encodes", "[encode_cache_t][normal]") {
+    const size_t THREADS = 4;
+    const size_t ROUNDS = 2000;
+    messenger::encode_cache_config_t config;
+    config.shards = 4;
+    messenger::encode_cache_t cache(config);
+
+    std::vector<messenger::msg_t> msgs;
+    std::vector<std::vector<uint8_t>> expected;
+    for(size_t i = 0; i < 50; ++i) {
+        msgs.emplace_back("Node" + std::to_string(i % 7), "status " + std::to_string(i));
+        expected.push_back(messenger::make_buff(msgs.back()));
+    }
+
+    std::atomic<size_t> mismatches(0);
+    std::vector<std::thread> threads;
+    for(size_t t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&, t]() {
+            for(size_t i = 0; i < ROUNDS; ++i) {
+                size_t idx = (i * 7 + t) % msgs.size();
+                if(*cache.encode(msgs[idx]) != expected[idx])
+                    mismatches++;
+            }
+        });
+    }
+    for(std::thread &thread : threads)
+        thread.join();
+
+    REQUIRE(mismatches == 0);
+    messenger::encode_cache_stats_t stats = cache.stats();
+    REQUIRE(stats.hits + stats.misses == THREADS * ROUNDS);
+    REQUIRE(stats.entries == msgs.size());
+}
+
+TEST_CASE("encode_cache_t: invalid usage", "[encode_cache_t][false]") {
+    messenger::encode_cache_config_t config;
+    config.shards = 0;
+    CHECK_THROWS_AS(messenger::encode_cache_t(config), std::invalid_argument);
+
+    // Invalid messages are not cached
+    messenger::encode_cache_t cache;
+    CHECK_THROWS_AS(cache.encode(messenger::msg_t("", "text")), std::length_error);
+    CHECK_THROWS_AS(cache.encode(messenger::msg_t(util::repeat_string("n", 16), "text")), std::length_error);
+    REQUIRE(cache.stats().entries == 0);
+
+    // Message over shard's budget is encoded, but not cached
+    config.shards = 1;
+    config.max_bytes = 256;
+    messenger::encode_cache_t small(config);
+    messenger::msg_t big("Big", util::repeat_string("x", 500));
+    REQUIRE(*small.encode(big) == messenger::make_buff(big));
+    REQUIRE(small.stats().entries == 0);
+}
+
+} // namespace test
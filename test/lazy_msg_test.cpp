@@ -0,0 +1,139 @@
+#include <catch2/catch_all.hpp>
+
+#include "batch.hpp"
+#include "lazy_msg.hpp"
+#include "messenger.hpp"
+
+#include "alloc_counter.hpp"
+#include "test_util.hpp"
+
+
+namespace test {
+
+namespace {
+
+messenger::lazy_msg_t::buff_ptr_t share(std::vector<uint8_t> buff) {
+    return std::make_shared<const std::vector<uint8_t>>(std::move(buff));
+}
+
+} // namespace
+
+/**
+ * lazy_msg_t Unit Tests
+*/
+
+TEST_CASE("lazy_msg_t: name is available, text is assembled on access", "[lazy_msg_t][normal]") {
+    std::vector<messenger::msg_t> msgs = {
+        messenger::msg_t("Router", "x"),
+        messenger::msg_t("Router", util::repeat_string("y", 31)),
+        messenger::msg_t(util::repeat_string("N", 15), util::repeat_string("long text ", 40)),
+        messenger::msg_t("Zip", util::repeat_string("compressible ", 40))
+    };
+
+    for(bool compress : {false, true}) {
+        for(bool crc32c : {false, true}) {
+            messenger::buff_opts_t opts;
+            opts.compress = compress;
+            opts.compress_threshold = 0;
+            opts.crc32c = crc32c;
+
+            for(const messenger::msg_t &msg : msgs) {
+                messenger::lazy_msg_t::buff_ptr_t buff = share(messenger::make_buff(msg, opts));
+                messenger::lazy_msg_t lazy(buff);
+
+                REQUIRE(lazy.name() == msg.name);
+                REQUIRE(!lazy.assembled());
+                REQUIRE(std::equal(lazy.begin(), lazy.end(), buff->begin(), buff->end()));
+                if(!lazy.compressed())
+                    REQUIRE(lazy.payload_size() == msg.text.size());
+
+                // Pieces come straight from packets
+                std::string streamed;
+                size_t pieces = 0;
+                lazy.stream_text([&](std::string_view piece) {
+                    streamed.append(piece);
+                    pieces++;
+                });
+                REQUIRE(streamed == msg.text);
+                if(!lazy.compressed()) {
+                    REQUIRE(!lazy.assembled());
+                    REQUIRE(pieces == (msg.text.size() + MSGR_MSG_LEN_MAX - 1) / MSGR_MSG_LEN_MAX);
+                }
+
+                REQUIRE(lazy.text() == msg.text);
+                REQUIRE(lazy.assembled());
+                REQUIRE(&lazy.text() == &lazy.text());
+                REQUIRE(lazy.msg().name == msg.name);
+            }
+        }
+    }
+}
+
+TEST_CASE("lazy_msg_t: messages of shared batch", "[lazy_msg_t][normal]") {
+    std::vector<messenger::msg_t> msgs;
+    for(int i = 0; i < 50; ++i)
+        msgs.push_back(messenger::msg_t("S" + std::to_string(i % 7), util::repeat_string("text ", i) + "!"));
+
+    messenger::msg_batch_t batch = messenger::make_buff_batch(msgs);
+    messenger::lazy_msg_t::buff_ptr_t buff = share(batch.buff);
+
+    std::vector<messenger::lazy_msg_t> lazy;
+    for(size_t i = 0; i < batch.size(); ++i)
+        lazy.emplace_back(buff, batch.offsets[i], batch.offsets[i + 1]);
+
+    // Handles keep buffer alive
+    buff.reset();
+    batch = messenger::msg_batch_t();
+
+    for(size_t i = 0; i < msgs.size(); ++i) {
+        REQUIRE(lazy[i].name() == msgs[i].name);
+        REQUIRE(lazy[i].text() == msgs[i].text);
+    }
+}
+
+TEST_CASE("lazy_msg_t: routing on name performs 0 allocations", "[lazy_msg_t][normal]") {
+    messenger::msg_t msg("Sender", util::repeat_string("hot path text ", 14) + "!");
+    messenger::lazy_msg_t::buff_ptr_t buff = share(messenger::make_buff(msg));
+
+    size_t routed = 0;
+    size_t text_bytes = 0;
+    alloc::counts_t counts = alloc::count([&]() {
+        for(int i = 0; i < 100; ++i) {
+            messenger::lazy_msg_t lazy(buff);
+            routed += lazy.name() == "Sender";
+            lazy.stream_text([&](std::string_view piece) { text_bytes += piece.size(); });
+        }
+    });
+
+    REQUIRE(counts.num == 0);
+    REQUIRE(routed == 100);
+    REQUIRE(text_bytes == 100 * msg.text.size());
+}
+
+TEST_CASE("lazy_msg_t: invalid messages", "[lazy_msg_t][false]") {
+    messenger::buff_opts_t opts;
+    opts.crc32c = true;
+    std::vector<uint8_t> buff = messenger::make_buff(messenger::msg_t("Name", util::repeat_string("t", 40)), opts);
+
+    // CRC4
+    std::vector<uint8_t> bad_crc4 = buff;
+    bad_crc4[20] ^= 0x01;
+    CHECK_THROWS_AS(messenger::lazy_msg_t(share(bad_crc4)), std::runtime_error);
+
+    CHECK_THROWS_AS(messenger::lazy_msg_t(nullptr), std::out_of_range);
+    CHECK_THROWS_AS(messenger::lazy_msg_t(share(buff), 0, buff.size() + 1), std::out_of_range);
+    CHECK_THROWS_AS(messenger::lazy_msg_t(share(buff), 2, 1), std::out_of_range);
+    CHECK_THROWS_AS(messenger::lazy_msg_t(share(std::vector<uint8_t>())), std::runtime_error);
+
+    // Framing
+    CHECK_THROWS_AS(messenger::lazy_msg_t(share(buff), 0, buff.size() - 1), std::runtime_error);
+
+    // CRC32C packet without text
+    size_t lead_size = messenger::detail::HEADER_SIZE + 4 + 4;
+    CHECK_THROWS_AS(messenger::lazy_msg_t(share(buff), 0, lead_size), std::runtime_error);
+
+    messenger::lazy_msg_t empty;
+    REQUIRE(empty.empty());
+}
+
+} // namespace test
@@ -106,6 +106,39 @@ TEST_CASE("make_buf: empty msg", "[make_buf][false]") {
 }
 
 
+// Exact-size encoding
+TEST_CASE("buff_size & append_buff: exact size of make_buf output", "[make_buf][append_buf][normal]") {
+    const std::string name = "Name";
+
+    SECTION("various text lengths") {
+        for(size_t text_len : {1, 30, 31, 32, 62, 63, 100}) {
+            messenger::msg_t msg(name, std::string(text_len, 'a'));
+            REQUIRE(messenger::buff_size(msg) == messenger::make_buff(msg).size());
+        }
+    }
+
+    SECTION("append after existing content") {
+        messenger::msg_t msg(name, "Lorem ipsum kekus maximus nothing more to say");
+        std::vector<uint8_t> out = {0x1, 0x2};
+        std::vector<uint8_t> expected = out;
+        std::vector<uint8_t> buf = messenger::make_buff(msg);
+        expected.insert(expected.end(), buf.begin(), buf.end());
+
+        REQUIRE_NOTHROW(messenger::append_buff(msg, out));
+        REQUIRE_THAT(out, Catch::Matchers::RangeEquals(expected));
+    }
+
+    SECTION("invalid message leaves output untouched") {
+        messenger::msg_t msg("", "Lorem ipsum");
+        std::vector<uint8_t> out = {0x1, 0x2};
+
+        CHECK_THROWS_AS(messenger::buff_size(msg), std::length_error);
+        CHECK_THROWS_AS(messenger::append_buff(msg, out), std::length_error);
+        REQUIRE(out.size() == 2);
+    }
+}
+
+
 /**
  * parse_buf Unit Tests
 */
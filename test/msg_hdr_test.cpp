@@ -87,4 +87,31 @@ TEST_CASE("msg_hdr_mod_t: hardcoded check of setters", "[msg_hdr_mod_t][normal]"
     REQUIRE_THAT(header, Catch::Matchers::RangeEquals(hardcoded_header));
 }
 
-} // namespace test
\ No newline at end of file
+
+/**
+ * hdr_table Unit Tests
+*/
+
+TEST_CASE("hdr_table: matches msg_hdr_view_t for every header", "[hdr_table][normal]") {
+    for(size_t hdr = 0; hdr < messenger::detail::HDR_TABLE_SIZE; ++hdr) {
+        std::array<uint8_t, messenger::detail::HEADER_SIZE> header = {
+            static_cast<uint8_t>(hdr & 0xff), static_cast<uint8_t>(hdr >> 8)
+        };
+        messenger::detail::msg_hdr_view_t hdr_view(header.data());
+        const messenger::detail::hdr_info_t &info = messenger::detail::hdr_info(header.data());
+
+        const bool flag_ok = hdr_view.get_flag() == FLAG_BITS || hdr_view.get_flag() == COMPRESSED_FLAG_BITS
+            || hdr_view.get_flag() == CRC32C_FLAG_BITS;
+        REQUIRE(info.flag_ok() == flag_ok);
+        REQUIRE(info.compressed() == (hdr_view.get_flag() == COMPRESSED_FLAG_BITS));
+        REQUIRE(info.checksum() == (hdr_view.get_flag() == CRC32C_FLAG_BITS));
+        REQUIRE(info.valid() == (flag_ok && hdr_view.get_name_len() != 0 && hdr_view.get_msg_len() != 0));
+        REQUIRE(info.name_len() == hdr_view.get_name_len());
+        REQUIRE(info.msg_len() == hdr_view.get_msg_len());
+        REQUIRE(info.size() == messenger::detail::HEADER_SIZE + hdr_view.get_name_len() + hdr_view.get_msg_len());
+        REQUIRE(info.crc4() == hdr_view.get_crc4());
+        REQUIRE(info.crc4_state() == hdr_view.calculate_crc4());
+    }
+}
+
+} // namespace test
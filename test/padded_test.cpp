@@ -0,0 +1,190 @@
+#include <catch2/catch_all.hpp>
+
+#include "messenger.hpp"
+#include "msg_hdr.hpp"
+#include "padded.hpp"
+
+#include "alloc_counter.hpp"
+#include "test_util.hpp"
+
+
+namespace test {
+
+namespace {
+
+// Every name length, texts around packet & padding boundaries
+std::vector<messenger::msg_t> boundary_msgs() {
+    std::vector<messenger::msg_t> res;
+    for(size_t name_len = 1; name_len <= MSGR_NAME_LEN_MAX; ++name_len) {
+        for(size_t text_len : {1, 2, 15, 16, 30, 31, 32, 33, 62, 63, 64, 65, 200}) {
+            std::string text;
+            for(size_t i = 0; i < text_len; ++i)
+                text.push_back(static_cast<char>('a' + (i + name_len) % 26));
+            res.push_back(messenger::msg_t(util::repeat_string("N", name_len), text));
+        }
+    }
+    return res;
+}
+
+} // namespace
+
+/**
+ * util::padded_buffer_t Unit Tests
+*/
+
+TEST_CASE("util::padded_buffer_t: aligned storage with slack", "[padded][normal]") {
+    messenger::util::padded_buffer_t buff;
+    REQUIRE(buff.empty());
+
+    std::vector<uint8_t> expected;
+    for(size_t i = 0; i < 1000; ++i) {
+        uint8_t byte = static_cast<uint8_t>(i * 7);
+        buff.append(&byte, &byte + 1);
+        expected.push_back(byte);
+
+        REQUIRE(reinterpret_cast<uintptr_t>(buff.data()) % messenger::util::padded_buffer_t::ALIGNMENT == 0);
+        REQUIRE(buff.capacity() >= buff.size());
+    }
+    REQUIRE(std::vector<uint8_t>(buff.begin(), buff.end()) == expected);
+
+    // Slack is accessible past size
+    buff.resize(buff.capacity());
+    messenger::util::copy32(buff.end(), buff.begin());
+
+    messenger::util::padded_buffer_t copy = buff;
+    REQUIRE(std::equal(copy.begin(), copy.end(), buff.begin(), buff.end()));
+    copy = messenger::util::padded_buffer_t(expected.data(), expected.data() + 3);
+    REQUIRE(copy.size() == 3);
+    REQUIRE(copy.data()[2] == expected[2]);
+
+    buff.clear();
+    REQUIRE(buff.empty());
+}
+
+TEST_CASE("util::padded_buffer_t: moved-from buffer is reusable", "[padded][normal]") {
+    const uint8_t bytes[5] = {1, 2, 3, 4, 5};
+    messenger::util::padded_buffer_t buff(bytes, bytes + 5);
+
+    messenger::util::padded_buffer_t moved(std::move(buff));
+    REQUIRE(moved.size() == 5);
+    REQUIRE(buff.empty());
+    REQUIRE(buff.capacity() == 0);
+
+    buff.clear();
+    buff.append(bytes, bytes + 5);
+    REQUIRE(std::equal(buff.begin(), buff.end(), bytes, bytes + 5));
+
+    messenger::util::padded_buffer_t assigned;
+    assigned = std::move(buff);
+    REQUIRE(assigned.size() == 5);
+    REQUIRE(buff.capacity() == 0);
+
+    buff.resize(3);
+    REQUIRE(buff.size() == 3);
+    REQUIRE(reinterpret_cast<uintptr_t>(buff.data()) % messenger::util::padded_buffer_t::ALIGNMENT == 0);
+}
+
+/**
+ * Padded encode & decode Unit Tests
+*/
+
+TEST_CASE("append_buff: padded output equals append_buff", "[padded][normal]") {
+    std::vector<messenger::msg_t> msgs = boundary_msgs();
+    msgs.push_back(messenger::msg_t("Compressible", util::repeat_string("ab", 200)));
+
+    for(bool compress : {false, true}) {
+        for(bool crc32c : {false, true}) {
+            messenger::buff_opts_t opts;
+            opts.compress = compress;
+            opts.compress_threshold = 0;
+            opts.crc32c = crc32c;
+
+            messenger::util::padded_buffer_t padded;
+            std::vector<uint8_t> expected;
+            for(const messenger::msg_t &msg : msgs) {
+                messenger::append_buff(msg, padded, opts);
+                messenger::append_buff(msg, expected, opts);
+                REQUIRE(padded.size() == expected.size());
+            }
+            REQUIRE(std::equal(padded.begin(), padded.end(), expected.begin(), expected.end()));
+        }
+    }
+
+    // Raw output: bytes past buffer are clobbered, buffer itself is exact
+    for(const messenger::msg_t &msg : msgs) {
+        std::vector<uint8_t> out(messenger::buff_size(msg) + messenger::util::PADDING);
+        uint8_t *end = messenger::write_buff_padded(msg, out.data());
+        REQUIRE(end == out.data() + messenger::buff_size(msg));
+        REQUIRE(std::equal(out.data(), end, messenger::make_buff(msg).begin()));
+    }
+}
+
+TEST_CASE("parse_buff: padded input round trip", "[padded][normal]") {
+    std::vector<messenger::msg_t> msgs = boundary_msgs();
+
+    messenger::buff_opts_t opts;
+    opts.compress = true;
+    opts.compress_threshold = 100;
+    opts.crc32c = true;
+
+    // Reused target shrinks & grows between messages
+    messenger::msg_t target;
+    for(const messenger::msg_t &msg : msgs) {
+        for(const messenger::buff_opts_t &encoding : {messenger::buff_opts_t(), opts}) {
+            messenger::util::padded_buffer_t buff;
+            messenger::append_buff(msg, buff, encoding);
+
+            messenger::parse_buff(buff, target);
+            REQUIRE(target.name == msg.name);
+            REQUIRE(target.text == msg.text);
+        }
+    }
+}
+
+TEST_CASE("parse_buff: padded decoding into reused target performs 0 allocations", "[padded][normal]") {
+    messenger::msg_t msg("Sender", util::repeat_string("hot path text ", 14) + "!");
+    messenger::util::padded_buffer_t buff;
+    messenger::append_buff(msg, buff);
+
+    messenger::msg_t target;
+    messenger::parse_buff(buff, target);
+
+    alloc::counts_t counts = alloc::count([&]() {
+        for(int i = 0; i < 100; ++i) {
+            buff.clear();
+            messenger::append_buff(msg, buff);
+            messenger::parse_buff(buff, target);
+        }
+    });
+
+    REQUIRE(counts.num == 0);
+    REQUIRE(target.text == msg.text);
+}
+
+TEST_CASE("parse_buff: padded input with invalid packets", "[padded][false]") {
+    messenger::msg_t msg("Name", util::repeat_string("t", 40));
+    messenger::util::padded_buffer_t buff;
+    messenger::append_buff(msg, buff);
+
+    messenger::msg_t target("Old", "old text");
+
+    messenger::util::padded_buffer_t corrupted = buff;
+    corrupted.data()[corrupted.size() - 1] ^= 0x01;
+    CHECK_THROWS_AS(messenger::parse_buff(corrupted, target), std::runtime_error);
+
+    messenger::util::padded_buffer_t truncated(buff.begin(), buff.end() - 1);
+    CHECK_THROWS_AS(messenger::parse_buff(truncated, target), std::runtime_error);
+
+    messenger::util::padded_buffer_t empty;
+    CHECK_THROWS_AS(messenger::parse_buff(empty, target), std::runtime_error);
+
+    messenger::util::padded_buffer_t out;
+    CHECK_THROWS_AS(messenger::append_buff(messenger::msg_t("Name", ""), out), std::length_error);
+    REQUIRE(out.empty());
+
+    // Decoder is usable after failures
+    messenger::parse_buff(buff, target);
+    REQUIRE(target.text == msg.text);
+}
+
+} // namespace test
@@ -0,0 +1,237 @@
+#include <catch2/catch_all.hpp>
+
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "messenger.hpp"
+#include "msg_hdr.hpp"
+#include "pipeline.hpp"
+#include "queue.hpp"
+#include "reassembler.hpp"
+#include "util.hpp"
+#include "workload.hpp"
+
+#include "test_util.hpp"
+
+
+namespace test {
+
+namespace {
+
+using texts_t = std::map<std::string, std::vector<std::string>>;
+
+/**
+ * Thread-safe collector of delivered messages, by sender
+*/
+struct collector_t {
+    std::mutex mutex;
+    texts_t texts;
+
+    messenger::reassembler_t::deliver_t deliver() {
+        return [this](std::string_view name, std::string_view text, messenger::reassembly_reason_t) {
+            std::lock_guard<std::mutex> lock(mutex);
+            texts[std::string(name)].emplace_back(text);
+        };
+    }
+};
+
+// Messages of stream, decoded by single reassembler_t
+texts_t reference(const std::vector<uint8_t> &stream) {
+    texts_t texts;
+    messenger::reassembler_t reasm([&](std::string_view name, std::string_view text, messenger::reassembly_reason_t) {
+        texts[std::string(name)].emplace_back(text);
+    });
+    reasm.feed(stream.data(), stream.data() + stream.size());
+    reasm.flush();
+
+    return texts;
+}
+
+// Feed stream in chunks of odd size, so packets are split across chunks
+void feed_chunked(messenger::pipeline_t &pipeline, const std::vector<uint8_t> &stream, size_t chunk) {
+    for(size_t pos = 0; pos < stream.size(); pos += chunk)
+        pipeline.feed(stream.data() + pos, stream.data() + std::min(pos + chunk, stream.size()));
+}
+
+} // namespace
+
+/**
+ * spsc_queue_t Unit Tests
+*/
+
+TEST_CASE("spsc_queue_t: bounded FIFO", "[spsc_queue_t][normal]") {
+    messenger::util::spsc_queue_t<int> queue(5);
+    REQUIRE(queue.capacity() == 8);
+    REQUIRE(queue.empty());
+
+    int val = 0;
+    REQUIRE_FALSE(queue.pop(val));
+
+    for(int i = 0; i < 8; ++i) {
+        int item = i;
+        REQUIRE(queue.push(item));
+    }
+    int extra = 100;
+    REQUIRE_FALSE(queue.push(extra));
+    REQUIRE(extra == 100);
+
+    for(int i = 0; i < 8; ++i) {
+        REQUIRE(queue.pop(val));
+        REQUIRE(val == i);
+    }
+    REQUIRE(queue.empty());
+
+    CHECK_THROWS_AS(messenger::util::spsc_queue_t<int>(0), std::invalid_argument);
+}
+
+TEST_CASE("spsc_queue_t: threads keep order across wrap-around", "[spsc_queue_t][normal]") {
+    const size_t ITEMS = 100000;
+    messenger::util::spsc_queue_t<size_t> queue(64);
+
+    std::thread producer([&]() {
+        for(size_t i = 0; i < ITEMS; ++i) {
+            size_t item = i;
+            while(!queue.push(item))
+                std::this_thread::yield();
+        }
+    });
+
+    size_t in_order = 0;
+    size_t val;
+    for(size_t i = 0; i < ITEMS; ++i) {
+        while(!queue.pop(val))
+            std::this_thread::yield();
+        in_order += val == i;
+    }
+    producer.join();
+
+    REQUIRE(in_order == ITEMS);
+}
+
+/**
+ * pipeline_t Unit Tests
+*/
+
+TEST_CASE("pipeline_t: keeps order of every sender's messages", "[pipeline_t][normal]") {
+    messenger::workload::config_t workload;
+    workload.senders = 50;
+    workload.msgs = 5000;
+    workload.interleave = 8;
+    messenger::workload::traffic_t traffic = messenger::workload::generate_traffic(workload);
+    texts_t expected = reference(traffic.stream);
+
+    for(size_t workers : {1, 3}) {
+        for(bool steal : {false, true}) {
+            collector_t collector;
+            messenger::pipeline_config_t config;
+            config.workers = workers;
+            config.batch_bytes = 512;
+            config.queue_batches = 4;
+            config.steal = steal;
+
+            messenger::pipeline_t pipeline(collector.deliver(), config);
+            REQUIRE(pipeline.shards() == workers * config.shards_per_worker);
+
+            feed_chunked(pipeline, traffic.stream, 1000 + 7 * workers);
+            pipeline.flush();
+
+            messenger::pipeline_stats_t stats = pipeline.stats();
+            REQUIRE(stats.reassembly.msgs == workload.msgs);
+            REQUIRE(stats.reassembly.packets == traffic.packets);
+            REQUIRE(stats.batches > 0);
+            if(!steal)
+                REQUIRE(stats.stolen == 0);
+
+            std::lock_guard<std::mutex> lock(collector.mutex);
+            REQUIRE(collector.texts == expected);
+        }
+    }
+}
+
+TEST_CASE("pipeline_t: skewed senders", "[pipeline_t][normal]") {
+    // Few senders carry almost all traffic
+    std::vector<uint8_t> stream;
+    std::vector<std::string> hot = {"Hot0", "Hot1", "Hot2"};
+    for(size_t i = 0; i < 3000; ++i) {
+        std::string name = i % 10 == 9 ? "Cold" + std::to_string(i % 7) : hot[i % hot.size()];
+        messenger::append_buff(messenger::msg_t(name, std::to_string(i) + util::repeat_string(".", i % 100)), stream);
+    }
+    texts_t expected = reference(stream);
+    size_t expected_msgs = 0;
+    for(const auto &sender : expected)
+        expected_msgs += sender.second.size();
+
+    collector_t collector;
+    messenger::pipeline_config_t config;
+    config.workers = 4;
+    config.shards_per_worker = 2;
+    config.batch_bytes = 256;
+
+    {
+        messenger::pipeline_t pipeline(collector.deliver(), config);
+        feed_chunked(pipeline, stream, 4096);
+        pipeline.flush();
+
+        REQUIRE(pipeline.stats().reassembly.msgs == expected_msgs);
+    }
+
+    REQUIRE(collector.texts == expected);
+}
+
+TEST_CASE("pipeline_t: shards check CRC & flush partial messages", "[pipeline_t][normal]") {
+    messenger::buff_opts_t opts;
+    opts.crc32c = true;
+
+    std::string full_text = util::repeat_string("x", 2 * MSGR_MSG_LEN_MAX);
+    std::vector<uint8_t> stream;
+    messenger::append_buff(messenger::msg_t("Good", "intact text"), stream, opts);
+    size_t corrupted_beg = stream.size();
+    messenger::append_buff(messenger::msg_t("Bad", "text to corrupt"), stream, opts);
+    messenger::append_buff(messenger::msg_t("Full", full_text), stream);
+
+    // Flip text bit of CRC32C checked message together with its CRC4: only CRC32C notices
+    size_t text_packet = corrupted_beg + messenger::detail::packet_size(stream.data() + corrupted_beg);
+    uint8_t *packet = stream.data() + text_packet;
+    packet[messenger::detail::packet_size(packet) - 1] ^= 0x01;
+    messenger::detail::msg_hdr_mod_t(packet).set_crc4(
+        messenger::util::crc4_packet(packet, packet + messenger::detail::packet_size(packet)));
+
+    collector_t collector;
+    messenger::pipeline_t pipeline(collector.deliver());
+    pipeline.feed(stream.data(), stream.data() + stream.size());
+    pipeline.drain();
+
+    {
+        std::lock_guard<std::mutex> lock(collector.mutex);
+        REQUIRE(collector.texts.size() == 1);
+        REQUIRE(collector.texts["Good"] == std::vector<std::string>{"intact text"});
+    }
+
+    pipeline.flush();
+
+    messenger::pipeline_stats_t stats = pipeline.stats();
+    REQUIRE(stats.reassembly.crc32c_failed == 1);
+    REQUIRE(stats.reassembly.senders == 0);
+
+    std::lock_guard<std::mutex> lock(collector.mutex);
+    REQUIRE(collector.texts["Full"] == std::vector<std::string>{full_text});
+}
+
+TEST_CASE("pipeline_t: invalid stream & configuration", "[pipeline_t][false]") {
+    collector_t collector;
+
+    messenger::pipeline_config_t config;
+    config.workers = 0;
+    CHECK_THROWS_AS(messenger::pipeline_t(collector.deliver(), config), std::invalid_argument);
+
+    config = messenger::pipeline_config_t();
+    config.queue_batches = 0;
+    CHECK_THROWS_AS(messenger::pipeline_t(collector.deliver(), config), std::invalid_argument);
+
+    messenger::pipeline_t pipeline(collector.deliver());
+    std::vector<uint8_t> bad = {0x00, 0x00, 0x00, 0x00};
+    CHECK_THROWS_AS(pipeline.feed(bad.data(), bad.data() + bad.size()), std::runtime_error);
+}
+
+} // namespace test
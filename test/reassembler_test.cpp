@@ -0,0 +1,237 @@
+#include <catch2/catch_all.hpp>
+
+#include <map>
+
+#include "messenger.hpp"
+#include "reassembler.hpp"
+
+#include "test_util.hpp"
+
+
+namespace test {
+
+namespace {
+
+struct delivered_t {
+    std::string name;
+    std::string text;
+    messenger::reassembly_reason_t reason;
+};
+
+// Interleave packets of encoded messages round-robin
+std::vector<uint8_t> interleave(const std::vector<messenger::msg_t> &msgs) {
+    std::vector<std::vector<uint8_t>> bufs;
+    for(const messenger::msg_t &msg : msgs)
+        bufs.push_back(messenger::make_buff(msg));
+
+    std::vector<size_t> pos(bufs.size(), 0);
+    std::vector<uint8_t> out;
+    for(bool done = false; !done; ) {
+        done = true;
+        for(size_t i = 0; i < bufs.size(); ++i) {
+            if(pos[i] == bufs[i].size())
+                continue;
+
+            size_t packet_size = messenger::detail::packet_size(bufs[i].data() + pos[i]);
+            out.insert(out.end(), bufs[i].begin() + pos[i], bufs[i].begin() + pos[i] + packet_size);
+            pos[i] += packet_size;
+            done = false;
+        }
+    }
+
+    return out;
+}
+
+} // namespace
+
+/**
+ * reassembler_t Unit Tests
+*/
+
+TEST_CASE("reassembler_t: interleaved senders fed in small chunks", "[reassembler_t][normal]") {
+    std::vector<messenger::msg_t> msgs = {
+        messenger::msg_t("Alice", util::repeat_string("alice ", 20)),
+        messenger::msg_t("Bob", "short"),
+        messenger::msg_t("Carol", util::repeat_string("carol_", 11)),
+    };
+    std::vector<uint8_t> stream = interleave(msgs);
+
+    for(size_t chunk_size : {1, 2, 5, 47, 1000}) {
+        std::vector<delivered_t> delivered;
+        messenger::reassembler_t reasm([&](std::string_view name, std::string_view text, messenger::reassembly_reason_t reason) {
+            delivered.push_back(delivered_t{std::string(name), std::string(text), reason});
+        });
+
+        for(size_t pos = 0; pos < stream.size(); pos += chunk_size) {
+            const uint8_t *chunk = stream.data() + pos;
+            reasm.feed(chunk, chunk + std::min(chunk_size, stream.size() - pos));
+        }
+
+        REQUIRE(delivered.size() == msgs.size());
+        // Completion order follows last packets
+        REQUIRE(delivered[0].name == "Bob");
+        REQUIRE(delivered[1].name == "Carol");
+        REQUIRE(delivered[2].name == "Alice");
+
+        for(const delivered_t &d : delivered) {
+            const messenger::msg_t &msg = d.name == "Alice" ? msgs[0] : (d.name == "Bob" ? msgs[1] : msgs[2]);
+            REQUIRE(d.text == msg.text);
+            REQUIRE(d.reason == messenger::reassembly_reason_t::complete);
+        }
+
+        messenger::reassembler_stats_t stats = reasm.stats();
+        REQUIRE(stats.msgs == 3);
+        REQUIRE(stats.senders == 0);
+        REQUIRE(stats.bytes == 0);
+    }
+}
+
+TEST_CASE("reassembler_t: flush & idle timeout of full-packet messages", "[reassembler_t][normal]") {
+    using clock_t = messenger::reassembler_t::clock_t;
+    std::vector<delivered_t> delivered;
+    messenger::reassembler_config_t config;
+    config.idle_timeout = std::chrono::milliseconds(100);
+
+    messenger::reassembler_t reasm([&](std::string_view name, std::string_view text, messenger::reassembly_reason_t reason) {
+        delivered.push_back(delivered_t{std::string(name), std::string(text), reason});
+    }, config);
+
+    // Texts of MSGR_MSG_LEN_MAX multiple length can not be completed by packet
+    const std::string text = std::string(MSGR_MSG_LEN_MAX * 2, 'z');
+    std::vector<uint8_t> buf1 = messenger::make_buff(messenger::msg_t("First", text));
+    std::vector<uint8_t> buf2 = messenger::make_buff(messenger::msg_t("Second", text));
+
+    clock_t::time_point t0 = clock_t::now();
+    reasm.feed(buf1.data(), buf1.data() + buf1.size(), t0);
+    reasm.feed(buf2.data(), buf2.data() + buf2.size(), t0 + std::chrono::milliseconds(50));
+
+    REQUIRE(delivered.empty());
+    REQUIRE(reasm.stats().senders == 2);
+    REQUIRE(reasm.stats().bytes == 2 * text.size());
+
+    REQUIRE(reasm.expire(t0 + std::chrono::milliseconds(120)) == 1);
+    REQUIRE(delivered.size() == 1);
+    REQUIRE(delivered[0].name == "First");
+    REQUIRE(delivered[0].text == text);
+    REQUIRE(delivered[0].reason == messenger::reassembly_reason_t::idle);
+
+    reasm.flush();
+    REQUIRE(delivered.size() == 2);
+    REQUIRE(delivered[1].name == "Second");
+    REQUIRE(delivered[1].reason == messenger::reassembly_reason_t::flush);
+    REQUIRE(reasm.stats().senders == 0);
+}
+
+TEST_CASE("reassembler_t: memory cap evicts oldest partial messages", "[reassembler_t][normal]") {
+    std::vector<delivered_t> delivered;
+    messenger::reassembler_config_t config;
+    config.max_bytes = 3 * MSGR_MSG_LEN_MAX;
+
+    messenger::reassembler_t reasm([&](std::string_view name, std::string_view text, messenger::reassembly_reason_t reason) {
+        delivered.push_back(delivered_t{std::string(name), std::string(text), reason});
+    }, config);
+
+    const std::string full_packet_text = std::string(MSGR_MSG_LEN_MAX, 'x');
+    for(const char *name : {"A", "B", "C", "D"}) {
+        std::vector<uint8_t> buf = messenger::make_buff(messenger::msg_t(name, full_packet_text));
+        reasm.feed(buf.data(), buf.data() + buf.size());
+    }
+
+    REQUIRE(delivered.size() == 1);
+    REQUIRE(delivered[0].name == "A");
+    REQUIRE(delivered[0].reason == messenger::reassembly_reason_t::evict);
+    REQUIRE(reasm.stats().evicted == 1);
+    REQUIRE(reasm.stats().bytes == config.max_bytes);
+}
+
+TEST_CASE("reassembler_t: next message of sender cuts partial message short", "[reassembler_t][normal]") {
+    std::vector<delivered_t> delivered;
+    messenger::reassembler_t reasm([&](std::string_view name, std::string_view text, messenger::reassembly_reason_t reason) {
+        delivered.push_back(delivered_t{std::string(name), std::string(text), reason});
+    });
+
+    const std::string full_packet_text = std::string(MSGR_MSG_LEN_MAX, 'x');
+    const std::string long_text = util::repeat_string("compressible ", 40);
+
+    messenger::buff_opts_t compressed;
+    compressed.compress = true;
+    compressed.compress_threshold = 0;
+    messenger::buff_opts_t checked;
+    checked.crc32c = true;
+
+    // Message without end mark, followed by compressed one, then by one led by CRC32C packet
+    std::vector<uint8_t> stream = messenger::make_buff(messenger::msg_t("A", full_packet_text));
+    messenger::append_buff(messenger::msg_t("A", long_text), stream, compressed);
+    messenger::append_buff(messenger::msg_t("A", full_packet_text), stream);
+    messenger::append_buff(messenger::msg_t("A", "checked"), stream, checked);
+    reasm.feed(stream.data(), stream.data() + stream.size());
+
+    REQUIRE(delivered.size() == 4);
+    REQUIRE(delivered[0].text == full_packet_text);
+    REQUIRE(delivered[0].reason == messenger::reassembly_reason_t::cut);
+    REQUIRE(delivered[1].text == long_text);
+    REQUIRE(delivered[1].reason == messenger::reassembly_reason_t::complete);
+    REQUIRE(delivered[2].text == full_packet_text);
+    REQUIRE(delivered[2].reason == messenger::reassembly_reason_t::cut);
+    REQUIRE(delivered[3].text == "checked");
+
+    messenger::reassembler_stats_t stats = reasm.stats();
+    REQUIRE(stats.cut == 2);
+    REQUIRE(stats.evicted == 0);
+}
+
+TEST_CASE("reassembler_t: tens of thousands of senders", "[reassembler_t][normal]") {
+    const size_t SENDER_NUM = 20000;
+    std::map<std::string, std::string> delivered;
+
+    messenger::reassembler_t reasm([&](std::string_view name, std::string_view text, messenger::reassembly_reason_t) {
+        delivered[std::string(name)] = std::string(text);
+    });
+
+    // First packets of every sender, then rest of them
+    std::vector<uint8_t> firsts;
+    std::vector<uint8_t> rests;
+    for(size_t i = 0; i < SENDER_NUM; ++i) {
+        std::string name = "S" + std::to_string(i);
+        std::vector<uint8_t> buf = messenger::make_buff(messenger::msg_t(name, std::string(MSGR_MSG_LEN_MAX, 'a') + name));
+
+        size_t first_size = messenger::detail::packet_size(buf.data());
+        firsts.insert(firsts.end(), buf.begin(), buf.begin() + first_size);
+        rests.insert(rests.end(), buf.begin() + first_size, buf.end());
+    }
+
+    reasm.feed(firsts.data(), firsts.data() + firsts.size());
+    REQUIRE(reasm.stats().senders == SENDER_NUM);
+
+    reasm.feed(rests.data(), rests.data() + rests.size());
+    REQUIRE(reasm.stats().senders == 0);
+    REQUIRE(delivered.size() == SENDER_NUM);
+    REQUIRE(delivered["S12345"] == std::string(MSGR_MSG_LEN_MAX, 'a') + "S12345");
+}
+
+TEST_CASE("reassembler_t: corrupted packets", "[reassembler_t][false]") {
+    std::vector<delivered_t> delivered;
+    messenger::reassembler_t reasm([&](std::string_view name, std::string_view text, messenger::reassembly_reason_t reason) {
+        delivered.push_back(delivered_t{std::string(name), std::string(text), reason});
+    });
+
+    std::vector<uint8_t> buf = messenger::make_buff(messenger::msg_t("Name", util::repeat_string("0123456789", 5)));
+
+    SECTION("invalid CRC4 drops message") {
+        buf.back() ^= 0x1;
+        std::vector<uint8_t> next = messenger::make_buff(messenger::msg_t("Name", "next"));
+        buf.insert(buf.end(), next.begin(), next.end());
+
+        REQUIRE_NOTHROW(reasm.feed(buf.data(), buf.data() + buf.size()));
+        REQUIRE(reasm.stats().dropped == 1);
+        REQUIRE(delivered.size() == 1);
+        REQUIRE(delivered[0].text == "next");
+    }
+
+    SECTION("invalid flag bits break framing") {
+        buf[0] ^= 0x1;
+        REQUIRE_THROWS_AS(reasm.feed(buf.data(), buf.data() + buf.size()), std::runtime_error);
+    }
+}
+
+} // namespace test
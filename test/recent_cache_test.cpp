@@ -0,0 +1,187 @@
+#include <catch2/catch_all.hpp>
+
+#include <atomic>
+#include <thread>
+
+#include "messenger.hpp"
+#include "recent_cache.hpp"
+
+#include "alloc_counter.hpp"
+#include "test_util.hpp"
+
+
+namespace test {
+
+/**
+ * recent_cache_t Unit Tests
+*/
+
+TEST_CASE("recent_cache_t: last messages of sender", "[recent_cache_t][normal]") {
+    messenger::recent_cache_config_t config;
+    config.per_sender = 4;
+    messenger::recent_cache_t cache(config);
+
+    for(int i = 0; i < 10; ++i) {
+        cache.insert(messenger::msg_t("Alice", "alice " + std::to_string(i)));
+        cache.insert(messenger::msg_t("Bob", util::repeat_string("bob ", i + 1)));
+    }
+
+    std::vector<messenger::msg_t> last = cache.recent("Alice", 3);
+    REQUIRE(last.size() == 3);
+    REQUIRE(last[0].text == "alice 7");
+    REQUIRE(last[1].text == "alice 8");
+    REQUIRE(last[2].text == "alice 9");
+    REQUIRE(last[2].name == "Alice");
+
+    // Ring keeps per_sender messages only
+    std::vector<messenger::msg_t> all = cache.recent("Bob", 100);
+    REQUIRE(all.size() == 4);
+    REQUIRE(all.front().text == util::repeat_string("bob ", 7));
+    REQUIRE(all.back().text == util::repeat_string("bob ", 10));
+
+    REQUIRE(cache.recent("Carol", 5).empty());
+    REQUIRE(cache.recent("NameWhichIsTooLong", 5).empty());
+
+    messenger::recent_cache_stats_t stats = cache.stats();
+    REQUIRE(stats.hits == 2);
+    REQUIRE(stats.misses == 2);
+    REQUIRE(stats.inserts == 20);
+    REQUIRE(stats.senders == 2);
+    REQUIRE(stats.msgs == 8);
+    REQUIRE(stats.evicted_msgs == 0);
+
+    cache.clear();
+    REQUIRE(cache.recent("Alice", 3).empty());
+    REQUIRE(cache.stats().bytes == 0);
+}
+
+TEST_CASE("recent_cache_t: byte budget evicts least recently updated senders", "[recent_cache_t][normal]") {
+    messenger::msg_t msg("Sender0", util::repeat_string("x", 20));
+    size_t msg_size = messenger::buff_size(msg);
+
+    messenger::recent_cache_config_t config;
+    config.per_sender = 2;
+    config.max_bytes = 3 * msg_size;
+    messenger::recent_cache_t cache(config);
+
+    for(int i = 0; i < 3; ++i)
+        cache.insert(messenger::msg_t("Sender" + std::to_string(i), msg.text));
+
+    // Sender0 is updated, so Sender1 is least recently updated one
+    cache.insert(messenger::msg_t("Sender0", msg.text));
+
+    messenger::recent_cache_stats_t stats = cache.stats();
+    REQUIRE(stats.bytes <= config.max_bytes);
+    REQUIRE(stats.evicted_senders == 1);
+    REQUIRE(stats.evicted_msgs == 1);
+    REQUIRE(cache.recent("Sender0", 5).size() == 2);
+    REQUIRE(cache.recent("Sender1", 5).empty());
+    REQUIRE(cache.recent("Sender2", 5).size() == 1);
+
+    SECTION("single sender over budget keeps its newest message") {
+        std::string text = util::repeat_string("y", 500);
+        cache.insert(messenger::msg_t("Big", text));
+
+        REQUIRE(cache.stats().senders == 1);
+        REQUIRE(cache.recent("Big", 5).size() == 1);
+        REQUIRE(cache.recent("Big", 5)[0].text == text);
+    }
+}
+
+TEST_CASE("recent_cache_t: overwritten slot keeps no excess of longer message", "[recent_cache_t][normal]") {
+    messenger::recent_cache_config_t config;
+    config.per_sender = 1;
+    messenger::recent_cache_t cache(config);
+
+    std::vector<uint8_t> big = messenger::make_buff(messenger::msg_t("Sender", util::repeat_string("b", 2000)));
+    std::vector<uint8_t> small = messenger::make_buff(messenger::msg_t("Sender", util::repeat_string("s", 20)));
+    cache.insert_buff(big.data(), big.data() + big.size());
+
+    // Slot of big message is shrunk, then reused by messages of same size
+    REQUIRE(alloc::count([&]() { cache.insert_buff(small.data(), small.data() + small.size()); }).num == 1);
+    REQUIRE(alloc::count([&]() { cache.insert_buff(small.data(), small.data() + small.size()); }).num == 0);
+
+    REQUIRE(cache.stats().bytes == small.size());
+    REQUIRE(cache.recent("Sender", 1)[0].text == util::repeat_string("s", 20));
+}
+
+TEST_CASE("recent_cache_t: encoded & compressed messages", "[recent_cache_t][normal]") {
+    messenger::recent_cache_config_t config;
+    config.encoding.compress = true;
+    config.encoding.compress_threshold = 64;
+    messenger::recent_cache_t cache(config);
+
+    std::string chatty = util::repeat_string("how are you doing today? ", 40);
+    cache.insert(messenger::msg_t("Name", chatty));
+    REQUIRE(cache.stats().bytes < chatty.size() / 4);
+
+    std::vector<uint8_t> buff = messenger::make_buff(messenger::msg_t("Name", "pre-encoded"));
+    cache.insert_buff(buff.data(), buff.data() + buff.size());
+
+    std::vector<messenger::msg_t> last = cache.recent("Name", 2);
+    REQUIRE(last.size() == 2);
+    REQUIRE(last[0].text == chatty);
+    REQUIRE(last[1].text == "pre-encoded");
+}
+
+TEST_CASE("recent_cache_t: invalid input", "[recent_cache_t][false]") {
+    messenger::recent_cache_config_t config;
+    config.per_sender = 0;
+    CHECK_THROWS_AS(messenger::recent_cache_t(config), std::invalid_argument);
+
+    messenger::recent_cache_t cache;
+    CHECK_THROWS_AS(cache.insert(messenger::msg_t("", "text")), std::length_error);
+    CHECK_THROWS_AS(cache.insert(messenger::msg_t("Name", "")), std::length_error);
+
+    std::vector<uint8_t> buff = messenger::make_buff(messenger::msg_t("Name", util::repeat_string("z", 40)));
+    buff.back() ^= 0x1;
+    CHECK_THROWS_AS(cache.insert_buff(buff.data(), buff.data() + buff.size()), std::runtime_error);
+
+    std::vector<uint8_t> mixed = messenger::make_buff(messenger::msg_t("Name", util::repeat_string("z", 31)));
+    messenger::append_buff(messenger::msg_t("Other", "z"), mixed);
+    CHECK_THROWS_AS(cache.insert_buff(mixed.data(), mixed.data() + mixed.size()), std::runtime_error);
+
+    REQUIRE(cache.stats().inserts == 0);
+}
+
+TEST_CASE("recent_cache_t: concurrent readers during inserts", "[recent_cache_t][normal]") {
+    messenger::recent_cache_config_t config;
+    config.per_sender = 8;
+    config.max_bytes = 4096;
+    messenger::recent_cache_t cache(config);
+
+    const int senders = 16;
+    std::atomic<bool> done(false);
+    std::atomic<size_t> torn_msgs(0);
+
+    std::vector<std::thread> readers;
+    for(int r = 0; r < 3; ++r) {
+        readers.emplace_back([&, r]() {
+            for(int i = r; !done.load(); ++i) {
+                std::string name = "S" + std::to_string(i % senders);
+                for(const messenger::msg_t &msg : cache.recent(name, 4)) {
+                    // Text carries sender's name, so torn reads would show up
+                    if(msg.name != name || msg.text.compare(0, name.size() + 1, name + ":") != 0)
+                        torn_msgs++;
+                }
+            }
+        });
+    }
+
+    for(int i = 0; i < 20000; ++i) {
+        std::string name = "S" + std::to_string(i % senders);
+        cache.insert(messenger::msg_t(name, name + ":" + std::to_string(i)));
+    }
+    done = true;
+    for(std::thread &reader : readers)
+        reader.join();
+
+    REQUIRE(torn_msgs == 0);
+
+    messenger::recent_cache_stats_t stats = cache.stats();
+    REQUIRE(stats.inserts == 20000);
+    REQUIRE(stats.bytes <= config.max_bytes);
+    REQUIRE(stats.hits + stats.misses > 0);
+}
+
+} // namespace test
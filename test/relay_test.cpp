@@ -0,0 +1,97 @@
+#include <catch2/catch_all.hpp>
+
+#include "messenger.hpp"
+#include "relay.hpp"
+
+#include "test_util.hpp"
+
+
+namespace test {
+
+/**
+ * relay_t Unit Tests
+*/
+
+TEST_CASE("relay_t: forward renames sender of different length", "[relay_t][normal]") {
+    const std::string text = util::repeat_string("Lorem ipsum ", 8);
+    messenger::relay_t relay;
+    relay.add_rename("Timur", "T");
+    relay.add_rename("Bob", "Robert Longname");
+
+    // Stream of 3 messages of different senders
+    std::vector<uint8_t> in;
+    messenger::append_buff(messenger::msg_t("Timur", text), in);
+    messenger::append_buff(messenger::msg_t("Alice", text), in);
+    messenger::append_buff(messenger::msg_t("Bob", text), in);
+
+    std::vector<uint8_t> expected;
+    messenger::append_buff(messenger::msg_t("T", text), expected);
+    messenger::append_buff(messenger::msg_t("Alice", text), expected);
+    messenger::append_buff(messenger::msg_t("Robert Longname", text), expected);
+
+    std::vector<uint8_t> out;
+    messenger::relay_stats_t stats;
+    REQUIRE_NOTHROW(stats = relay.forward(in.data(), in.data() + in.size(), out));
+
+    // Byte exact to encoding of renamed messages, including CRC4
+    REQUIRE_THAT(out, Catch::Matchers::RangeEquals(expected));
+
+    // 96 bytes of text take 4 packets per message
+    REQUIRE(text.size() == 96);
+    REQUIRE(stats.bytes_in == in.size());
+    REQUIRE(stats.bytes_out == out.size());
+    REQUIRE(stats.packets == 12);
+    REQUIRE(stats.renamed == 8);
+    REQUIRE(stats.crc_bytes_saved == 2 * text.size());
+    REQUIRE(stats.copy_bytes_saved == 0);
+}
+
+TEST_CASE("relay_t: rewrite in place keeps payload", "[relay_t][normal]") {
+    const std::string text = "Lorem ipsum kekus maximus nothing more to say";
+    messenger::relay_t relay;
+    relay.add_rename("Name", "Eman");
+
+    std::vector<uint8_t> buf = messenger::make_buff(messenger::msg_t("Name", text));
+    std::vector<uint8_t> expected = messenger::make_buff(messenger::msg_t("Eman", text));
+
+    messenger::relay_stats_t stats;
+    REQUIRE_NOTHROW(stats = relay.rewrite_in_place(buf.data(), buf.data() + buf.size()));
+
+    REQUIRE_THAT(buf, Catch::Matchers::RangeEquals(expected));
+    REQUIRE(stats.packets == 2);
+    REQUIRE(stats.renamed == 2);
+    REQUIRE(stats.copy_bytes_saved == text.size());
+    REQUIRE(stats.crc_bytes_saved == text.size());
+}
+
+TEST_CASE("relay_t: invalid renames & streams", "[relay_t][false]") {
+    messenger::relay_t relay;
+
+    CHECK_THROWS_AS(relay.add_rename("", "Name"), std::length_error);
+    CHECK_THROWS_AS(relay.add_rename("Name", "TooLongToBeAName"), std::length_error);
+
+    relay.add_rename("Name", "Longer name");
+    std::vector<uint8_t> buf = messenger::make_buff(messenger::msg_t("Name", "Lorem ipsum"));
+    std::vector<uint8_t> out;
+
+    SECTION("in place rename changing length") {
+        CHECK_THROWS_AS(relay.rewrite_in_place(buf.data(), buf.data() + buf.size()), std::invalid_argument);
+    }
+
+    SECTION("trimmed stream") {
+        REQUIRE_THROWS(relay.forward(buf.data(), buf.data() + buf.size() - 1, out));
+    }
+
+    SECTION("invalid flag bits") {
+        buf[0] ^= 0x1;
+        REQUIRE_THROWS(relay.forward(buf.data(), buf.data() + buf.size(), out));
+    }
+
+    SECTION("corrupted payload stays corrupted") {
+        buf.back() ^= 0x4;
+        REQUIRE_NOTHROW(relay.forward(buf.data(), buf.data() + buf.size(), out));
+        REQUIRE_THROWS(messenger::parse_buff(out));
+    }
+}
+
+} // namespace test
@@ -0,0 +1,113 @@
+#include <catch2/catch_all.hpp>
+
+#include <list>
+
+#include "messenger.hpp"
+#include "segmented.hpp"
+
+#include "test_util.hpp"
+
+
+namespace test {
+
+/**
+ * parse_segments Unit Tests
+*/
+
+TEST_CASE("parse_segments: buffer split into 2 segments at every position", "[parse_segments][normal]") {
+    messenger::msg_t msg("Name", "Lorem ipsum kekus maximus nothing more to say, and even more");
+    std::vector<uint8_t> buf = messenger::make_buff(msg);
+
+    for(size_t split = 0; split <= buf.size(); ++split) {
+        std::vector<std::vector<uint8_t>> segments = {
+            std::vector<uint8_t>(buf.begin(), buf.begin() + split),
+            std::vector<uint8_t>(buf.begin() + split, buf.end())
+        };
+
+        messenger::msg_t parsed;
+        REQUIRE_NOTHROW(parsed = messenger::parse_segments(segments));
+        REQUIRE(parsed.name == msg.name);
+        REQUIRE(parsed.text == msg.text);
+    }
+}
+
+TEST_CASE("parse_segments: iovec array & chunk list", "[parse_segments][normal]") {
+    messenger::msg_t msg("Sender", util::repeat_string("ABCDEFGHIJ", 10));
+    std::vector<uint8_t> buf = messenger::make_buff(msg);
+    const size_t CHUNK_SIZE = 3;
+
+    SECTION("iovec array") {
+        std::vector<struct iovec> iov;
+        for(size_t pos = 0; pos < buf.size(); pos += CHUNK_SIZE) {
+            struct iovec chunk;
+            chunk.iov_base = buf.data() + pos;
+            chunk.iov_len = std::min(CHUNK_SIZE, buf.size() - pos);
+            iov.push_back(chunk);
+        }
+
+        messenger::msg_t parsed = messenger::parse_segments(iov.data(), iov.data() + iov.size());
+        REQUIRE(parsed.name == msg.name);
+        REQUIRE(parsed.text == msg.text);
+    }
+
+    SECTION("chunk list with empty chunks") {
+        std::list<std::string> chunks;
+        for(size_t pos = 0; pos < buf.size(); pos += CHUNK_SIZE) {
+            chunks.push_back("");
+            chunks.push_back(std::string(buf.begin() + pos, buf.begin() + std::min(pos + CHUNK_SIZE, buf.size())));
+        }
+        chunks.push_back("");
+
+        messenger::msg_t parsed = messenger::parse_segments(chunks);
+        REQUIRE(parsed.name == msg.name);
+        REQUIRE(parsed.text == msg.text);
+    }
+}
+
+TEST_CASE("parse_segments: ring buffer wrap", "[parse_segments][normal]") {
+    messenger::msg_t msg("Name", "Lorem ipsum kekus maximus nothing more to say");
+    std::vector<uint8_t> buf = messenger::make_buff(msg);
+    std::vector<uint8_t> ring(buf.size() + 7, 0);
+
+    for(size_t head = 0; head < ring.size(); ++head) {
+        // Place buffer into ring, starting at head
+        for(size_t i = 0; i < buf.size(); ++i)
+            ring[(head + i) % ring.size()] = buf[i];
+
+        std::array<messenger::segment_t, 2> segments =
+            messenger::ring_segments(ring.data(), ring.size(), head, buf.size());
+
+        REQUIRE(segments[0].size + segments[1].size == buf.size());
+
+        messenger::msg_t parsed = messenger::parse_segments(segments);
+        REQUIRE(parsed.name == msg.name);
+        REQUIRE(parsed.text == msg.text);
+    }
+}
+
+TEST_CASE("parse_segments: invalid buffers", "[parse_segments][false]") {
+    messenger::msg_t msg("Name", "Lorem ipsum kekus maximus nothing more to say");
+    std::vector<uint8_t> buf = messenger::make_buff(msg);
+
+    SECTION("no segments") {
+        std::vector<messenger::segment_t> segments;
+        REQUIRE_THROWS(messenger::parse_segments(segments));
+    }
+
+    SECTION("trimmed buffer") {
+        std::vector<messenger::segment_t> segments = {
+            {buf.data(), 10}, {buf.data() + 10, buf.size() - 11}
+        };
+        REQUIRE_THROWS(messenger::parse_segments(segments));
+    }
+
+    SECTION("corrupted byte in second segment") {
+        buf[buf.size() - 2] ^= 0x10;
+        std::vector<messenger::segment_t> segments = {
+            {buf.data(), 20}, {buf.data() + 20, buf.size() - 20}
+        };
+        REQUIRE_THROWS(messenger::parse_segments(segments));
+    }
+}
+
+} // namespace test
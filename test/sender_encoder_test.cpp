@@ -0,0 +1,58 @@
+#include <catch2/catch_all.hpp>
+
+#include "messenger.hpp"
+#include "sender_encoder.hpp"
+
+#include "test_util.hpp"
+
+
+namespace test {
+
+/**
+ * sender_encoder_t Unit Tests
+*/
+
+TEST_CASE("sender_encoder_t: byte exact to make_buf", "[sender_encoder_t][normal]") {
+    for(const std::string name : {"A", "Name", "FifteenCharName"}) {
+        messenger::sender_encoder_t enc(name);
+        REQUIRE(enc.name() == name);
+
+        // Tail packets of every length, full packets & their combinations
+        for(size_t text_len = 1; text_len <= 4 * MSGR_MSG_LEN_MAX + 1; ++text_len) {
+            std::string text;
+            for(size_t i = 0; i < text_len; ++i)
+                text += static_cast<char>('!' + (i * 7 + text_len) % 90);
+
+            std::vector<uint8_t> expected = messenger::make_buff(messenger::msg_t(name, text));
+            std::vector<uint8_t> res = enc.make_buff(text);
+
+            REQUIRE(enc.buff_size(text.size()) == expected.size());
+            REQUIRE_THAT(res, Catch::Matchers::RangeEquals(expected));
+        }
+    }
+}
+
+TEST_CASE("sender_encoder_t: hardcoded packet", "[sender_encoder_t][normal]") {
+    std::string test_name;
+    std::string test_text;
+    std::vector<uint8_t> hardcoded_packet = util::hardcoded_packet_short_text(test_name, test_text);
+
+    messenger::sender_encoder_t enc(test_name);
+    std::vector<uint8_t> out = {0x1};
+    REQUIRE_NOTHROW(enc.append(test_text, out));
+
+    REQUIRE(out.size() == 1 + hardcoded_packet.size());
+    REQUIRE(std::equal(hardcoded_packet.begin(), hardcoded_packet.end(), out.begin() + 1));
+}
+
+TEST_CASE("sender_encoder_t: invalid name & text", "[sender_encoder_t][false]") {
+    CHECK_THROWS_AS(messenger::sender_encoder_t(""), std::length_error);
+    CHECK_THROWS_AS(messenger::sender_encoder_t("TooLongToBeAName"), std::length_error);
+
+    messenger::sender_encoder_t enc("Name");
+    std::vector<uint8_t> out;
+    CHECK_THROWS_AS(enc.append("", out), std::length_error);
+    REQUIRE(out.empty());
+}
+
+} // namespace test
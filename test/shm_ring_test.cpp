@@ -0,0 +1,183 @@
+#include <catch2/catch_all.hpp>
+
+#include <thread>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "messenger.hpp"
+#include "reassembler.hpp"
+#include "shm_ring.hpp"
+
+#include "test_util.hpp"
+
+
+namespace test {
+
+namespace {
+
+// Text of i-th test message, lengths are never multiple of MSGR_MSG_LEN_MAX
+std::string nth_text(size_t i) {
+    std::string text = std::to_string(i) + ":" + util::repeat_string("x", i % 200);
+    if(text.size() % MSGR_MSG_LEN_MAX == 0)
+        text += "x";
+    return text;
+}
+
+// Consume ring until end of stream, returns received texts
+std::vector<std::string> consume(messenger::shm_ring_t &ring) {
+    std::vector<std::string> texts;
+    messenger::reassembler_t reasm([&](std::string_view, std::string_view text, messenger::reassembly_reason_t) {
+        texts.emplace_back(text);
+    });
+
+    size_t len;
+    while(const uint8_t *data = ring.read(len, std::chrono::seconds(10))) {
+        reasm.feed(data, data + len);
+        ring.release(len);
+    }
+
+    return texts;
+}
+
+} // namespace
+
+/**
+ * shm_ring_t Unit Tests
+*/
+
+TEST_CASE("shm_ring_t: threads exchange packets across wrap-around", "[shm_ring_t][normal]") {
+    messenger::shm_ring_t ring = messenger::shm_ring_t::create(4096);
+    REQUIRE(ring.capacity() >= 4096);
+    ring.set_role(messenger::shm_ring_t::role_t::producer);
+    ring.set_role(messenger::shm_ring_t::role_t::consumer);
+
+    const size_t msgs = 5000;
+    std::thread producer([&]() {
+        for(size_t i = 0; i < msgs; ++i)
+            ring.write(messenger::msg_t("Producer", nth_text(i)));
+        ring.close();
+    });
+
+    std::vector<std::string> texts = consume(ring);
+    producer.join();
+
+    REQUIRE(ring.closed());
+    REQUIRE(texts.size() == msgs);
+    for(size_t i = 0; i < msgs; ++i)
+        REQUIRE(texts[i] == nth_text(i));
+}
+
+TEST_CASE("shm_ring_t: attached mapping shares ring", "[shm_ring_t][normal]") {
+    messenger::shm_ring_t ring = messenger::shm_ring_t::create(8192);
+    messenger::shm_ring_t other = messenger::shm_ring_t::attach(ring.fd());
+    REQUIRE(other.capacity() == ring.capacity());
+
+    REQUIRE(ring.write(messenger::msg_t("Name", "Hi")));
+
+    size_t len = 0;
+    const uint8_t *data = other.read(len, std::chrono::milliseconds(100));
+    REQUIRE(data != NULL);
+
+    std::vector<uint8_t> expected = messenger::make_buff(messenger::msg_t("Name", "Hi"));
+    REQUIRE(std::vector<uint8_t>(data, data + len) == expected);
+    other.release(len);
+
+    // Empty ring: read times out
+    REQUIRE(other.read(len, std::chrono::milliseconds(10)) == NULL);
+    REQUIRE(len == 0);
+    REQUIRE_FALSE(other.closed());
+
+    // Full ring: reserve times out
+    REQUIRE(ring.reserve(ring.capacity(), std::chrono::milliseconds(10)) != NULL);
+    ring.commit(ring.capacity());
+    REQUIRE(ring.reserve(1, std::chrono::milliseconds(10)) == NULL);
+    CHECK_THROWS_AS(ring.reserve(ring.capacity() + 1), std::length_error);
+}
+
+TEST_CASE("shm_ring_t: invalid descriptor", "[shm_ring_t][false]") {
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    CHECK_THROWS(messenger::shm_ring_t::attach(fds[0]));
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST_CASE("shm_ring_t: two processes", "[shm_ring_t][normal]") {
+    messenger::shm_ring_t ring = messenger::shm_ring_t::create(16384);
+    ring.set_role(messenger::shm_ring_t::role_t::consumer);
+
+    const size_t msgs = 20000;
+    pid_t pid = fork();
+    REQUIRE(pid >= 0);
+    if(pid == 0) {
+        // Mapping is inherited by child
+        ring.set_role(messenger::shm_ring_t::role_t::producer);
+        for(size_t i = 0; i < msgs; ++i)
+            ring.write(messenger::msg_t("Child", nth_text(i)));
+        ring.close();
+        _exit(0);
+    }
+
+    std::vector<std::string> texts = consume(ring);
+
+    int status = 0;
+    REQUIRE(waitpid(pid, &status, 0) == pid);
+    REQUIRE(WIFEXITED(status));
+    REQUIRE(WEXITSTATUS(status) == 0);
+
+    REQUIRE(texts.size() == msgs);
+    REQUIRE(texts.front() == nth_text(0));
+    REQUIRE(texts.back() == nth_text(msgs - 1));
+}
+
+TEST_CASE("shm_ring_t: crashed peer", "[shm_ring_t][false]") {
+    messenger::shm_ring_t ring = messenger::shm_ring_t::create(4096);
+
+    SECTION("producer is gone without close") {
+        ring.set_role(messenger::shm_ring_t::role_t::consumer);
+
+        pid_t pid = fork();
+        REQUIRE(pid >= 0);
+        if(pid == 0) {
+            ring.set_role(messenger::shm_ring_t::role_t::producer);
+            ring.write(messenger::msg_t("Child", "last words"));
+            _exit(1);
+        }
+
+        // Written data is still readable, then crash is reported (child is zombie until waitpid)
+        size_t len = 0;
+        const uint8_t *data = ring.read(len, std::chrono::seconds(10));
+        REQUIRE(data != NULL);
+        REQUIRE(messenger::parse_buff(data, data + len).text == "last words");
+        ring.release(len);
+
+        CHECK_THROWS_AS(ring.read(len, std::chrono::seconds(10)), std::runtime_error);
+
+        int status = 0;
+        REQUIRE(waitpid(pid, &status, 0) == pid);
+    }
+
+    SECTION("consumer is gone") {
+        ring.set_role(messenger::shm_ring_t::role_t::producer);
+
+        pid_t pid = fork();
+        REQUIRE(pid >= 0);
+        if(pid == 0) {
+            ring.set_role(messenger::shm_ring_t::role_t::consumer);
+            _exit(1);
+        }
+
+        int status = 0;
+        REQUIRE(waitpid(pid, &status, 0) == pid);
+
+        // Ring fills up, producer would wait for consumer forever
+        auto fill = [&]() {
+            for(;;)
+                ring.write(messenger::msg_t("Parent", util::repeat_string("z", 100)), std::chrono::seconds(10));
+        };
+        CHECK_THROWS_AS(fill(), std::runtime_error);
+    }
+}
+
+} // namespace test
@@ -0,0 +1,204 @@
+#include <catch2/catch_all.hpp>
+
+#include <thread>
+
+#include "messenger.hpp"
+#include "spill_queue.hpp"
+
+#include "alloc_counter.hpp"
+#include "test_util.hpp"
+
+
+namespace test {
+
+namespace {
+
+messenger::msg_t numbered_msg(size_t i) {
+    return messenger::msg_t("S" + std::to_string(i % 17), "message #" + std::to_string(i) + " " + util::repeat_string("x", i % 90));
+}
+
+// Read & release at most max bytes
+size_t drain(messenger::spill_queue_t &queue, std::vector<uint8_t> &out, size_t max) {
+    size_t total = 0;
+    size_t len;
+    while(total < max) {
+        const uint8_t *data = queue.read(len);
+        if(data == NULL)
+            break;
+        len = std::min(len, max - total);
+        out.insert(out.end(), data, data + len);
+        queue.release(len);
+        total += len;
+    }
+    return total;
+}
+
+} // namespace
+
+/**
+ * spill_queue_t Unit Tests
+*/
+
+TEST_CASE("spill_queue_t: bytes spill to file & are replayed in order", "[spill_queue_t][normal]") {
+    messenger::spill_queue_config_t config;
+    config.memory_limit = 8 * 1024;
+    config.segment_size = 4096;
+    messenger::spill_queue_t queue(config);
+
+    std::vector<uint8_t> expected;
+    std::vector<uint8_t> received;
+    size_t spilled_max = 0;
+
+    // Bursts outpace consumer, then consumer catches up
+    for(size_t round = 0; round < 4; ++round) {
+        for(size_t i = 0; i < 2000; ++i) {
+            messenger::msg_t msg = numbered_msg(round * 2000 + i);
+            std::vector<uint8_t> buff = messenger::make_buff(msg);
+            expected.insert(expected.end(), buff.begin(), buff.end());
+
+            if(i % 2 == 0)
+                REQUIRE(queue.push(msg));
+            else
+                REQUIRE(queue.push(buff.data(), buff.data() + buff.size()));
+
+            if(i % 10 == 0)
+                drain(queue, received, 300);
+
+            messenger::spill_queue_stats_t stats = queue.stats();
+            REQUIRE(stats.memory_bytes <= config.memory_limit);
+            spilled_max = std::max(spilled_max, stats.disk_bytes);
+        }
+
+        drain(queue, received, SIZE_MAX);
+        REQUIRE(queue.empty());
+    }
+
+    REQUIRE(received == expected);
+    REQUIRE(spilled_max > config.segment_size);
+
+    messenger::spill_queue_stats_t stats = queue.stats();
+    REQUIRE(stats.memory_bytes == 0);
+    REQUIRE(stats.disk_bytes == 0);
+    REQUIRE(stats.pushed_bytes == expected.size());
+    REQUIRE(stats.spilled_bytes > 0);
+    REQUIRE(stats.replayed_bytes == stats.spilled_bytes);
+    REQUIRE(stats.rejected == 0);
+
+    // Drained file part returns queue to memory
+    REQUIRE(queue.push(numbered_msg(1)));
+    REQUIRE(queue.stats().memory_bytes == queue.size());
+}
+
+TEST_CASE("spill_queue_t: disk limit rejects pushes", "[spill_queue_t][normal]") {
+    messenger::spill_queue_config_t config;
+    config.memory_limit = 1024;
+    config.disk_limit = 4096;
+    config.segment_size = 1;
+    messenger::spill_queue_t queue(config);
+
+    std::vector<uint8_t> expected;
+    size_t rejected = 0;
+    for(size_t i = 0; i < 200; ++i) {
+        std::vector<uint8_t> buff = messenger::make_buff(numbered_msg(i));
+        if(queue.push(buff.data(), buff.data() + buff.size()))
+            expected.insert(expected.end(), buff.begin(), buff.end());
+        else
+            rejected++;
+    }
+
+    messenger::spill_queue_stats_t stats = queue.stats();
+    REQUIRE(rejected > 0);
+    REQUIRE(stats.rejected == rejected);
+    REQUIRE(stats.disk_bytes <= config.disk_limit);
+    REQUIRE(queue.size() == expected.size());
+
+    std::vector<uint8_t> received;
+    drain(queue, received, SIZE_MAX);
+    REQUIRE(received == expected);
+
+    // Message longer than memory_limit goes straight to file
+    messenger::msg_t big("Big", util::repeat_string("b", 2000));
+    REQUIRE(queue.push(big));
+    REQUIRE(queue.stats().disk_bytes == queue.size());
+}
+
+TEST_CASE("spill_queue_t: producer & consumer threads", "[spill_queue_t][normal]") {
+    messenger::spill_queue_config_t config;
+    config.memory_limit = 16 * 1024;
+    config.segment_size = 4096;
+    messenger::spill_queue_t queue(config);
+
+    const size_t num = 20000;
+    std::vector<uint8_t> expected;
+    for(size_t i = 0; i < num; ++i) {
+        std::vector<uint8_t> buff = messenger::make_buff(numbered_msg(i));
+        expected.insert(expected.end(), buff.begin(), buff.end());
+    }
+
+    bool pushed = true;
+    std::thread producer([&]() {
+        for(size_t i = 0; i < num; ++i)
+            pushed = queue.push(numbered_msg(i)) && pushed;
+    });
+
+    // Slow consumer, which reads small pieces
+    std::vector<uint8_t> received;
+    while(received.size() < expected.size()) {
+        if(drain(queue, received, 100) == 0)
+            std::this_thread::yield();
+    }
+    producer.join();
+
+    REQUIRE(pushed);
+    REQUIRE(received == expected);
+    REQUIRE(queue.empty());
+}
+
+TEST_CASE("spill_queue_t: steady state in memory performs 0 allocations", "[spill_queue_t][normal]") {
+    messenger::spill_queue_t queue;
+    messenger::msg_t msg("Sender", util::repeat_string("steady text ", 16) + "!");
+
+    // Warm up: chunks are recycled
+    for(size_t i = 0; i < 2000; ++i)
+        queue.push(msg);
+    std::vector<uint8_t> sink;
+    drain(queue, sink, SIZE_MAX);
+
+    size_t bytes = 0;
+    alloc::counts_t counts = alloc::count([&]() {
+        for(size_t i = 0; i < 2000; ++i) {
+            queue.push(msg);
+            size_t len;
+            while(queue.read(len) != NULL) {
+                bytes += len;
+                queue.release(len);
+            }
+        }
+    });
+
+    REQUIRE(counts.num == 0);
+    REQUIRE(bytes == 2000 * messenger::make_buff(msg).size());
+}
+
+TEST_CASE("spill_queue_t: invalid usage", "[spill_queue_t][false]") {
+    messenger::spill_queue_config_t config;
+    config.memory_limit = 0;
+    CHECK_THROWS_AS(messenger::spill_queue_t(config), std::invalid_argument);
+
+    config = messenger::spill_queue_config_t();
+    config.dir = "/nonexistent/messenger";
+    CHECK_THROWS_AS(messenger::spill_queue_t(config), std::system_error);
+
+    messenger::spill_queue_t queue;
+    CHECK_THROWS_AS(queue.push(messenger::msg_t("", "text")), std::length_error);
+    REQUIRE(queue.empty());
+
+    size_t len = 1;
+    REQUIRE(queue.read(len) == NULL);
+    REQUIRE(len == 0);
+
+    REQUIRE(queue.push(messenger::msg_t("Name", "text")));
+    CHECK_THROWS_AS(queue.release(queue.size() + 1), std::out_of_range);
+}
+
+} // namespace test
@@ -0,0 +1,140 @@
+#include <catch2/catch_all.hpp>
+
+#include <atomic>
+#include <random>
+#include <thread>
+
+#include "messenger.hpp"
+#include "text_index.hpp"
+#include "workload.hpp"
+
+#include "test_util.hpp"
+
+
+namespace test {
+
+namespace {
+
+std::vector<messenger::msg_t> chatty_msgs(size_t num) {
+    messenger::workload::config_t config;
+    config.msgs = num;
+    config.senders = 20;
+    config.vocabulary = 200;
+    config.text_len = {1, 300, 60};
+    return messenger::workload::generate_msgs(config);
+}
+
+// Ids of messages, which text contains pattern, by linear scan
+std::vector<uint32_t> scan(const std::vector<messenger::msg_t> &msgs, std::string_view pattern) {
+    std::vector<uint32_t> res;
+    for(size_t id = 0; id < msgs.size(); ++id) {
+        if(msgs[id].text.find(pattern) != std::string::npos)
+            res.push_back(static_cast<uint32_t>(id));
+    }
+    return res;
+}
+
+} // namespace
+
+/**
+ * text_index_t Unit Tests
+*/
+
+TEST_CASE("text_index_t: finds same messages as linear scan", "[text_index_t][normal]") {
+    std::vector<messenger::msg_t> msgs = chatty_msgs(2000);
+    std::mt19937_64 rng(7);
+
+    for(bool compress : {false, true}) {
+        messenger::text_index_config_t config;
+        config.encoding.compress = compress;
+        config.encoding.compress_threshold = 0;
+        messenger::text_index_t index(config);
+
+        for(size_t i = 0; i < msgs.size(); ++i)
+            REQUIRE(index.insert(msgs[i]) == i);
+        REQUIRE(index.size() == msgs.size());
+
+        // Substrings of stored texts at random places & of any length, so they span packets too
+        std::vector<std::string> patterns = {"", "a", "zz", "no such text in corpus", "\xff\xfe\xfd"};
+        for(size_t i = 0; i < 300; ++i) {
+            const std::string &text = msgs[rng() % msgs.size()].text;
+            size_t pos = rng() % text.size();
+            patterns.push_back(text.substr(pos, 1 + rng() % 40));
+        }
+
+        size_t mismatched = 0;
+        for(const std::string &pattern : patterns)
+            mismatched += index.find(pattern) != scan(msgs, pattern);
+        REQUIRE(mismatched == 0);
+
+        std::vector<uint32_t> all = scan(msgs, patterns[5]);
+        std::vector<uint32_t> limited = index.find(patterns[5], 1);
+        REQUIRE(limited.size() == 1);
+        REQUIRE(limited[0] == all[0]);
+
+        messenger::text_index_stats_t stats = index.stats();
+        REQUIRE(stats.msgs == msgs.size());
+        REQUIRE(stats.trigrams > 0);
+        // Delta coded postings take about a byte per posting
+        REQUIRE(stats.posting_bytes < stats.text_bytes * 2);
+    }
+}
+
+TEST_CASE("text_index_t: stores encoded messages", "[text_index_t][normal]") {
+    messenger::text_index_t index;
+    messenger::msg_t msg("Alice", util::repeat_string("needle in haystack ", 5));
+    std::vector<uint8_t> buff = messenger::make_buff(msg);
+
+    uint32_t id = index.insert_buff(buff.data(), buff.data() + buff.size());
+    messenger::msg_t stored = index.msg(id);
+    REQUIRE(stored.name == msg.name);
+    REQUIRE(stored.text == msg.text);
+    REQUIRE(index.stats().stored_bytes == buff.size());
+
+    REQUIRE(index.find("needle in haystack needle") == std::vector<uint32_t>{id});
+    // Trigrams of pattern are all in text, but not contiguous
+    REQUIRE(index.find("needle haystack").empty());
+}
+
+TEST_CASE("text_index_t: invalid input", "[text_index_t][false]") {
+    messenger::text_index_t index;
+    index.insert(messenger::msg_t("Name", "text"));
+
+    std::vector<uint8_t> buff = messenger::make_buff(messenger::msg_t("Name", "corrupted text"));
+    buff.back() ^= 0x01;
+    CHECK_THROWS_AS(index.insert_buff(buff.data(), buff.data() + buff.size()), std::runtime_error);
+    CHECK_THROWS_AS(index.insert(messenger::msg_t("", "text")), std::length_error);
+    CHECK_THROWS_AS(index.msg(1), std::out_of_range);
+
+    REQUIRE(index.size() == 1);
+    REQUIRE(index.find("text") == std::vector<uint32_t>{0});
+}
+
+TEST_CASE("text_index_t: queries while messages are inserted", "[text_index_t][normal]") {
+    std::vector<messenger::msg_t> msgs = chatty_msgs(3000);
+    messenger::text_index_t index;
+    std::atomic<bool> done(false);
+
+    std::thread writer([&]() {
+        for(const messenger::msg_t &msg : msgs)
+            index.insert(msg);
+        done = true;
+    });
+
+    // Every found message is inserted & matches, results only grow
+    size_t bad = 0;
+    size_t prev = 0;
+    while(!done) {
+        std::vector<uint32_t> found = index.find(msgs[0].text.substr(0, 5));
+        for(uint32_t id : found)
+            bad += id >= index.size() || msgs[id].text.find(msgs[0].text.substr(0, 5)) == std::string::npos;
+        bad += found.size() < prev;
+        prev = found.size();
+    }
+    writer.join();
+
+    REQUIRE(bad == 0);
+    REQUIRE(index.find(msgs[0].text.substr(0, 5)) == scan(msgs, msgs[0].text.substr(0, 5)));
+}
+
+} // namespace test
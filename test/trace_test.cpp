@@ -0,0 +1,191 @@
+#include <catch2/catch_all.hpp>
+
+#include <sstream>
+#include <thread>
+
+#include "messenger.hpp"
+#include "msg_hdr.hpp"
+#include "packet.hpp"
+#include "reassembler.hpp"
+#include "trace.hpp"
+#include "util.hpp"
+
+#include "test_util.hpp"
+
+
+namespace test {
+
+namespace {
+
+/**
+ * Recorder, attached for lifetime of scope
+*/
+struct attached_recorder_t {
+    messenger::trace::recorder_t recorder;
+
+    explicit attached_recorder_t(size_t capacity): recorder(capacity) {
+        messenger::trace::attach(&recorder);
+    }
+
+    ~attached_recorder_t() {
+        messenger::trace::attach(NULL);
+    }
+};
+
+// Number of recorded events of kind
+size_t count_events(const std::vector<messenger::trace::record_t> &records, messenger::trace::event_t event) {
+    size_t res = 0;
+    for(const messenger::trace::record_t &rec : records)
+        res += rec.event == event;
+    return res;
+}
+
+} // namespace
+
+/**
+ * trace::recorder_t Unit Tests
+*/
+
+TEST_CASE("trace::recorder_t: keeps latest events in order", "[trace][normal]") {
+    messenger::trace::recorder_t recorder(6);
+    REQUIRE(recorder.capacity() == 8);
+    REQUIRE(recorder.snapshot().empty());
+
+    recorder.record(messenger::trace::event_t::encode_packet, "Alice", 5, 31);
+    recorder.record(messenger::trace::event_t::flag_failure, NULL, 0, 3);
+    recorder.record(messenger::trace::event_t::msg_complete, "Too long name of sender", 23, 1ull << 40);
+
+    std::vector<messenger::trace::record_t> records = recorder.snapshot();
+    REQUIRE(records.size() == 3);
+    REQUIRE(records[0].event == messenger::trace::event_t::encode_packet);
+    REQUIRE(records[0].name() == "Alice");
+    REQUIRE(records[0].size == 31);
+    REQUIRE(records[1].name().empty());
+    REQUIRE(records[2].name() == "Too long name o");
+    REQUIRE(records[2].size == UINT32_MAX);
+    REQUIRE(records[0].ns <= records[2].ns);
+
+    std::ostringstream out;
+    recorder.dump(out);
+    REQUIRE(out.str().find(" encode_packet Alice 31\n") != std::string::npos);
+    REQUIRE(out.str().find(" flag_failure - 3\n") != std::string::npos);
+
+    // Full ring overwrites oldest events
+    for(size_t i = 0; i < 20; ++i)
+        recorder.record(messenger::trace::event_t::decode_packet, "Bob", 3, i);
+
+    records = recorder.snapshot();
+    REQUIRE(recorder.recorded() == 23);
+    REQUIRE(records.size() == 8);
+    for(size_t i = 0; i < records.size(); ++i) {
+        REQUIRE(records[i].seq == 15 + i);
+        REQUIRE(records[i].size == 12 + i);
+    }
+}
+
+TEST_CASE("trace::recorder_t: threads record concurrently", "[trace][normal]") {
+    const size_t THREADS = 4;
+    const size_t EVENTS = 10000;
+    messenger::trace::recorder_t recorder(THREADS * EVENTS);
+
+    std::vector<std::thread> threads;
+    for(size_t t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&recorder, t]() {
+            std::string name = "T" + std::to_string(t);
+            for(size_t i = 0; i < EVENTS; ++i)
+                recorder.record(messenger::trace::event_t::decode_packet, name.data(), name.size(), t);
+        });
+    }
+    for(std::thread &thread : threads)
+        thread.join();
+
+    std::vector<messenger::trace::record_t> records = recorder.snapshot();
+    REQUIRE(records.size() == THREADS * EVENTS);
+
+    // Every record is written by single thread as whole
+    size_t consistent = 0;
+    for(const messenger::trace::record_t &rec : records)
+        consistent += rec.name() == "T" + std::to_string(rec.size);
+    REQUIRE(consistent == records.size());
+}
+
+/**
+ * Probe points Unit Tests
+*/
+
+TEST_CASE("trace: probe points of encode & decode", "[trace][normal]") {
+    std::string text = util::repeat_string("t", 40);
+    messenger::buff_opts_t opts;
+    opts.crc32c = true;
+
+    attached_recorder_t attached(1024);
+    const messenger::trace::recorder_t &recorder = attached.recorder;
+
+    std::vector<uint8_t> buff = messenger::make_buff(messenger::msg_t("Traced", text), opts);
+    messenger::parse_buff(buff);
+
+    // Flag failure has no sender, CRC failures do
+    std::vector<uint8_t> bad_flag = buff;
+    bad_flag[0] &= ~MASK_FIRST_N(MSGR_FLAG_BITS);
+    CHECK_THROWS_AS(messenger::parse_buff(bad_flag), std::runtime_error);
+
+    std::vector<uint8_t> bad_crc4 = buff;
+    bad_crc4.back() ^= 0x01;
+    CHECK_THROWS_AS(messenger::parse_buff(bad_crc4), std::runtime_error);
+
+    messenger::reassembler_t reasm([](std::string_view, std::string_view, messenger::reassembly_reason_t) {});
+    reasm.feed(buff.data(), buff.data() + buff.size());
+
+    std::vector<messenger::trace::record_t> records = recorder.snapshot();
+
+    if(!messenger::trace::ENABLED) {
+        // Probe points compile to nothing
+        REQUIRE(records.empty());
+        return;
+    }
+
+    using event_t = messenger::trace::event_t;
+
+    // 1 CRC32C packet & 2 text packets: parsed, parsed till corrupted one, reassembled
+    REQUIRE(count_events(records, event_t::encode_packet) == 3);
+    REQUIRE(count_events(records, event_t::decode_packet) == 3 + 2 + 3);
+    REQUIRE(count_events(records, event_t::flag_failure) == 1);
+    REQUIRE(count_events(records, event_t::crc4_failure) == 1);
+    REQUIRE(count_events(records, event_t::msg_complete) == 2);
+
+    for(const messenger::trace::record_t &rec : records) {
+        if(rec.event == event_t::flag_failure)
+            REQUIRE(rec.name().empty());
+        else
+            REQUIRE(rec.name() == "Traced");
+
+        if(rec.event == event_t::msg_complete)
+            REQUIRE(rec.size == text.size());
+    }
+
+    SECTION("CRC32C failure") {
+        // Corrupt text together with its CRC4, so only CRC32C notices
+        std::vector<uint8_t> bad_crc32c = messenger::make_buff(messenger::msg_t("Traced", "short"), opts);
+        uint8_t *text_packet = bad_crc32c.data() + messenger::detail::packet_size(bad_crc32c.data());
+        bad_crc32c.back() ^= 0x01;
+        messenger::detail::msg_hdr_mod_t(text_packet).set_crc4(
+            messenger::util::crc4_packet(text_packet, bad_crc32c.data() + bad_crc32c.size()));
+
+        CHECK_THROWS_AS(messenger::parse_buff(bad_crc32c), std::runtime_error);
+        REQUIRE(count_events(recorder.snapshot(), event_t::crc32c_failure) == 1);
+    }
+}
+
+TEST_CASE("trace: detached recorder receives nothing", "[trace][normal]") {
+    messenger::trace::recorder_t recorder(16);
+    {
+        attached_recorder_t other(16);
+    }
+    REQUIRE(messenger::trace::attached() == NULL);
+
+    std::vector<uint8_t> buff = messenger::make_buff(messenger::msg_t("Name", "text"));
+    messenger::parse_buff(buff);
+    REQUIRE(recorder.recorded() == 0);
+}
+
+} // namespace test
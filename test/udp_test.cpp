@@ -0,0 +1,176 @@
+#include <catch2/catch_all.hpp>
+
+#include <sys/socket.h>
+
+#include "messenger.hpp"
+#include "msg_hdr.hpp"
+#include "udp.hpp"
+
+#include "test_util.hpp"
+
+
+namespace test {
+
+namespace {
+
+/**
+ * Receiver & sender, connected over loopback
+*/
+struct loopback_t {
+    messenger::udp_socket_t rx_sock = messenger::udp_socket_t::bind("127.0.0.1");
+    messenger::udp_socket_t tx_sock = messenger::udp_socket_t::connect("127.0.0.1", rx_sock.port());
+    std::vector<messenger::msg_t> received;
+
+    messenger::udp_receiver_t receiver;
+    messenger::udp_sender_t sender;
+
+    explicit loopback_t(messenger::udp_config_t config = messenger::udp_config_t())
+        : receiver(rx_sock.fd(), [this](std::string_view name, std::string_view text) {
+              received.push_back(messenger::msg_t(std::string(name), std::string(text)));
+          }, config)
+        , sender(tx_sock.fd(), config)
+    {
+        rx_sock.set_recv_buffer(4 * 1024 * 1024);
+    }
+
+    // Receive, until num messages are delivered or nothing arrives for a while
+    void receive_msgs(size_t num) {
+        while(received.size() < num && receiver.receive(std::chrono::milliseconds(1000)) != 0) {}
+    }
+};
+
+// Texts around packet boundaries: multiples of MSGR_MSG_LEN_MAX have no end mark
+std::vector<messenger::msg_t> boundary_msgs(size_t num) {
+    std::vector<messenger::msg_t> res;
+    for(size_t i = 0; i < num; ++i) {
+        size_t len = 1 + (i * 7) % 100;
+        if(i % 5 == 0)
+            len = MSGR_MSG_LEN_MAX * (1 + i % 3);
+        res.push_back(messenger::msg_t("S" + std::to_string(i % 13), util::repeat_string("x", len - 1) + char('a' + i % 26)));
+    }
+    return res;
+}
+
+bool same(const std::vector<messenger::msg_t> &a, const std::vector<messenger::msg_t> &b) {
+    if(a.size() != b.size())
+        return false;
+    for(size_t i = 0; i < a.size(); ++i) {
+        if(a[i].name != b[i].name || a[i].text != b[i].text)
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+/**
+ * udp_sender_t & udp_receiver_t Unit Tests
+*/
+
+TEST_CASE("udp: messages are packed into datagrams & sent in batches", "[udp][normal]") {
+    std::vector<messenger::msg_t> msgs = boundary_msgs(500);
+
+    for(bool compress : {false, true}) {
+        for(bool crc32c : {false, true}) {
+            messenger::udp_config_t config;
+            config.batch = 8;
+            config.encoding.compress = compress;
+            config.encoding.compress_threshold = 40;
+            config.encoding.crc32c = crc32c;
+            loopback_t loop(config);
+
+            for(const messenger::msg_t &msg : msgs)
+                loop.sender.send(msg);
+            loop.sender.flush();
+            loop.receive_msgs(msgs.size());
+
+            REQUIRE(same(loop.received, msgs));
+
+            messenger::udp_stats_t tx = loop.sender.stats();
+            messenger::udp_stats_t rx = loop.receiver.stats();
+            REQUIRE(tx.msgs == msgs.size());
+            REQUIRE(rx.msgs == msgs.size());
+            REQUIRE(rx.datagrams == tx.datagrams);
+            REQUIRE(rx.bytes == tx.bytes);
+            REQUIRE(rx.dropped == 0);
+
+            // Many messages per datagram, many datagrams per syscall
+            REQUIRE(tx.datagrams * 4 < msgs.size());
+            REQUIRE(tx.syscalls * config.batch >= tx.datagrams);
+            REQUIRE(tx.syscalls <= tx.datagrams / config.batch + 1);
+            REQUIRE(rx.syscalls < tx.datagrams);
+        }
+    }
+}
+
+TEST_CASE("udp: datagrams are decoded independently", "[udp][normal]") {
+    loopback_t loop;
+
+    // Corrupted datagram loses its messages only
+    std::vector<uint8_t> corrupted = messenger::make_buff(messenger::msg_t("Lost", util::repeat_string("l", 40)));
+    corrupted.back() ^= 0x01;
+    REQUIRE(::send(loop.tx_sock.fd(), corrupted.data(), corrupted.size(), 0) == static_cast<ssize_t>(corrupted.size()));
+
+    // Garbage flag bits
+    std::vector<uint8_t> garbage(20, 0xff);
+    REQUIRE(::send(loop.tx_sock.fd(), garbage.data(), garbage.size(), 0) == static_cast<ssize_t>(garbage.size()));
+
+    // Message with text multiple of packet ends with datagram
+    std::vector<messenger::msg_t> msgs = {
+        messenger::msg_t("Full", util::repeat_string("f", MSGR_MSG_LEN_MAX)),
+        messenger::msg_t("Full", "next")
+    };
+    for(const messenger::msg_t &msg : msgs)
+        loop.sender.send(msg);
+    loop.sender.flush();
+
+    loop.receive_msgs(msgs.size());
+    REQUIRE(same(loop.received, msgs));
+    REQUIRE(loop.receiver.stats().dropped == 2);
+    REQUIRE(loop.sender.stats().datagrams == 2);
+
+    // Destroyed sender sends queued messages
+    {
+        messenger::udp_sender_t sender(loop.tx_sock.fd());
+        sender.send(msgs[1]);
+    }
+    msgs.push_back(msgs[1]);
+    loop.receive_msgs(msgs.size());
+    REQUIRE(same(loop.received, msgs));
+
+    // Nothing queued
+    REQUIRE(loop.receiver.receive() == 0);
+    REQUIRE(loop.receiver.receive(std::chrono::milliseconds(1)) == 0);
+}
+
+TEST_CASE("udp: invalid usage", "[udp][false]") {
+    CHECK_THROWS_AS(messenger::udp_socket_t::bind("localhost"), std::invalid_argument);
+    CHECK_THROWS_AS(messenger::udp_socket_t::connect("127.0.0.1.1", 1), std::invalid_argument);
+
+    messenger::udp_socket_t sock = messenger::udp_socket_t::bind("127.0.0.1");
+
+    messenger::udp_config_t config;
+    config.datagram_size = 16;
+    CHECK_THROWS_AS(messenger::udp_sender_t(sock.fd(), config), std::invalid_argument);
+
+    config = messenger::udp_config_t();
+    config.batch = 0;
+    CHECK_THROWS_AS(messenger::udp_sender_t(sock.fd(), config), std::invalid_argument);
+    CHECK_THROWS_AS(messenger::udp_receiver_t(sock.fd(), [](std::string_view, std::string_view) {}, config), std::invalid_argument);
+
+    // Message does not fit datagram
+    config = messenger::udp_config_t();
+    config.datagram_size = 100;
+    loopback_t loop(config);
+    CHECK_THROWS_AS(loop.sender.send(messenger::msg_t("Big", util::repeat_string("b", 200))), std::length_error);
+    CHECK_THROWS_AS(loop.sender.send(messenger::msg_t("", "text")), std::length_error);
+    loop.sender.flush();
+    REQUIRE(loop.sender.stats().datagrams == 0);
+
+    // Unconnected socket can not send
+    messenger::udp_sender_t unconnected(sock.fd());
+    unconnected.send(messenger::msg_t("Name", "text"));
+    CHECK_THROWS_AS(unconnected.flush(), std::system_error);
+}
+
+} // namespace test
@@ -39,4 +39,20 @@ TEST_CASE("crc4_packet: calculate crc4 of buf from make_buf", "[crc4_packet][nor
     );
 }
 
-} // namespace test
\ No newline at end of file
+/**
+ * crc4_zeros Unit Tests
+*/
+
+TEST_CASE("crc4_zeros: same as crc4_range over zero bytes", "[crc4_zeros][normal]") {
+    std::vector<uint8_t> zeros(200, 0);
+
+    for(uint8_t c = 0; c <= MSGR_CRC4_MAX; ++c) {
+        for(size_t len : {0, 1, 2, 31, 63, 64, 65, 127, 200}) {
+            REQUIRE(
+                messenger::util::crc4_zeros(c, len) == messenger::util::crc4_range(c, zeros.data(), zeros.data() + len)
+            );
+        }
+    }
+}
+
+} // namespace test
@@ -0,0 +1,120 @@
+#include <catch2/catch_all.hpp>
+
+#include "messenger.hpp"
+#include "reassembler.hpp"
+#include "workload.hpp"
+
+#include "test_util.hpp"
+
+
+namespace test {
+
+/**
+ * workload Unit Tests
+*/
+
+TEST_CASE("workload: length_dist_t parsing", "[workload][normal]") {
+    messenger::workload::length_dist_t uniform = messenger::workload::length_dist_t::parse("3:15");
+    REQUIRE(uniform.min == 3);
+    REQUIRE(uniform.max == 15);
+    REQUIRE(uniform.mean == 0);
+
+    messenger::workload::length_dist_t exponential = messenger::workload::length_dist_t::parse("1:512:64");
+    REQUIRE(exponential.min == 1);
+    REQUIRE(exponential.max == 512);
+    REQUIRE(exponential.mean == 64);
+
+    CHECK_THROWS(messenger::workload::length_dist_t::parse("15"));
+    CHECK_THROWS(messenger::workload::length_dist_t::parse("15:3"));
+}
+
+TEST_CASE("workload: generated messages respect config", "[workload][normal]") {
+    messenger::workload::config_t config;
+    config.senders = 50;
+    config.msgs = 500;
+    config.name_len = {4, 8, 0};
+    config.text_len = {10, 100, 0};
+
+    std::vector<messenger::msg_t> msgs = messenger::workload::generate_msgs(config);
+    REQUIRE(msgs.size() == config.msgs);
+
+    for(const messenger::msg_t &msg : msgs) {
+        REQUIRE(msg.name.size() >= 4);
+        REQUIRE(msg.name.size() <= 8);
+        REQUIRE(msg.text.size() >= 10);
+        REQUIRE(msg.text.size() <= 101);
+        REQUIRE(msg.text.size() % MSGR_MSG_LEN_MAX != 0);
+    }
+
+    // Same seed, same messages
+    std::vector<messenger::msg_t> again = messenger::workload::generate_msgs(config);
+    REQUIRE(again[123].name == msgs[123].name);
+    REQUIRE(again[123].text == msgs[123].text);
+}
+
+TEST_CASE("workload: interleaved traffic decodes end to end", "[workload][normal]") {
+    messenger::workload::config_t config;
+    config.senders = 100;
+    config.msgs = 2000;
+    config.interleave = 20;
+
+    SECTION("intact traffic") {
+        messenger::workload::traffic_t traffic = messenger::workload::generate_traffic(config);
+        REQUIRE(traffic.msgs == config.msgs);
+        REQUIRE(traffic.corrupted == 0);
+
+        size_t msgs = 0;
+        size_t text_bytes = 0;
+        messenger::reassembler_t reasm([&](std::string_view, std::string_view text, messenger::reassembly_reason_t reason) {
+            REQUIRE(reason == messenger::reassembly_reason_t::complete);
+            msgs++;
+            text_bytes += text.size();
+        });
+        reasm.feed(traffic.stream.data(), traffic.stream.data() + traffic.stream.size());
+
+        REQUIRE(msgs == traffic.msgs);
+        REQUIRE(text_bytes == traffic.text_bytes);
+        REQUIRE(reasm.stats().packets == traffic.packets);
+    }
+
+    SECTION("chatty compressed traffic") {
+        config.vocabulary = 200;
+        config.text_len = {100, 2000, 0};
+        messenger::workload::traffic_t plain = messenger::workload::generate_traffic(config);
+        REQUIRE(plain.compressed == 0);
+
+        config.buff_opts.compress = true;
+        messenger::workload::traffic_t traffic = messenger::workload::generate_traffic(config);
+        REQUIRE(traffic.compressed > 0);
+        // Interleaving draws differ once packet counts do, so texts are compared by ratio
+        REQUIRE(static_cast<double>(traffic.stream.size()) / traffic.text_bytes
+                < static_cast<double>(plain.stream.size()) / plain.text_bytes);
+
+        size_t text_bytes = 0;
+        messenger::reassembler_t reasm([&](std::string_view, std::string_view text, messenger::reassembly_reason_t reason) {
+            REQUIRE(reason == messenger::reassembly_reason_t::complete);
+            text_bytes += text.size();
+        });
+        reasm.feed(traffic.stream.data(), traffic.stream.data() + traffic.stream.size());
+
+        REQUIRE(reasm.stats().msgs == traffic.msgs);
+        REQUIRE(text_bytes == traffic.text_bytes);
+    }
+
+    SECTION("corrupted traffic") {
+        config.corrupt_ratio = 0.05;
+        messenger::workload::traffic_t traffic = messenger::workload::generate_traffic(config);
+        REQUIRE(traffic.corrupted > 0);
+
+        messenger::reassembler_t reasm([](std::string_view, std::string_view, messenger::reassembly_reason_t) {});
+        REQUIRE_NOTHROW(reasm.feed(traffic.stream.data(), traffic.stream.data() + traffic.stream.size()));
+        REQUIRE(reasm.stats().dropped == traffic.corrupted);
+    }
+
+    SECTION("more interleaved messages than senders") {
+        config.interleave = config.senders + 1;
+        REQUIRE_THROWS_AS(messenger::workload::generate_traffic(config), std::invalid_argument);
+    }
+}
+
+} // namespace test